@@ -0,0 +1,337 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_inflate.h"
+
+#include <cstring>
+
+#include "engine/arctic_platform.h"
+
+namespace arctic {
+
+static const Si32 kInflateWindowSize = 65536;
+static const Si32 kInflateWindowMask = kInflateWindowSize - 1;
+// Bytes a match may reach back, they must stay in the window.
+static const Si32 kInflateHistorySize = 32768;
+static const Si32 kHuffmanFastBits = 10;
+static const Si32 kHuffmanMaxBits = 15;
+// Zero bytes read past the end of the input before it counts as truncated.
+static const Si32 kInflateMaxOverrun = 32;
+
+static const Ui16 kLengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const Ui8 kLengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const Ui16 kDistanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+  16385, 24577};
+static const Ui8 kDistanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const Ui8 kCodeLengthOrder[19] = {
+  16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Canonical Huffman code. Codes up to kHuffmanFastBits long are decoded
+// with one table lookup, longer ones bit by bit.
+struct HuffmanTable {
+  // (length << 9) | symbol, zero for codes that are not in the table.
+  Ui16 fast[1 << kHuffmanFastBits];
+  Ui16 count[kHuffmanMaxBits + 1];
+  Ui16 symbol[288];
+
+  void Build(const Ui8 *lengths, Si32 symbol_count) {
+    std::memset(count, 0, sizeof(count));
+    std::memset(fast, 0, sizeof(fast));
+    for (Si32 idx = 0; idx < symbol_count; ++idx) {
+      ++count[lengths[idx]];
+    }
+    count[0] = 0;
+    Si32 left = 1;
+    for (Si32 len = 1; len <= kHuffmanMaxBits; ++len) {
+      left = left * 2 - count[len];
+      Check(left >= 0, "Error in Inflate, oversubscribed Huffman code.");
+    }
+    Si32 offset[kHuffmanMaxBits + 1];
+    Si32 next_code[kHuffmanMaxBits + 1];
+    offset[1] = 0;
+    next_code[1] = 0;
+    for (Si32 len = 1; len < kHuffmanMaxBits; ++len) {
+      offset[len + 1] = offset[len] + count[len];
+      next_code[len + 1] = (next_code[len] + count[len]) << 1;
+    }
+    for (Si32 idx = 0; idx < symbol_count; ++idx) {
+      const Si32 len = lengths[idx];
+      if (!len) {
+        continue;
+      }
+      symbol[offset[len]++] = static_cast<Ui16>(idx);
+      const Si32 code = next_code[len]++;
+      if (len <= kHuffmanFastBits) {
+        // Deflate sends codes starting from the top bit.
+        Si32 reversed = 0;
+        for (Si32 bit = 0; bit < len; ++bit) {
+          reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+        }
+        for (Si32 fill = reversed; fill < (1 << kHuffmanFastBits);
+            fill += (1 << len)) {
+          fast[fill] = static_cast<Ui16>((len << 9) | idx);
+        }
+      }
+    }
+  }
+};
+
+class Inflater {
+ public:
+  Inflater(const std::vector<InflateSpan> &input, const InflateOutput &output)
+      : input_(input)
+      , output_(output)
+      , window_(kInflateWindowSize) {
+  }
+
+  void Run() {
+    const Si32 cmf = static_cast<Si32>(GetBits(8));
+    const Si32 flg = static_cast<Si32>(GetBits(8));
+    Check((cmf & 15) == 8, "Error in Inflate, unknown compression method.");
+    Check((cmf * 256 + flg) % 31 == 0, "Error in Inflate, bad zlib header.");
+    Check(!(flg & 32), "Error in Inflate, preset dictionary is not supported.");
+    bool is_final = false;
+    while (!is_final) {
+      is_final = GetBits(1) != 0;
+      const Ui32 type = GetBits(2);
+      if (type == 0) {
+        CopyStored();
+      } else if (type == 1) {
+        BuildFixedTables();
+        DecodeBlock();
+      } else if (type == 2) {
+        ReadDynamicTables();
+        DecodeBlock();
+      } else {
+        Fatal("Error in Inflate, bad block type.");
+      }
+    }
+    Flush();
+    // The Adler-32 checksum that follows is not verified.
+  }
+
+ private:
+  void Refill() {
+    while (bit_count_ <= 56) {
+      Ui64 byte = 0;
+      if (p_ != end_) {
+        byte = *p_;
+        ++p_;
+      } else if (span_index_ < static_cast<Si64>(input_.size())) {
+        p_ = input_[span_index_].data;
+        end_ = p_ + input_[span_index_].size;
+        ++span_index_;
+        continue;
+      } else {
+        ++overrun_;
+        Check(overrun_ <= kInflateMaxOverrun,
+          "Error in Inflate, unexpected end of data.");
+      }
+      bits_ |= byte << bit_count_;
+      bit_count_ += 8;
+    }
+  }
+
+  Ui32 GetBits(Si32 count) {
+    if (bit_count_ < count) {
+      Refill();
+    }
+    const Ui32 value = static_cast<Ui32>(bits_ & ((1ull << count) - 1));
+    bits_ >>= count;
+    bit_count_ -= count;
+    return value;
+  }
+
+  Si32 Decode(const HuffmanTable &table) {
+    if (bit_count_ < kHuffmanMaxBits) {
+      Refill();
+    }
+    const Ui32 entry = table.fast[bits_ & ((1 << kHuffmanFastBits) - 1)];
+    if (entry) {
+      bits_ >>= entry >> 9;
+      bit_count_ -= entry >> 9;
+      return entry & 511;
+    }
+    Si32 code = 0;
+    Si32 first = 0;
+    Si32 index = 0;
+    for (Si32 len = 1; len <= kHuffmanMaxBits; ++len) {
+      code |= static_cast<Si32>((bits_ >> (len - 1)) & 1);
+      const Si32 count = table.count[len];
+      if (code - first < count) {
+        bits_ >>= len;
+        bit_count_ -= len;
+        return table.symbol[index + code - first];
+      }
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    Fatal("Error in Inflate, bad Huffman code.");
+    return 0;
+  }
+
+  void Flush() {
+    const Si64 pending = static_cast<Si64>(position_ - flushed_);
+    if (!pending) {
+      return;
+    }
+    const Si64 begin = static_cast<Si64>(flushed_ & kInflateWindowMask);
+    const Si64 first = std::min(pending, kInflateWindowSize - begin);
+    output_(window_.data() + begin, first);
+    if (first < pending) {
+      output_(window_.data(), pending - first);
+    }
+    flushed_ = position_;
+  }
+
+  void CopyStored() {
+    GetBits(bit_count_ & 7);
+    const Ui32 length = GetBits(16);
+    const Ui32 length_complement = GetBits(16);
+    Check(length == (~length_complement & 0xffff),
+      "Error in Inflate, bad stored block length.");
+    for (Ui32 idx = 0; idx < length; ++idx) {
+      if (position_ - flushed_ >= kInflateHistorySize) {
+        Flush();
+      }
+      window_[position_ & kInflateWindowMask] = static_cast<Ui8>(GetBits(8));
+      ++position_;
+    }
+  }
+
+  void BuildFixedTables() {
+    Ui8 lengths[288];
+    std::memset(lengths, 8, 144);
+    std::memset(lengths + 144, 9, 112);
+    std::memset(lengths + 256, 7, 24);
+    std::memset(lengths + 280, 8, 8);
+    literals_.Build(lengths, 288);
+    std::memset(lengths, 5, 30);
+    distances_.Build(lengths, 30);
+  }
+
+  void ReadDynamicTables() {
+    const Si32 literal_count = static_cast<Si32>(GetBits(5)) + 257;
+    const Si32 distance_count = static_cast<Si32>(GetBits(5)) + 1;
+    const Si32 code_length_count = static_cast<Si32>(GetBits(4)) + 4;
+    Check(literal_count <= 286 && distance_count <= 30,
+      "Error in Inflate, too many Huffman codes.");
+    Ui8 lengths[286 + 30];
+    std::memset(lengths, 0, 19);
+    for (Si32 idx = 0; idx < code_length_count; ++idx) {
+      lengths[kCodeLengthOrder[idx]] = static_cast<Ui8>(GetBits(3));
+    }
+    HuffmanTable code_lengths;
+    code_lengths.Build(lengths, 19);
+    const Si32 total = literal_count + distance_count;
+    Si32 idx = 0;
+    while (idx < total) {
+      const Si32 symbol = Decode(code_lengths);
+      if (symbol < 16) {
+        lengths[idx++] = static_cast<Ui8>(symbol);
+        continue;
+      }
+      Ui8 value = 0;
+      Si32 repeat = 0;
+      if (symbol == 16) {
+        Check(idx > 0, "Error in Inflate, repeat with no previous length.");
+        value = lengths[idx - 1];
+        repeat = 3 + static_cast<Si32>(GetBits(2));
+      } else if (symbol == 17) {
+        repeat = 3 + static_cast<Si32>(GetBits(3));
+      } else {
+        repeat = 11 + static_cast<Si32>(GetBits(7));
+      }
+      Check(idx + repeat <= total, "Error in Inflate, too many lengths.");
+      std::memset(lengths + idx, value, repeat);
+      idx += repeat;
+    }
+    Check(lengths[256] != 0, "Error in Inflate, no end of block code.");
+    literals_.Build(lengths, literal_count);
+    distances_.Build(lengths + literal_count, distance_count);
+  }
+
+  void DecodeBlock() {
+    while (true) {
+      if (position_ - flushed_ >= kInflateHistorySize) {
+        Flush();
+      }
+      const Si32 symbol = Decode(literals_);
+      if (symbol < 256) {
+        window_[position_ & kInflateWindowMask] = static_cast<Ui8>(symbol);
+        ++position_;
+        continue;
+      }
+      if (symbol == 256) {
+        return;
+      }
+      const Si32 length_code = symbol - 257;
+      Check(length_code < 29, "Error in Inflate, bad length code.");
+      const Si32 length = kLengthBase[length_code] +
+        static_cast<Si32>(GetBits(kLengthExtra[length_code]));
+      const Si32 distance_code = Decode(distances_);
+      Check(distance_code < 30, "Error in Inflate, bad distance code.");
+      const Si32 distance = kDistanceBase[distance_code] +
+        static_cast<Si32>(GetBits(kDistanceExtra[distance_code]));
+      Check(static_cast<Ui64>(distance) <= position_,
+        "Error in Inflate, distance is too far back.");
+      Ui64 from = position_ - static_cast<Ui64>(distance);
+      for (Si32 idx = 0; idx < length; ++idx) {
+        window_[position_ & kInflateWindowMask] =
+          window_[from & kInflateWindowMask];
+        ++position_;
+        ++from;
+      }
+    }
+  }
+
+  const std::vector<InflateSpan> &input_;
+  const InflateOutput &output_;
+  Si64 span_index_ = 0;
+  const Ui8 *p_ = nullptr;
+  const Ui8 *end_ = nullptr;
+  Ui64 bits_ = 0;
+  Si32 bit_count_ = 0;
+  Si32 overrun_ = 0;
+  std::vector<Ui8> window_;
+  Ui64 position_ = 0;
+  Ui64 flushed_ = 0;
+  HuffmanTable literals_;
+  HuffmanTable distances_;
+};
+
+void ZlibInflate(const std::vector<InflateSpan> &input,
+    const InflateOutput &output) {
+  Inflater inflater(input, output);
+  inflater.Run();
+}
+
+}  // namespace arctic
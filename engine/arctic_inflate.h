@@ -0,0 +1,49 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_INFLATE_H_
+#define ENGINE_ARCTIC_INFLATE_H_
+
+#include <functional>
+#include <vector>
+
+#include "engine/arctic_types.h"
+
+namespace arctic {
+
+struct InflateSpan {
+  const Ui8 *data;
+  Si64 size;
+};
+
+// Receives the decompressed bytes in order, up to 32 KiB per call.
+typedef std::function<void(const Ui8 *data, Si64 size)> InflateOutput;
+
+// Decompresses a zlib stream split into spans, as PNG splits it across
+// IDAT chunks. Only a 64 KiB window is kept in memory, the output is
+// passed on as it is decoded. Calls Fatal on corrupt data.
+void ZlibInflate(const std::vector<InflateSpan> &input,
+  const InflateOutput &output);
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_INFLATE_H_
@@ -0,0 +1,593 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_mixer.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstring>
+
+#include "engine/arctic_math.h"
+#include "engine/arctic_platform.h"
+#include "engine/arctic_simd.h"
+#include "engine/easy_sound_stream.h"
+
+namespace arctic {
+
+static SoundMixer g_sound_mixer;
+
+// out[i] += in[i] * volume for count samples.
+static void MixSamples(const Si16 *in, Si32 count, float volume,
+    float *out) {
+  Si32 i = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  const __m128 volume4 = _mm_set1_ps(volume);
+  for (; i + 8 <= count; i += 8) {
+    __m128i in8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128 low = _mm_cvtepi32_ps(
+      _mm_srai_epi32(_mm_unpacklo_epi16(in8, in8), 16));
+    __m128 high = _mm_cvtepi32_ps(
+      _mm_srai_epi32(_mm_unpackhi_epi16(in8, in8), 16));
+    _mm_storeu_ps(out + i,
+      _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(low, volume4)));
+    _mm_storeu_ps(out + i + 4,
+      _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(high, volume4)));
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t in8 = vld1q_s16(in + i);
+    float32x4_t low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(in8)));
+    float32x4_t high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(in8)));
+    vst1q_f32(out + i, vmlaq_n_f32(vld1q_f32(out + i), low, volume));
+    vst1q_f32(out + i + 4, vmlaq_n_f32(vld1q_f32(out + i + 4), high, volume));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] += static_cast<float>(in[i]) * volume;
+  }
+}
+
+// Mixes mono frames into both channels of the interleaved stereo out.
+static void MixMonoSamples(const Si16 *in, Si32 frames, float left_volume,
+    float right_volume, float *out) {
+  Si32 i = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  const __m128 volume4 = _mm_setr_ps(left_volume, right_volume,
+    left_volume, right_volume);
+  for (; i + 4 <= frames; i += 4) {
+    __m128i in4 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i));
+    // a b c d -> a a b b c c d d
+    __m128i pairs = _mm_unpacklo_epi16(in4, in4);
+    __m128 low = _mm_cvtepi32_ps(
+      _mm_srai_epi32(_mm_unpacklo_epi16(pairs, pairs), 16));
+    __m128 high = _mm_cvtepi32_ps(
+      _mm_srai_epi32(_mm_unpackhi_epi16(pairs, pairs), 16));
+    float *to = out + i * 2;
+    _mm_storeu_ps(to, _mm_add_ps(_mm_loadu_ps(to), _mm_mul_ps(low, volume4)));
+    _mm_storeu_ps(to + 4,
+      _mm_add_ps(_mm_loadu_ps(to + 4), _mm_mul_ps(high, volume4)));
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  for (; i + 4 <= frames; i += 4) {
+    float32x4_t in4 = vcvtq_f32_s32(vmovl_s16(vld1_s16(in + i)));
+    float32x4x2_t pairs = vzipq_f32(vmulq_n_f32(in4, left_volume),
+      vmulq_n_f32(in4, right_volume));
+    float *to = out + i * 2;
+    vst1q_f32(to, vaddq_f32(vld1q_f32(to), pairs.val[0]));
+    vst1q_f32(to + 4, vaddq_f32(vld1q_f32(to + 4), pairs.val[1]));
+  }
+#endif
+  for (; i < frames; ++i) {
+    const float value = static_cast<float>(in[i]);
+    out[i * 2] += value * left_volume;
+    out[i * 2 + 1] += value * right_volume;
+  }
+}
+
+// Mixes interleaved stereo frames into out with a gain that changes
+// linearly from gain_from to gain_to over the block.
+static void MixBus(const float *in, Si32 frames, float gain_from,
+    float gain_to, float *out) {
+  const float step = (gain_to - gain_from) / static_cast<float>(frames);
+  Si32 i = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  __m128 gain = _mm_setr_ps(gain_from, gain_from,
+    gain_from + step, gain_from + step);
+  const __m128 gain_step = _mm_set1_ps(step * 2.0f);
+  for (; i + 2 <= frames; i += 2) {
+    _mm_storeu_ps(out + i * 2, _mm_add_ps(_mm_loadu_ps(out + i * 2),
+      _mm_mul_ps(_mm_loadu_ps(in + i * 2), gain)));
+    gain = _mm_add_ps(gain, gain_step);
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  const float gains[4] = {gain_from, gain_from,
+    gain_from + step, gain_from + step};
+  float32x4_t gain = vld1q_f32(gains);
+  const float32x4_t gain_step = vdupq_n_f32(step * 2.0f);
+  for (; i + 2 <= frames; i += 2) {
+    vst1q_f32(out + i * 2, vmlaq_f32(vld1q_f32(out + i * 2),
+      vld1q_f32(in + i * 2), gain));
+    gain = vaddq_f32(gain, gain_step);
+  }
+#endif
+  for (; i < frames; ++i) {
+    const float gain = gain_from + step * static_cast<float>(i);
+    out[i * 2] += in[i * 2] * gain;
+    out[i * 2 + 1] += in[i * 2 + 1] * gain;
+  }
+}
+
+// Rounds to the nearest Si16, saturating out of range values.
+static void ConvertToSi16(const float *in, Si32 count, Si16 *out) {
+  Si32 i = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  const __m128 low_limit = _mm_set1_ps(-32767.0f);
+  const __m128 high_limit = _mm_set1_ps(32767.0f);
+  for (; i + 8 <= count; i += 8) {
+    __m128 low = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low_limit),
+      high_limit);
+    __m128 high = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low_limit),
+      high_limit);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+      _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high)));
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  const float32x4_t low_limit = vdupq_n_f32(-32767.0f);
+  const float32x4_t high_limit = vdupq_n_f32(32767.0f);
+  const float32x4_t half = vdupq_n_f32(0.5f);
+  for (; i + 8 <= count; i += 8) {
+    float32x4_t low = vminq_f32(vmaxq_f32(vld1q_f32(in + i), low_limit),
+      high_limit);
+    float32x4_t high = vminq_f32(vmaxq_f32(vld1q_f32(in + i + 4), low_limit),
+      high_limit);
+    // vcvtq truncates, so round half away from zero first.
+    low = vaddq_f32(low, vbslq_f32(vcltq_f32(low, vdupq_n_f32(0.0f)),
+      vnegq_f32(half), half));
+    high = vaddq_f32(high, vbslq_f32(vcltq_f32(high, vdupq_n_f32(0.0f)),
+      vnegq_f32(half), half));
+    vst1q_s16(out + i, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(low)),
+      vqmovn_s32(vcvtq_s32_f32(high))));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = static_cast<Si16>(
+      std::lrint(Clamp(in[i], -32767.f, 32767.f)));
+  }
+}
+
+SoundMixer::SoundMixer() {
+  Bus &master = buses_[easy::kSoundBusMaster];
+  master.current_gain = master_volume_;
+  master.effects.push_back(std::make_shared<Limiter>());
+}
+
+SoundMixer::~SoundMixer() {
+  for (size_t idx = 0; idx < buffers_.size(); ++idx) {
+    buffers_[idx].sound.GetInstance()->DecPlaying();
+  }
+}
+
+SoundMixer *GetSoundMixer() {
+  return &g_sound_mixer;
+}
+
+void SoundMixer::StartBuffer(easy::Sound sound, float volume,
+    Si32 priority, float pan) {
+  if (!sound.GetInstance()) {
+    return;
+  }
+  SoundBuffer buffer;
+  buffer.sound = sound;
+  buffer.volume = volume;
+  buffer.pan = Clamp(pan, -1.0f, 1.0f);
+  buffer.priority = priority;
+  buffer.bus = buffer.sound.GetBus();
+  buffer.next_position = 0;
+  Check(buffer.sound.GetInstance()->GetFormat() != easy::kSoundDataStream ||
+    !buffer.sound.IsPlaying(),
+    "Error in StartBuffer, a streamed sound plays as one voice at a time.");
+  buffer.sound.GetInstance()->IncPlaying();
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer.start_order = next_start_order_;
+  ++next_start_order_;
+  buffers_.push_back(buffer);
+}
+
+void SoundMixer::StopBuffer(easy::Sound sound) {
+  if (!sound.GetInstance()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t idx = 0; idx < buffers_.size(); ++idx) {
+    SoundBuffer &buffer = buffers_[idx];
+    if (buffer.sound.GetInstance() == sound.GetInstance()) {
+      buffer.sound.GetInstance()->DecPlaying();
+      if (idx != buffers_.size() - 1) {
+        buffers_[idx] = buffers_[buffers_.size() - 1];
+      }
+      buffers_.pop_back();
+      idx--;
+    }
+  }
+}
+
+void SoundMixer::SetMasterVolume(float volume) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  master_volume_ = volume;
+}
+
+float SoundMixer::GetMasterVolume() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return master_volume_;
+}
+
+void SoundMixer::SetMaxAudibleVoices(Si32 count) {
+  Check(count > 0, "SetMaxAudibleVoices called with count <= 0");
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_audible_voices_ = count;
+}
+
+Si32 SoundMixer::GetMaxAudibleVoices() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_audible_voices_;
+}
+
+Si32 SoundMixer::GetVoiceCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<Si32>(buffers_.size());
+}
+
+Si32 SoundMixer::GetAudibleVoiceCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return audible_voices_;
+}
+
+void SoundMixer::SetBusGain(easy::SoundBus bus, float gain) {
+  Check(bus >= 0 && bus < easy::kSoundBusCount,
+    "SetBusGain called with a bus out of range");
+  std::lock_guard<std::mutex> lock(mutex_);
+  buses_[bus].gain = gain;
+}
+
+float SoundMixer::GetBusGain(easy::SoundBus bus) {
+  Check(bus >= 0 && bus < easy::kSoundBusCount,
+    "GetBusGain called with a bus out of range");
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buses_[bus].gain;
+}
+
+void SoundMixer::AddBusEffect(easy::SoundBus bus,
+    std::shared_ptr<SoundEffect> effect) {
+  Check(bus >= 0 && bus < easy::kSoundBusCount,
+    "AddBusEffect called with a bus out of range");
+  Check(!!effect, "AddBusEffect called with nullptr effect");
+  std::lock_guard<std::mutex> lock(mutex_);
+  buses_[bus].effects.push_back(std::move(effect));
+}
+
+void SoundMixer::ClearBusEffects(easy::SoundBus bus) {
+  Check(bus >= 0 && bus < easy::kSoundBusCount,
+    "ClearBusEffects called with a bus out of range");
+  std::lock_guard<std::mutex> lock(mutex_);
+  buses_[bus].effects.clear();
+}
+
+void SoundMixer::SetWaitingForStreams(bool is_enable) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  is_waiting_for_streams_ = is_enable;
+}
+
+void SoundMixer::SetOutputConfig(const SoundOutputConfig &config) {
+  Check(config.period_frames > 0,
+    "SetOutputConfig called with period_frames <= 0");
+  Check(config.period_count > 1,
+    "SetOutputConfig called with period_count < 2");
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+  ++config_version_;
+}
+
+SoundOutputConfig SoundMixer::GetOutputConfig(Si64 *out_version) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (out_version) {
+    *out_version = config_version_;
+  }
+  return config_;
+}
+
+SoundOutputStats SoundMixer::GetOutputStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+void SoundMixer::ResetOutputStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SoundOutputStats stats;
+  stats.period_frames = stats_.period_frames;
+  stats.buffer_frames = stats_.buffer_frames;
+  stats.is_realtime = stats_.is_realtime;
+  stats_ = stats;
+}
+
+void SoundMixer::ReportOutputFormat(Si32 period_frames, Si32 buffer_frames,
+    bool is_realtime) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.period_frames = period_frames;
+  stats_.buffer_frames = buffer_frames;
+  stats_.is_realtime = is_realtime;
+}
+
+void SoundMixer::ReportUnderrun() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.underruns;
+}
+
+void SoundMixer::ReportLatency(Si32 frames) {
+  const double latency = static_cast<double>(frames) / 44100.0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.latency_s = latency;
+  stats_.max_latency_s = std::max(stats_.max_latency_s, latency);
+}
+
+void SoundMixer::UpdateVirtualBuffers() {
+  const Ui32 count = static_cast<Ui32>(buffers_.size());
+  const Ui32 budget = static_cast<Ui32>(max_audible_voices_);
+  if (count <= budget) {
+    for (Ui32 idx = 0; idx < count; ++idx) {
+      buffers_[idx].is_virtual = false;
+    }
+    audible_voices_ = static_cast<Si32>(count);
+    return;
+  }
+  order_.resize(count);
+  for (Ui32 idx = 0; idx < count; ++idx) {
+    order_[idx] = idx;
+  }
+  const std::vector<SoundBuffer> &buffers = buffers_;
+  std::nth_element(order_.begin(), order_.begin() + budget, order_.end(),
+    [&buffers](Ui32 a, Ui32 b) {
+      const SoundBuffer &buffer_a = buffers[a];
+      const SoundBuffer &buffer_b = buffers[b];
+      if (buffer_a.priority != buffer_b.priority) {
+        return buffer_a.priority > buffer_b.priority;
+      }
+      if (buffer_a.volume != buffer_b.volume) {
+        return buffer_a.volume > buffer_b.volume;
+      }
+      return buffer_a.start_order < buffer_b.start_order;
+    });
+  for (Ui32 idx = 0; idx < count; ++idx) {
+    buffers_[order_[idx]].is_virtual = (idx >= budget);
+  }
+  audible_voices_ = static_cast<Si32>(budget);
+}
+
+void SoundMixer::Mix(Si32 frames, float *out_samples) {
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point start_time = Clock::now();
+  const Si32 samples = frames * 2;
+  memset(out_samples, 0, samples * sizeof(float));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<Si32>(tmp_.size()) < samples) {
+    tmp_.resize(samples);
+  }
+  double bus_time[easy::kSoundBusCount] = {};
+  bool has_voices[easy::kSoundBusCount] = {};
+  for (Si32 idx = 0; idx < easy::kSoundBusCount; ++idx) {
+    Bus &bus = buses_[idx];
+    if (static_cast<Si32>(bus.samples.size()) < samples) {
+      bus.samples.resize(samples);
+    }
+    memset(bus.samples.data(), 0, samples * sizeof(float));
+  }
+  UpdateVirtualBuffers();
+  for (size_t idx = 0; idx < buffers_.size(); ++idx) {
+    SoundBuffer &buffer = buffers_[idx];
+    // Callback sounds report zero duration, they end when the callback
+    // fills less than the whole block.
+    const Si32 duration = buffer.sound.DurationSamples();
+    Si32 size = frames;
+    if (duration) {
+      size = std::min(size, duration - buffer.next_position);
+    }
+    const Si32 requested = size;
+    const bool is_callback =
+      buffer.sound.GetInstance()->GetFormat() == easy::kSoundDataCallback;
+    if (buffer.is_virtual && is_callback) {
+      // Only the callback knows when its sound ends, so an inaudible
+      // callback voice still runs and its output is dropped.
+      size = buffer.sound.StreamOutNative(buffer.next_position, size,
+        tmp_.data(), size * buffer.sound.Channels());
+      buffer.next_position += size;
+    } else if (buffer.is_virtual) {
+      // A voice of unknown length could never reach its end by counting,
+      // so it holds its position like a paused voice until it is audible.
+      if (duration) {
+        buffer.next_position += std::max(size, 0);
+      }
+    } else if (size > 0) {
+      const Clock::time_point voice_start_time = Clock::now();
+      const Si32 channels = buffer.sound.Channels();
+      if (is_waiting_for_streams_ &&
+          buffer.sound.GetInstance()->GetFormat() == easy::kSoundDataStream) {
+        buffer.sound.GetInstance()->GetStream()->WaitForFrames(
+          buffer.next_position, size);
+      }
+      size = buffer.sound.StreamOutNative(buffer.next_position, size,
+        tmp_.data(), size * channels);
+      float *bus_samples = buses_[buffer.bus].samples.data();
+      if (channels == 1) {
+        // Centered mono sounds play at full volume on both sides, panning
+        // turns the other side down.
+        MixMonoSamples(tmp_.data(), size,
+          buffer.volume * std::min(1.0f, 1.0f - buffer.pan),
+          buffer.volume * std::min(1.0f, 1.0f + buffer.pan), bus_samples);
+      } else {
+        MixSamples(tmp_.data(), size * 2, buffer.volume, bus_samples);
+      }
+      buffer.next_position += size;
+      has_voices[buffer.bus] = true;
+      bus_time[buffer.bus] += std::chrono::duration<double>(
+        Clock::now() - voice_start_time).count();
+    }
+
+    bool is_ended = duration && buffer.next_position >= duration;
+    if (is_callback) {
+      is_ended = size < requested;
+    } else if (!buffer.is_virtual && size <= 0 && !is_ended) {
+      // A stream gives no frames while its decoder is behind, its voice
+      // waits and plays silence until the whole file is read.
+      const easy::SoundInstance &instance = *buffer.sound.GetInstance();
+      is_ended = instance.GetFormat() != easy::kSoundDataStream ||
+        instance.GetStream()->IsFinished();
+    }
+    if (is_ended) {
+      buffer.sound.GetInstance()->DecPlaying();
+      buffers_[idx] = buffers_[buffers_.size() - 1];
+      buffers_.pop_back();
+      --idx;
+    }
+  }
+
+  Bus &master = buses_[easy::kSoundBusMaster];
+  for (Si32 idx = 0; idx < easy::kSoundBusCount; ++idx) {
+    Bus &bus = buses_[idx];
+    if (idx == easy::kSoundBusMaster ||
+        (!has_voices[idx] && bus.effects.empty())) {
+      continue;
+    }
+    const Clock::time_point bus_start_time = Clock::now();
+    for (size_t effect = 0; effect < bus.effects.size(); ++effect) {
+      bus.effects[effect]->Process(bus.samples.data(), frames);
+    }
+    MixBus(bus.samples.data(), frames, bus.current_gain, bus.gain,
+      master.samples.data());
+    bus.current_gain = bus.gain;
+    bus_time[idx] += std::chrono::duration<double>(
+      Clock::now() - bus_start_time).count();
+  }
+
+  // The master chain runs after the master volume, so its limiter sees
+  // the level that is actually played.
+  const Clock::time_point master_start_time = Clock::now();
+  const float master_gain = master.gain * master_volume_;
+  MixBus(master.samples.data(), frames, master.current_gain, master_gain,
+    out_samples);
+  master.current_gain = master_gain;
+  for (size_t effect = 0; effect < master.effects.size(); ++effect) {
+    master.effects[effect]->Process(out_samples, frames);
+  }
+  bus_time[easy::kSoundBusMaster] += std::chrono::duration<double>(
+    Clock::now() - master_start_time).count();
+
+  for (Si32 idx = 0; idx < easy::kSoundBusCount; ++idx) {
+    SoundBusStats &bus_stats = stats_.buses[idx];
+    bus_stats.last_time_s = bus_time[idx];
+    bus_stats.max_time_s = std::max(bus_stats.max_time_s, bus_time[idx]);
+    bus_stats.total_time_s += bus_time[idx];
+  }
+  const double mix_time = std::chrono::duration<double>(
+    Clock::now() - start_time).count();
+  ++stats_.periods_mixed;
+  stats_.last_mix_time_s = mix_time;
+  stats_.max_mix_time_s = std::max(stats_.max_mix_time_s, mix_time);
+  stats_.total_mix_time_s += mix_time;
+}
+
+void SoundMixer::Mix(Si32 frames, Si16 *out_samples) {
+  const Si32 samples = frames * 2;
+  if (static_cast<Si32>(mix_.size()) < samples) {
+    mix_.resize(samples);
+  }
+  Mix(frames, mix_.data());
+  ConvertToSi16(mix_.data(), samples, out_samples);
+}
+
+void StartSoundBuffer(easy::Sound sound, float volume) {
+  g_sound_mixer.StartBuffer(sound, volume, 0);
+}
+
+void StartSoundBuffer(easy::Sound sound, float volume, Si32 priority) {
+  g_sound_mixer.StartBuffer(sound, volume, priority);
+}
+
+void StartSoundBuffer(easy::Sound sound, float volume, Si32 priority,
+    float pan) {
+  g_sound_mixer.StartBuffer(sound, volume, priority, pan);
+}
+
+void StopSoundBuffer(easy::Sound sound) {
+  g_sound_mixer.StopBuffer(sound);
+}
+
+void SetMasterVolume(float volume) {
+  g_sound_mixer.SetMasterVolume(volume);
+}
+
+float GetMasterVolume() {
+  return g_sound_mixer.GetMasterVolume();
+}
+
+void SetMaxAudibleVoices(Si32 count) {
+  g_sound_mixer.SetMaxAudibleVoices(count);
+}
+
+Si32 GetMaxAudibleVoices() {
+  return g_sound_mixer.GetMaxAudibleVoices();
+}
+
+void SetSoundBusGain(easy::SoundBus bus, float gain) {
+  g_sound_mixer.SetBusGain(bus, gain);
+}
+
+float GetSoundBusGain(easy::SoundBus bus) {
+  return g_sound_mixer.GetBusGain(bus);
+}
+
+void AddSoundBusEffect(easy::SoundBus bus,
+    std::shared_ptr<SoundEffect> effect) {
+  g_sound_mixer.AddBusEffect(bus, std::move(effect));
+}
+
+void ClearSoundBusEffects(easy::SoundBus bus) {
+  g_sound_mixer.ClearBusEffects(bus);
+}
+
+void SetSoundOutputConfig(const SoundOutputConfig &config) {
+  g_sound_mixer.SetOutputConfig(config);
+}
+
+SoundOutputConfig GetSoundOutputConfig() {
+  return g_sound_mixer.GetOutputConfig(nullptr);
+}
+
+SoundOutputStats GetSoundOutputStats() {
+  return g_sound_mixer.GetOutputStats();
+}
+
+void ResetSoundOutputStats() {
+  g_sound_mixer.ResetOutputStats();
+}
+
+}  // namespace arctic
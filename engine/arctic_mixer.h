@@ -0,0 +1,172 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_MIXER_H_
+#define ENGINE_ARCTIC_MIXER_H_
+
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "engine/arctic_sound_effects.h"
+#include "engine/arctic_types.h"
+#include "engine/easy_sound.h"
+
+namespace arctic {
+
+struct SoundBuffer {
+  easy::Sound sound;
+  float volume = 1.0f;
+  // Balance of a mono sound, -1 is left only and 1 is right only.
+  float pan = 0.0f;
+  Si32 priority = 0;
+  easy::SoundBus bus = easy::kSoundBusSfx;
+  Si32 next_position = 0;
+  Si64 start_order = 0;
+  // A virtual buffer is over the voice budget. Its play cursor keeps
+  // advancing, but it is neither decoded nor mixed. A buffer of unknown
+  // duration holds its cursor instead, as it can't tell when it ends.
+  bool is_virtual = false;
+};
+
+// Sound output settings. Output latency is about
+// period_frames * period_count frames. Smaller periods lower the latency
+// at the cost of more frequent wakeups and a higher risk of underruns.
+struct SoundOutputConfig {
+  // Frames mixed and written per output wakeup.
+  Si32 period_frames = 441;
+  // Periods in the output device buffer.
+  Si32 period_count = 5;
+  // Run the output thread with real-time priority when the OS allows it.
+  bool is_realtime = false;
+  // Without a device the output still mixes at the real-time pace and
+  // throws the result away, so a headless run plays sounds to their end.
+  // Starting with ARCTIC_NO_SOUND_DEVICE set in the environment turns the
+  // device off from the start.
+  bool is_device_enabled = true;
+};
+
+// Time spent mixing the voices of a bus and running its effects.
+struct SoundBusStats {
+  double last_time_s = 0.0;
+  double max_time_s = 0.0;
+  double total_time_s = 0.0;
+};
+
+// Sound output counters, accumulated since the last reset.
+struct SoundOutputStats {
+  Si64 periods_mixed = 0;
+  Si64 underruns = 0;
+  double last_mix_time_s = 0.0;
+  double max_mix_time_s = 0.0;
+  double total_mix_time_s = 0.0;
+  // Output latency measured right after the last write.
+  double latency_s = 0.0;
+  double max_latency_s = 0.0;
+  // Values negotiated with the output device, 0 if unknown.
+  Si32 period_frames = 0;
+  Si32 buffer_frames = 0;
+  bool is_realtime = false;
+  SoundBusStats buses[easy::kSoundBusCount];
+};
+
+// Mixes the playing sound buffers into a stereo 44100 Hz stream.
+// At most max_audible_voices buffers are audible at a time, the rest are
+// virtual. Buffers with higher priority win, then the louder ones, then the
+// ones that started earlier.
+// Each buffer is mixed into the bus of its sound. Every bus runs its effect
+// chain over the whole block, then is mixed into the master bus with its
+// gain. The master bus ends with a limiter instead of hard clipping.
+class SoundMixer {
+ private:
+  struct Bus {
+    float gain = 1.0f;
+    // The gain applied at the end of the last block, it ramps to gain
+    // over a block to avoid clicks.
+    float current_gain = 1.0f;
+    std::vector<std::shared_ptr<SoundEffect>> effects;
+    std::vector<float> samples;
+  };
+
+  std::mutex mutex_;
+  float master_volume_ = 0.7f;
+  Si32 max_audible_voices_ = 32;
+  Si32 audible_voices_ = 0;
+  Si64 next_start_order_ = 0;
+  bool is_waiting_for_streams_ = false;
+  std::vector<SoundBuffer> buffers_;
+  std::vector<Si16> tmp_;
+  std::vector<float> mix_;
+  std::vector<Ui32> order_;
+  Bus buses_[easy::kSoundBusCount];
+  SoundOutputConfig config_;
+  Si64 config_version_ = 0;
+  SoundOutputStats stats_;
+
+  void UpdateVirtualBuffers();
+
+ public:
+  SoundMixer();
+  ~SoundMixer();
+  SoundMixer(const SoundMixer&) = delete;
+  SoundMixer &operator=(const SoundMixer&) = delete;
+  void StartBuffer(easy::Sound sound, float volume, Si32 priority,
+    float pan = 0.0f);
+  void StopBuffer(easy::Sound sound);
+  void SetMasterVolume(float volume);
+  float GetMasterVolume();
+  void SetMaxAudibleVoices(Si32 count);
+  Si32 GetMaxAudibleVoices();
+  Si32 GetVoiceCount();
+  Si32 GetAudibleVoiceCount();
+  void SetBusGain(easy::SoundBus bus, float gain);
+  float GetBusGain(easy::SoundBus bus);
+  // Appends the effect to the end of the bus effect chain.
+  void AddBusEffect(easy::SoundBus bus, std::shared_ptr<SoundEffect> effect);
+  void ClearBusEffects(easy::SoundBus bus);
+  // Makes Mix wait for streamed sounds to decode instead of playing the
+  // missing frames as silence, so offline runs don't depend on timing.
+  void SetWaitingForStreams(bool is_enable);
+  void SetOutputConfig(const SoundOutputConfig &config);
+  // Returns the requested output config, out_version changes every time
+  // the config is set so the output can tell when to reconfigure.
+  SoundOutputConfig GetOutputConfig(Si64 *out_version);
+  SoundOutputStats GetOutputStats();
+  void ResetOutputStats();
+  // Called by the platform output to report what the device is doing.
+  void ReportOutputFormat(Si32 period_frames, Si32 buffer_frames,
+    bool is_realtime);
+  void ReportUnderrun();
+  void ReportLatency(Si32 frames);
+  // Writes frames * 2 interleaved samples in the Si16 range, after the
+  // master bus effects.
+  void Mix(Si32 frames, float *out_samples);
+  // Writes frames * 2 interleaved samples, clamped to the Si16 range.
+  void Mix(Si32 frames, Si16 *out_samples);
+};
+
+// The mixer that feeds the platform audio output.
+SoundMixer *GetSoundMixer();
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_MIXER_H_
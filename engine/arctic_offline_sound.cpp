@@ -0,0 +1,160 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_offline_sound.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+
+#include "engine/arctic_platform.h"
+#include "engine/easy.h"
+#include "engine/easy_sound_instance.h"
+
+namespace arctic {
+
+OfflineSoundRenderer::OfflineSoundRenderer(Si32 period_frames)
+    : period_frames_(period_frames) {
+  Check(period_frames_ > 0, "OfflineSoundRenderer period_frames <= 0");
+  period_.resize(static_cast<size_t>(period_frames_) * 2);
+  mixer_.SetWaitingForStreams(true);
+}
+
+SoundMixer *OfflineSoundRenderer::GetMixer() {
+  return &mixer_;
+}
+
+void OfflineSoundRenderer::Play(easy::Sound sound, float volume,
+    Si32 priority, float pan) {
+  mixer_.StartBuffer(sound, volume, priority, pan);
+}
+
+void OfflineSoundRenderer::Stop(easy::Sound sound) {
+  mixer_.StopBuffer(sound);
+}
+
+void OfflineSoundRenderer::Render(Si64 frames) {
+  const auto start_time = std::chrono::steady_clock::now();
+  while (frames > 0) {
+    const Si32 size = static_cast<Si32>(
+      std::min(frames, static_cast<Si64>(period_frames_)));
+    mixer_.Mix(size, period_.data());
+    voice_frames_ += static_cast<Si64>(mixer_.GetAudibleVoiceCount()) * size;
+    if (is_recording_) {
+      samples_.insert(samples_.end(), period_.begin(),
+        period_.begin() + size * 2);
+    }
+    rendered_frames_ += size;
+    frames -= size;
+  }
+  wall_time_s_ += std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start_time).count();
+}
+
+void OfflineSoundRenderer::RenderSeconds(double duration) {
+  Render(static_cast<Si64>(duration * 44100.0 + 0.5));
+}
+
+double OfflineSoundRenderer::GetTime() const {
+  return static_cast<double>(rendered_frames_) / 44100.0;
+}
+
+Si64 OfflineSoundRenderer::GetRenderedFrames() const {
+  return rendered_frames_;
+}
+
+void OfflineSoundRenderer::SetRecording(bool is_enable) {
+  is_recording_ = is_enable;
+}
+
+const std::vector<Si16> &OfflineSoundRenderer::GetSamples() const {
+  return samples_;
+}
+
+void OfflineSoundRenderer::ClearSamples() {
+  samples_.clear();
+}
+
+void OfflineSoundRenderer::SaveWav(const char *file_name) const {
+  std::vector<Ui8> file = easy::SaveWav(samples_.data(),
+    static_cast<Si64>(samples_.size() / 2));
+  easy::WriteFile(file_name, file.data(), file.size());
+}
+
+Ui64 OfflineSoundRenderer::GetSamplesHash() const {
+  // FNV-1a over the sample bytes.
+  Ui64 hash = 14695981039346656037ull;
+  for (size_t idx = 0; idx < samples_.size(); ++idx) {
+    const Ui16 sample = static_cast<Ui16>(samples_[idx]);
+    hash = (hash ^ (sample & 255)) * 1099511628211ull;
+    hash = (hash ^ (sample >> 8)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+double OfflineSoundRenderer::GetWallTime() const {
+  return wall_time_s_;
+}
+
+double OfflineSoundRenderer::GetRealtimeFactor() const {
+  if (wall_time_s_ <= 0.0) {
+    return 0.0;
+  }
+  return GetTime() / wall_time_s_;
+}
+
+double OfflineSoundRenderer::GetVoiceThroughput() const {
+  if (wall_time_s_ <= 0.0) {
+    return 0.0;
+  }
+  return static_cast<double>(voice_frames_) / 44100.0 / wall_time_s_;
+}
+
+void OfflineSoundRenderer::ResetCounters() {
+  rendered_frames_ = 0;
+  voice_frames_ = 0;
+  wall_time_s_ = 0.0;
+}
+
+SoundBenchmarkResult RunSoundBenchmark(easy::Sound sound, Si32 voice_count,
+    double duration, Si32 max_audible_voices) {
+  Check(voice_count > 0, "RunSoundBenchmark voice_count <= 0");
+  OfflineSoundRenderer renderer;
+  renderer.GetMixer()->SetMaxAudibleVoices(max_audible_voices);
+  const Si32 period_frames = 441;
+  const Si64 total_frames = static_cast<Si64>(duration * 44100.0 + 0.5);
+  Si32 started = 0;
+  while (renderer.GetRenderedFrames() < total_frames) {
+    if (started < voice_count) {
+      renderer.Play(sound, 1.0f / static_cast<float>(voice_count));
+      ++started;
+    }
+    renderer.Render(std::min(static_cast<Si64>(period_frames),
+      total_frames - renderer.GetRenderedFrames()));
+  }
+  SoundBenchmarkResult result;
+  result.realtime_factor = renderer.GetRealtimeFactor();
+  result.voice_throughput = renderer.GetVoiceThroughput();
+  result.samples_hash = renderer.GetSamplesHash();
+  return result;
+}
+
+}  // namespace arctic
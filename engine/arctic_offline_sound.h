@@ -0,0 +1,100 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_OFFLINE_SOUND_H_
+#define ENGINE_ARCTIC_OFFLINE_SOUND_H_
+
+#include <vector>
+
+#include "engine/arctic_mixer.h"
+#include "engine/arctic_types.h"
+
+namespace arctic {
+
+// Runs its own SoundMixer without a sound device, as fast as the CPU
+// allows. The clock advances only by the rendered frames and streamed
+// sounds are waited for, so a run gives the same samples every time. Use
+// it to record the mix to memory or to a WAV file and to measure mixing
+// and decoding throughput. Sound::Play goes to the device mixer, play the
+// sounds through the renderer instead.
+class OfflineSoundRenderer {
+ private:
+  SoundMixer mixer_;
+  Si32 period_frames_;
+  bool is_recording_ = true;
+  Si64 rendered_frames_ = 0;
+  Si64 voice_frames_ = 0;
+  double wall_time_s_ = 0.0;
+  std::vector<Si16> period_;
+  std::vector<Si16> samples_;
+
+ public:
+  // Mixes in period_frames chunks, like the platform output does.
+  explicit OfflineSoundRenderer(Si32 period_frames = 441);
+
+  // The mixer the renderer drives, to set the voice budget, bus gains and
+  // effects.
+  SoundMixer *GetMixer();
+  void Play(easy::Sound sound, float volume = 1.0f, Si32 priority = 0,
+    float pan = 0.0f);
+  void Stop(easy::Sound sound);
+
+  // Mixes the next frames. Appends them to the recording if enabled.
+  void Render(Si64 frames);
+  void RenderSeconds(double duration);
+
+  // Rendered audio time in seconds, the deterministic clock.
+  double GetTime() const;
+  Si64 GetRenderedFrames() const;
+
+  void SetRecording(bool is_enable);
+  // Interleaved stereo samples recorded so far.
+  const std::vector<Si16> &GetSamples() const;
+  void ClearSamples();
+  void SaveWav(const char *file_name) const;
+  // Hash of the recorded samples, runs that sound the same have the same
+  // hash. Compare it with a known value to catch mixer regressions.
+  Ui64 GetSamplesHash() const;
+
+  // Wall-clock seconds spent inside Render.
+  double GetWallTime() const;
+  // Seconds of audio rendered per wall-clock second.
+  double GetRealtimeFactor() const;
+  // Seconds of audible voices mixed per wall-clock second.
+  double GetVoiceThroughput() const;
+  void ResetCounters();
+};
+
+struct SoundBenchmarkResult {
+  double realtime_factor = 0.0;
+  double voice_throughput = 0.0;
+  Ui64 samples_hash = 0;
+};
+
+// Renders duration seconds offline while starting voice_count copies of
+// the sound, one per 441 frame period. The hash is a regression check.
+SoundBenchmarkResult RunSoundBenchmark(easy::Sound sound, Si32 voice_count,
+  double duration, Si32 max_audible_voices = 32);
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_OFFLINE_SOUND_H_
@@ -0,0 +1,185 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace arctic {
+
+static const Si32 kMaxParallelThreads = 16;
+
+class ParallelPool {
+ public:
+  ParallelPool() {
+    Si32 count = static_cast<Si32>(std::thread::hardware_concurrency());
+    count = std::max(1, std::min(count, kMaxParallelThreads));
+    for (Si32 idx = 1; idx < count; ++idx) {
+      workers_.emplace_back(&ParallelPool::ThreadFunction, this);
+    }
+  }
+
+  ~ParallelPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      do_quit_ = true;
+    }
+    start_.notify_all();
+    for (std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  Si32 GetThreadCount() const {
+    return static_cast<Si32>(workers_.size()) + 1;
+  }
+
+  void Run(Si32 begin, Si32 end, Si32 min_range,
+      const std::function<void(Si32, Si32)> &body) {
+    const Si32 size = end - begin;
+    Si32 range_count = std::min(GetThreadCount(),
+      size / std::max(min_range, 1));
+    // A nested call must not touch run_mutex_, the calling thread may
+    // already hold it.
+    if (range_count <= 1 || is_inside_) {
+      body(begin, end);
+      return;
+    }
+    std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+    if (!run_lock.owns_lock()) {
+      body(begin, end);
+      return;
+    }
+    is_inside_ = true;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      body_ = &body;
+      begin_ = begin;
+      end_ = end;
+      range_count_ = range_count;
+      next_range_ = 0;
+      ranges_done_ = 0;
+      ++generation_;
+    }
+    start_.notify_all();
+    RunRanges();
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Workers still inside RunRanges would read the next job's ranges.
+    done_.wait(lock, [this] {
+      return ranges_done_ == range_count_ && active_workers_ == 0;
+    });
+    body_ = nullptr;
+    is_inside_ = false;
+  }
+
+ private:
+  // Takes ranges of the current job until none are left.
+  void RunRanges() {
+    Si32 ran = 0;
+    while (true) {
+      const Si32 range = next_range_.fetch_add(1);
+      if (range >= range_count_) {
+        break;
+      }
+      const Si64 size = end_ - begin_;
+      (*body_)(begin_ + static_cast<Si32>(size * range / range_count_),
+        begin_ + static_cast<Si32>(size * (range + 1) / range_count_));
+      ++ran;
+    }
+    if (ran) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ranges_done_ += ran;
+      if (ranges_done_ == range_count_) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  void ThreadFunction() {
+    is_inside_ = true;
+    Ui64 seen_generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      start_.wait(lock, [&] {
+        return do_quit_ || generation_ != seen_generation;
+      });
+      if (do_quit_) {
+        return;
+      }
+      seen_generation = generation_;
+      if (!body_) {
+        continue;
+      }
+      ++active_workers_;
+      lock.unlock();
+      RunRanges();
+      lock.lock();
+      --active_workers_;
+      if (active_workers_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  bool do_quit_ = false;
+  Ui64 generation_ = 0;
+  const std::function<void(Si32, Si32)> *body_ = nullptr;
+  Si32 begin_ = 0;
+  Si32 end_ = 0;
+  Si32 range_count_ = 0;
+  std::atomic<Si32> next_range_{0};
+  Si32 ranges_done_ = 0;
+  Si32 active_workers_ = 0;
+  // Set on the workers and on the thread running a job, while it runs.
+  static thread_local bool is_inside_;
+};
+
+thread_local bool ParallelPool::is_inside_ = false;
+
+static ParallelPool &GetParallelPool() {
+  static ParallelPool pool;
+  return pool;
+}
+
+Si32 GetParallelThreadCount() {
+  return GetParallelPool().GetThreadCount();
+}
+
+void ParallelFor(Si32 begin, Si32 end, Si32 min_range,
+    const std::function<void(Si32, Si32)> &body) {
+  if (end <= begin) {
+    return;
+  }
+  GetParallelPool().Run(begin, end, min_range, body);
+}
+
+}  // namespace arctic
@@ -0,0 +1,45 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_PARALLEL_H_
+#define ENGINE_ARCTIC_PARALLEL_H_
+
+#include <functional>
+
+#include "engine/arctic_types.h"
+
+namespace arctic {
+
+// Number of threads ParallelFor uses, the calling one included.
+Si32 GetParallelThreadCount();
+
+// Calls body(range_begin, range_end) for consecutive ranges covering
+// [begin, end) on the worker threads and the calling thread, returns when
+// all of them are done. Ranges are at least min_range long, so small loops
+// stay on the calling thread. Nested calls, and calls made while another
+// thread runs a ParallelFor, run on the calling thread alone.
+void ParallelFor(Si32 begin, Si32 end, Si32 min_range,
+  const std::function<void(Si32, Si32)> &body);
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_PARALLEL_H_
@@ -0,0 +1,252 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_pixel_convert.h"
+
+#include "engine/arctic_simd.h"
+
+namespace arctic {
+
+typedef void (*SwizzleFunction)(const Ui8 *from, Si32 count, Ui8 *to);
+
+static void SwizzleBgraToRgbaScalar(const Ui8 *from, Si32 count, Ui8 *to) {
+  Si32 x = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  // Swaps the bytes 0 and 2 of every 32-bit pixel.
+  const __m128i green_alpha = _mm_set1_epi32(static_cast<int>(0xff00ff00u));
+  const __m128i low_byte = _mm_set1_epi32(0xff);
+  for (; x + 4 <= count; x += 4) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+    __m128i swapped = _mm_or_si128(
+      _mm_and_si128(_mm_srli_epi32(p, 16), low_byte),
+      _mm_slli_epi32(_mm_and_si128(p, low_byte), 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(to),
+      _mm_or_si128(_mm_and_si128(p, green_alpha), swapped));
+    from += 16;
+    to += 16;
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  for (; x + 16 <= count; x += 16) {
+    uint8x16x4_t p = vld4q_u8(from);
+    uint8x16_t blue = p.val[0];
+    p.val[0] = p.val[2];
+    p.val[2] = blue;
+    vst4q_u8(to, p);
+    from += 64;
+    to += 64;
+  }
+#endif
+  for (; x < count; ++x) {
+    to[0] = from[2];
+    to[1] = from[1];
+    to[2] = from[0];
+    to[3] = from[3];
+    from += 4;
+    to += 4;
+  }
+}
+
+// The three byte kernels serve both BGR and RGB sources.
+template <bool kSwapRedBlue>
+static void ExpandToRgbaScalar(const Ui8 *from, Si32 count, Ui8 *to) {
+  const Si32 red = kSwapRedBlue ? 2 : 0;
+  Si32 x = 0;
+#if defined(ARCTIC_SIMD_NEON)
+  for (; x + 16 <= count; x += 16) {
+    uint8x16x3_t p = vld3q_u8(from);
+    uint8x16x4_t out;
+    out.val[0] = p.val[red];
+    out.val[1] = p.val[1];
+    out.val[2] = p.val[2 - red];
+    out.val[3] = vdupq_n_u8(255);
+    vst4q_u8(to, out);
+    from += 48;
+    to += 64;
+  }
+#endif
+  for (; x < count; ++x) {
+    to[0] = from[red];
+    to[1] = from[1];
+    to[2] = from[2 - red];
+    to[3] = 255;
+    from += 3;
+    to += 4;
+  }
+}
+
+#if defined(ARCTIC_SIMD_SSE2)
+ARCTIC_TARGET_SSSE3
+static void SwizzleBgraToRgbaSsse3(const Ui8 *from, Si32 count, Ui8 *to) {
+  const __m128i shuffle = _mm_setr_epi8(
+    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  Si32 x = 0;
+  for (; x + 4 <= count; x += 4) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(to),
+      _mm_shuffle_epi8(p, shuffle));
+    from += 16;
+    to += 16;
+  }
+  SwizzleBgraToRgbaScalar(from, count - x, to);
+}
+
+template <bool kSwapRedBlue>
+ARCTIC_TARGET_SSSE3
+static void ExpandToRgbaSsse3(const Ui8 *from, Si32 count, Ui8 *to) {
+  // Four pixels per 16-byte load, the alpha bytes come from the or.
+  const char red = kSwapRedBlue ? 2 : 0;
+  const __m128i shuffle = _mm_setr_epi8(
+    red, 1, 2 - red, -1, red + 3, 4, 5 - red, -1,
+    red + 6, 7, 8 - red, -1, red + 9, 10, 11 - red, -1);
+  const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+  Si32 x = 0;
+  // The load reads 4 bytes past the last pixel it converts.
+  for (; x + 6 <= count; x += 4) {
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(to),
+      _mm_or_si128(_mm_shuffle_epi8(p, shuffle), alpha));
+    from += 12;
+    to += 16;
+  }
+  ExpandToRgbaScalar<kSwapRedBlue>(from, count - x, to);
+}
+
+ARCTIC_TARGET_AVX2
+static void SwizzleBgraToRgbaAvx2(const Ui8 *from, Si32 count, Ui8 *to) {
+  const __m256i shuffle = _mm256_setr_epi8(
+    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+    2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  Si32 x = 0;
+  for (; x + 8 <= count; x += 8) {
+    __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(to),
+      _mm256_shuffle_epi8(p, shuffle));
+    from += 32;
+    to += 32;
+  }
+  SwizzleBgraToRgbaScalar(from, count - x, to);
+}
+
+template <bool kSwapRedBlue>
+ARCTIC_TARGET_AVX2
+static void ExpandToRgbaAvx2(const Ui8 *from, Si32 count, Ui8 *to) {
+  // Each 128-bit lane gets four pixels, the lanes are loaded 12 bytes apart.
+  const char red = kSwapRedBlue ? 2 : 0;
+  const __m256i shuffle = _mm256_setr_epi8(
+    red, 1, 2 - red, -1, red + 3, 4, 5 - red, -1,
+    red + 6, 7, 8 - red, -1, red + 9, 10, 11 - red, -1,
+    red, 1, 2 - red, -1, red + 3, 4, 5 - red, -1,
+    red + 6, 7, 8 - red, -1, red + 9, 10, 11 - red, -1);
+  const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+  Si32 x = 0;
+  for (; x + 10 <= count; x += 8) {
+    __m256i p = _mm256_inserti128_si256(_mm256_castsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(from))),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + 12)), 1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(to),
+      _mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), alpha));
+    from += 24;
+    to += 32;
+  }
+  ExpandToRgbaScalar<kSwapRedBlue>(from, count - x, to);
+}
+
+static SwizzleFunction PickSwizzle(SwizzleFunction avx2,
+    SwizzleFunction ssse3, SwizzleFunction fallback) {
+  if (avx2 && CpuHasAvx2()) {
+    return avx2;
+  }
+  if (ssse3 && CpuHasSsse3()) {
+    return ssse3;
+  }
+  return fallback;
+}
+#endif
+
+void SwizzleBgraToRgba(const Ui8 *from, Si32 count, Ui8 *to) {
+#if defined(ARCTIC_SIMD_SSE2)
+  static const SwizzleFunction swizzle = PickSwizzle(
+    SwizzleBgraToRgbaAvx2, SwizzleBgraToRgbaSsse3, SwizzleBgraToRgbaScalar);
+#else
+  static const SwizzleFunction swizzle = SwizzleBgraToRgbaScalar;
+#endif
+  swizzle(from, count, to);
+}
+
+void SwizzleBgrToRgba(const Ui8 *from, Si32 count, Ui8 *to) {
+#if defined(ARCTIC_SIMD_SSE2)
+  static const SwizzleFunction swizzle = PickSwizzle(
+    ExpandToRgbaAvx2<true>, ExpandToRgbaSsse3<true>,
+    ExpandToRgbaScalar<true>);
+#else
+  static const SwizzleFunction swizzle = ExpandToRgbaScalar<true>;
+#endif
+  swizzle(from, count, to);
+}
+
+void ExpandRgbToRgba(const Ui8 *from, Si32 count, Ui8 *to) {
+#if defined(ARCTIC_SIMD_SSE2)
+  static const SwizzleFunction swizzle = PickSwizzle(
+    ExpandToRgbaAvx2<false>, ExpandToRgbaSsse3<false>,
+    ExpandToRgbaScalar<false>);
+#else
+  static const SwizzleFunction swizzle = ExpandToRgbaScalar<false>;
+#endif
+  swizzle(from, count, to);
+}
+
+static const Si64 kStreamingFillBytesMin = 1 << 20;
+
+void FillPixels(Ui32 *to, Si64 count, Ui32 value) {
+  Si64 x = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  // Aligns to 16 bytes for the stores, pixels are at least 4 byte aligned.
+  for (; x < count && (reinterpret_cast<size_t>(to + x) & 15); ++x) {
+    to[x] = value;
+  }
+  const __m128i wide = _mm_set1_epi32(static_cast<int>(value));
+  if ((count - x) * 4 >= kStreamingFillBytesMin) {
+    for (; x + 16 <= count; x += 16) {
+      __m128i *p = reinterpret_cast<__m128i*>(to + x);
+      _mm_stream_si128(p, wide);
+      _mm_stream_si128(p + 1, wide);
+      _mm_stream_si128(p + 2, wide);
+      _mm_stream_si128(p + 3, wide);
+    }
+    _mm_sfence();
+  }
+  for (; x + 4 <= count; x += 4) {
+    _mm_store_si128(reinterpret_cast<__m128i*>(to + x), wide);
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  const uint32x4_t wide = vdupq_n_u32(value);
+  for (; x + 8 <= count; x += 8) {
+    vst1q_u32(to + x, wide);
+    vst1q_u32(to + x + 4, wide);
+  }
+#endif
+  for (; x < count; ++x) {
+    to[x] = value;
+  }
+}
+
+}  // namespace arctic
@@ -0,0 +1,48 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_PIXEL_CONVERT_H_
+#define ENGINE_ARCTIC_PIXEL_CONVERT_H_
+
+#include "engine/arctic_types.h"
+
+namespace arctic {
+
+// Pixel format converters for the image loaders. The widest kernel the CPU
+// supports is picked on the first call.
+
+// Converts count BGRA pixels to RGBA.
+void SwizzleBgraToRgba(const Ui8 *from, Si32 count, Ui8 *to);
+
+// Converts count BGR pixels to opaque RGBA.
+void SwizzleBgrToRgba(const Ui8 *from, Si32 count, Ui8 *to);
+
+// Converts count RGB pixels to opaque RGBA.
+void ExpandRgbToRgba(const Ui8 *from, Si32 count, Ui8 *to);
+
+// Sets count 32-bit pixels to value. Fills larger than the cache use
+// streaming stores, so clearing a frame does not evict what is drawn next.
+void FillPixels(Ui32 *to, Si64 count, Ui32 value);
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_PIXEL_CONVERT_H_
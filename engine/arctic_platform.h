@@ -24,6 +24,7 @@
 #define ENGINE_ARCTIC_PLATFORM_H_
 
 #include <deque>
+#include "engine/arctic_mixer.h"
 #include "engine/arctic_types.h"
 #include "engine/easy_sound.h"
 
@@ -44,10 +45,27 @@ bool SetVSync(bool is_enable);
 bool IsFullScreen();
 void SetFullScreen(bool is_enable);
 void StartSoundBuffer(easy::Sound sound, float volume);
+void StartSoundBuffer(easy::Sound sound, float volume, Si32 priority);
+void StartSoundBuffer(easy::Sound sound, float volume, Si32 priority,
+    float pan);
 void StopSoundBuffer(easy::Sound sound);
 
 void SetMasterVolume(float volume);
 float GetMasterVolume();
+void SetMaxAudibleVoices(Si32 count);
+Si32 GetMaxAudibleVoices();
+void SetSoundBusGain(easy::SoundBus bus, float gain);
+float GetSoundBusGain(easy::SoundBus bus);
+// The master bus chain starts with a limiter, clear it to remove it.
+void AddSoundBusEffect(easy::SoundBus bus,
+    std::shared_ptr<SoundEffect> effect);
+void ClearSoundBusEffects(easy::SoundBus bus);
+// The output applies a new config as soon as it can, the platforms that
+// can't reconfigure a running output ignore it.
+void SetSoundOutputConfig(const SoundOutputConfig &config);
+SoundOutputConfig GetSoundOutputConfig();
+SoundOutputStats GetSoundOutputStats();
+void ResetSoundOutputStats();
 
 Ui16 FromBe(Ui16 x);
 Si16 FromBe(Si16 x);
@@ -46,6 +46,7 @@
 #include "engine/engine.h"
 #include "engine/easy.h"
 #include "engine/arctic_input.h"
+#include "engine/arctic_mixer.h"
 #include "engine/arctic_platform.h"
 #include "engine/byte_array.h"
 #include "engine/log.h"
@@ -643,27 +644,15 @@ void CreateMainWindow() {
   }
 }
 
-static std::mutex g_sound_mixer_mutex;
-struct SoundBuffer {
-  easy::Sound sound;
-  float volume = 1.0f;
-  Si32 next_position = 0;
-};
-struct SoundMixerState {
-  float master_volume = 0.7f;
-  std::vector<SoundBuffer> buffers;
-};
-SoundMixerState g_sound_mixer_state;
-
-struct SoundMixer {
+struct CoreAudioSoundOutput {
   AudioUnit output_unit = {0};
-  std::vector<Si16> tmp;
+  std::vector<float> mix;
   double starting_frame_count = 0.0;
   bool is_initialized = false;
 
   void Initialize();
   void Deinitialize();
-  ~SoundMixer() {
+  ~CoreAudioSoundOutput() {
     Deinitialize();
   }
 };
@@ -681,56 +670,29 @@ OSStatus SoundRenderProc(void *inRefCon,
     UInt32 inBusNumber,
     UInt32 inNumberFrames,
     AudioBufferList *ioData) {
-  SoundMixer *mixer = (SoundMixer*)inRefCon;
+  CoreAudioSoundOutput *output = (CoreAudioSoundOutput*)inRefCon;
 
   Float32 *mixL = (Float32*)ioData->mBuffers[0].mData;
   Float32 *mixR = (Float32*)ioData->mBuffers[1].mData;
-  memset(mixL, 0, inNumberFrames * sizeof(Float32));
-  memset(mixR, 0, inNumberFrames * sizeof(Float32));
-
-  float master_volume = 1.0f;
-  {
-    std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-    master_volume = g_sound_mixer_state.master_volume / 32767.0;
-    for (Ui32 idx = 0; idx < g_sound_mixer_state.buffers.size(); ++idx) {
-      SoundBuffer &sound = g_sound_mixer_state.buffers[idx];
-
-      Ui32 size = inNumberFrames;
-      size = sound.sound.StreamOut(sound.next_position, inNumberFrames,
-          mixer->tmp.data(), inNumberFrames * 2);
-      Si16 *in_data = mixer->tmp.data();
-      for (Ui32 i = 0; i < size; ++i) {
-        mixL[i] += static_cast<Si32>(
-            static_cast<float>(in_data[i * 2]) * sound.volume);
-        mixR[i] += static_cast<Si32>(
-            static_cast<float>(in_data[i * 2 + 1]) * sound.volume);
-        ++sound.next_position;
-      }
-
-      if (sound.next_position == sound.sound.DurationSamples()
-          || size == 0) {
-        sound.sound.GetInstance()->DecPlaying();
-        g_sound_mixer_state.buffers[idx] =
-          g_sound_mixer_state.buffers[
-          g_sound_mixer_state.buffers.size() - 1];
-        g_sound_mixer_state.buffers.pop_back();
-        --idx;
-      }
-    }
+  if (output->mix.size() < inNumberFrames * 2) {
+    output->mix.resize(inNumberFrames * 2);
   }
+  float *mix = output->mix.data();
+  GetSoundMixer()->Mix(static_cast<Si32>(inNumberFrames), mix);
 
+  const float scale = 1.0f / 32767.0f;
   for (int frame = 0; frame < inNumberFrames; ++frame) {
-    mixL[frame] = Clamp(mixL[frame] * master_volume, -1.0, 1.0);
-    mixR[frame] = Clamp(mixR[frame] * master_volume, -1.0, 1.0);
+    mixL[frame] = Clamp(mix[frame * 2] * scale, -1.0f, 1.0f);
+    mixR[frame] = Clamp(mix[frame * 2 + 1] * scale, -1.0f, 1.0f);
   }
   return noErr;
 }
 
-void SoundMixer::Initialize() {
+void CoreAudioSoundOutput::Initialize() {
   if (is_initialized) {
     return;
   }
-  tmp.resize(2 << 20);
+  mix.resize(2 << 20);
 
   AudioComponentDescription outputcd = {0};
   outputcd.componentType = kAudioUnitType_Output;
@@ -765,7 +727,7 @@ void SoundMixer::Initialize() {
   is_initialized = true;
 }
 
-void SoundMixer::Deinitialize() {
+void CoreAudioSoundOutput::Deinitialize() {
   if (is_initialized) {
     AudioOutputUnitStop(output_unit);
     AudioUnitUninitialize(output_unit);
@@ -775,47 +737,6 @@ void SoundMixer::Deinitialize() {
 }
 
 
-void StartSoundBuffer(easy::Sound sound, float volume) {
-  if (sound.GetInstance()) {
-    SoundBuffer buffer;
-    buffer.sound = sound;
-    buffer.volume = volume;
-    buffer.next_position = 0;
-    buffer.sound.GetInstance()->IncPlaying();
-    std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-    g_sound_mixer_state.buffers.push_back(buffer);
-  }
-}
-
-void StopSoundBuffer(easy::Sound sound) {
-  if (sound.GetInstance()) {
-    std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-    for (size_t idx = 0; idx < g_sound_mixer_state.buffers.size(); ++idx) {
-      SoundBuffer &buffer = g_sound_mixer_state.buffers[idx];
-      if (buffer.sound.GetInstance() == sound.GetInstance()) {
-        buffer.sound.GetInstance()->DecPlaying();
-        if (idx != g_sound_mixer_state.buffers.size() - 1) {
-          g_sound_mixer_state.buffers[idx] =
-            g_sound_mixer_state.buffers[
-            g_sound_mixer_state.buffers.size() - 1];
-        }
-        g_sound_mixer_state.buffers.pop_back();
-        idx--;
-      }
-    }
-  }
-}
-
-void SetMasterVolume(float volume) {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  g_sound_mixer_state.master_volume = volume;
-}
-
-float GetMasterVolume() {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  return g_sound_mixer_state.master_volume;
-}
-
 void PumpMessages() {
   @autoreleasepool {
     while (true) {
@@ -989,8 +910,8 @@ int main(int argc, char *argv[]) {
   NSRect rect = [g_main_view convertRectToBacking: [g_main_view frame]];
   arctic::easy::GetEngine()->Init(rect.size.width, rect.size.height);
 
-  arctic::SoundMixer mixer;
-  mixer.Initialize();
+  arctic::CoreAudioSoundOutput sound_output;
+  sound_output.Initialize();
 
   EasyMain();
 
@@ -27,6 +27,10 @@
 #include <alsa/asoundlib.h>
 #include <arpa/inet.h>
 #include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -45,7 +49,9 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>  // NOLINT
 #include <cmath>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -57,6 +63,7 @@
 #include "engine/engine.h"
 #include "engine/easy.h"
 #include "engine/arctic_input.h"
+#include "engine/arctic_mixer.h"
 #include "engine/arctic_platform.h"
 #include "engine/byte_array.h"
 #include "engine/rgb.h"
@@ -554,57 +561,6 @@ void CreateMainWindow(SystemInfo *system_info) {
   return;
 }
 
-static std::mutex g_sound_mixer_mutex;
-struct SoundBuffer {
-  easy::Sound sound;
-  float volume = 1.0f;
-  Si32 next_position = 0;
-};
-struct SoundMixerState {
-  float master_volume = 0.7f;
-  std::vector<SoundBuffer> buffers;
-  std::atomic<bool> do_quit = ATOMIC_VAR_INIT(false);
-};
-SoundMixerState g_sound_mixer_state;
-
-void StartSoundBuffer(easy::Sound sound, float volume) {
-  SoundBuffer buffer;
-  buffer.sound = sound;
-  buffer.volume = volume;
-  buffer.next_position = 0;
-  buffer.sound.GetInstance()->IncPlaying();
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  g_sound_mixer_state.buffers.push_back(buffer);
-}
-
-void StopSoundBuffer(easy::Sound sound) {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  for (size_t idx = 0; idx < g_sound_mixer_state.buffers.size(); ++idx) {
-    SoundBuffer &buffer = g_sound_mixer_state.buffers[idx];
-    if (buffer.sound.GetInstance() == sound.GetInstance()) {
-      buffer.sound.GetInstance()->DecPlaying();
-      if (idx != g_sound_mixer_state.buffers.size() - 1) {
-        g_sound_mixer_state.buffers[idx] =
-          g_sound_mixer_state.buffers[
-          g_sound_mixer_state.buffers.size() - 1];
-      }
-      g_sound_mixer_state.buffers.pop_back();
-      idx--;
-    }
-  }
-}
-
-void SetMasterVolume(float volume) {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  g_sound_mixer_state.master_volume = volume;
-}
-
-float GetMasterVolume() {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  return g_sound_mixer_state.master_volume;
-}
-
-
 void Swap() {
   glFlush();
   glXSwapBuffers(g_x_display, g_x_window);
@@ -642,230 +598,318 @@ void SetFullScreen(bool/* is_enable*/) {
   return;
 }
 
-static unsigned int g_buffer_time_us = 50000;
-static unsigned int g_period_time_us = 10000;
+static std::atomic<bool> g_sound_mixer_do_quit = ATOMIC_VAR_INIT(false);
 
-struct async_private_data {
+struct SoundOutputState {
   std::vector<Si16> samples;
-  std::vector<Si32> mix;
-  std::vector<Si16> tmp;
-  snd_async_handler_t *ahandler = nullptr;
+  std::vector<struct pollfd> poll_fds;
   snd_pcm_t *handle = nullptr;
-  snd_output_t *output = nullptr;
-  snd_pcm_sframes_t buffer_size;
-  snd_pcm_sframes_t period_size;
+  snd_pcm_sframes_t buffer_size = 0;
+  snd_pcm_sframes_t period_size = 0;
+  bool is_realtime = false;
+  // Set while the device can't be opened, so the retries stay quiet.
+  bool is_failing = false;
 };
 
-static async_private_data g_data;
-
-void MixSound() {
-  async_private_data *data = &g_data;
-
-  Si32 buffer_samples_total = data->period_size * 2;
-  Si32 buffer_bytes = data->period_size * 4;
-
-  float master_volume = 1.0f;
-  {
-    memset(data->mix.data(), 0, 2 * buffer_bytes);
-    std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-    master_volume = g_sound_mixer_state.master_volume;
-    for (Ui32 idx = 0;
-        idx < g_sound_mixer_state.buffers.size(); ++idx) {
-      SoundBuffer &sound = g_sound_mixer_state.buffers[idx];
-
-      Ui32 size = data->period_size;
-      size = sound.sound.StreamOut(sound.next_position, size,
-          data->tmp.data(), buffer_samples_total);
-      Si16 *in_data = data->tmp.data();
-      for (Ui32 i = 0; i < size; ++i) {
-        data->mix[i * 2] += static_cast<Si32>(
-            static_cast<float>(in_data[i * 2]) * sound.volume);
-        data->mix[i * 2 + 1] += static_cast<Si32>(
-            static_cast<float>(in_data[i * 2 + 1]) * sound.volume);
-        ++sound.next_position;
-      }
+static SoundOutputState g_data;
+
+static bool SetSoundThreadRealtime(bool is_enable) {
+  sched_param param;
+  memset(&param, 0, sizeof(param));
+  int policy = SCHED_OTHER;
+  if (is_enable) {
+    policy = SCHED_FIFO;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) +
+      (sched_get_priority_max(SCHED_FIFO) -
+       sched_get_priority_min(SCHED_FIFO)) / 2;
+  }
+  // Fails without CAP_SYS_NICE or an rtprio limit, keep going without it.
+  int err = pthread_setschedparam(pthread_self(), policy, &param);
+  return is_enable && err == 0;
+}
 
-      if (sound.next_position == sound.sound.DurationSamples()
-          || size == 0) {
-        sound.sound.GetInstance()->DecPlaying();
-        g_sound_mixer_state.buffers[idx] =
-          g_sound_mixer_state.buffers[
-          g_sound_mixer_state.buffers.size() - 1];
-        g_sound_mixer_state.buffers.pop_back();
-        --idx;
-      }
+// Logs the ALSA error and returns false if err is negative.
+static bool IsSoundOk(int err, const char *message) {
+  if (err < 0) {
+    if (!g_data.is_failing) {
+      Log("Sound output error. ", message, snd_strerror(err));
     }
+    return false;
   }
+  return true;
+}
 
-  unsigned char *out_buffer = (unsigned char *)data->samples.data();
-  for (Ui32 i = 0; i < buffer_samples_total; ++i) {
-    Si16 res = static_cast<Si16>(Clamp(
-          static_cast<float>(data->mix[i]) * master_volume,
-          -32767.0, 32767.0));
-    out_buffer[i * 2 + 0] = res & 0xff;
-    out_buffer[i * 2 + 1] = (res >> 8) & 0xff;
+static void CloseSoundOutput() {
+  if (g_data.handle) {
+    snd_pcm_drop(g_data.handle);
+    snd_pcm_close(g_data.handle);
+    g_data.handle = nullptr;
   }
+  g_data.poll_fds.clear();
 }
 
-static void SoundMixerCallback(snd_async_handler_t *ahandler) {
-  snd_pcm_t *handle = snd_async_handler_get_pcm(ahandler);
-  async_private_data *data = static_cast<async_private_data*>(
-      snd_async_handler_get_callback_private(ahandler));
+// Returns false and leaves the output closed if the device can't be
+// opened or configured, the caller tries again later.
+static bool OpenSoundOutput(const SoundOutputConfig &config) {
+  snd_pcm_hw_params_t *hwparams;
+  snd_pcm_hw_params_alloca(&hwparams);
+  snd_pcm_sw_params_t *swparams;
+  snd_pcm_sw_params_alloca(&swparams);
 
-  while (true) {
-    snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
-    if (avail < data->period_size) {
-      return;
+  int err = snd_pcm_open(&g_data.handle, "default",
+      SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+  if (err == -ENOENT) {
+    err = snd_pcm_open(&g_data.handle, "plughw:0,0",
+        SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK);
+    if (!IsSoundOk(err, "Can't open 'plughw:0,0' sound device: ")) {
+      g_data.handle = nullptr;
+      return false;
     }
+  } else if (!IsSoundOk(err, "Can't open 'default' sound device: ")) {
+    g_data.handle = nullptr;
+    return false;
+  }
 
-    MixSound();
+  bool is_ok = IsSoundOk(snd_pcm_hw_params_any(g_data.handle, hwparams),
+      "Can't get sound configuration space: ") &&
+    IsSoundOk(snd_pcm_hw_params_set_rate_resample(g_data.handle, hwparams,
+      1), "Can't set sound resampling: ") &&
+    IsSoundOk(snd_pcm_hw_params_set_access(g_data.handle, hwparams,
+      SND_PCM_ACCESS_RW_INTERLEAVED), "Can't set access type for sound: ") &&
+    IsSoundOk(snd_pcm_hw_params_set_format(g_data.handle, hwparams,
+      SND_PCM_FORMAT_S16), "Can't set sample format for sound: ") &&
+    IsSoundOk(snd_pcm_hw_params_set_channels(g_data.handle, hwparams, 2),
+      "Can't set 2 channels for sound: ");
+  unsigned int rate = 44100;
+  is_ok = is_ok && IsSoundOk(snd_pcm_hw_params_set_rate_near(g_data.handle,
+      hwparams, &rate, 0), "Can't set 44100 Hz rate for sound: ");
+  if (is_ok && rate != 44100) {
+    if (!g_data.is_failing) {
+      Log("Sound output rate doesn't match requested 44100 Hz.");
+    }
+    is_ok = false;
+  }
+  // The period is negotiated first, so the device picks the buffer size
+  // closest to the requested number of its actual periods.
+  int dir = 0;
+  snd_pcm_uframes_t size = static_cast<snd_pcm_uframes_t>(
+      config.period_frames);
+  is_ok = is_ok && IsSoundOk(snd_pcm_hw_params_set_period_size_near(
+      g_data.handle, hwparams, &size, &dir),
+    "Can't set period size for sound: ");
+  g_data.period_size = size;
+  size = static_cast<snd_pcm_uframes_t>(g_data.period_size) *
+      static_cast<snd_pcm_uframes_t>(config.period_count);
+  is_ok = is_ok && IsSoundOk(snd_pcm_hw_params_set_buffer_size_near(
+      g_data.handle, hwparams, &size), "Can't set buffer size for sound: ") &&
+    IsSoundOk(snd_pcm_hw_params(g_data.handle, hwparams),
+      "Can't set hw params for sound: ") &&
+    IsSoundOk(snd_pcm_hw_params_get_buffer_size(hwparams, &size),
+      "Can't get buffer size for sound: ");
+  g_data.buffer_size = size;
+  is_ok = is_ok && IsSoundOk(snd_pcm_hw_params_get_period_size(hwparams,
+      &size, &dir), "Can't get period size for sound: ");
+  g_data.period_size = size;
+  if (is_ok && g_data.period_size <= 0) {
+    if (!g_data.is_failing) {
+      Log("Sound output period size is 0.");
+    }
+    is_ok = false;
+  }
 
-    unsigned char *out_buffer = (unsigned char *)data->samples.data();
-    int err = snd_pcm_writei(handle, out_buffer, data->period_size);
-    Check(err >= 0, "Sound write error: ", snd_strerror(err));
-    Check(err == data->period_size,
-        "Sound write error: written != expected.");
+  is_ok = is_ok && IsSoundOk(snd_pcm_sw_params_current(g_data.handle,
+      swparams), "Can't determine current sw params for sound: ") &&
+    IsSoundOk(snd_pcm_sw_params_set_start_threshold(g_data.handle, swparams,
+      (g_data.buffer_size / g_data.period_size) * g_data.period_size),
+      "Can't set start threshold mode for sound: ") &&
+    IsSoundOk(snd_pcm_sw_params_set_avail_min(g_data.handle, swparams,
+      g_data.period_size), "Can't set avail min for sound: ") &&
+    IsSoundOk(snd_pcm_sw_params(g_data.handle, swparams),
+      "Can't set sw params for sound: ");
+
+  int count = 0;
+  if (is_ok) {
+    count = snd_pcm_poll_descriptors_count(g_data.handle);
+    is_ok = count > 0;
+    if (!is_ok) {
+      IsSoundOk(count < 0 ? count : -EINVAL,
+          "Can't get sound poll descriptors count: ");
+    }
+  }
+  if (is_ok) {
+    g_data.poll_fds.resize(count);
+    err = snd_pcm_poll_descriptors(g_data.handle, g_data.poll_fds.data(),
+        static_cast<unsigned int>(count));
+    is_ok = IsSoundOk(err, "Can't get sound poll descriptors: ");
+  }
+  if (!is_ok) {
+    CloseSoundOutput();
+    return false;
   }
+
+  g_data.samples.resize(g_data.period_size * 2);
+  g_data.is_realtime = SetSoundThreadRealtime(config.is_realtime);
+  GetSoundMixer()->ReportOutputFormat(static_cast<Si32>(g_data.period_size),
+      static_cast<Si32>(g_data.buffer_size), g_data.is_realtime);
+  return true;
 }
 
-void SoundMixerThreadFunction() {
-  while (!g_sound_mixer_state.do_quit) {
-    MixSound();
+// Recovers from an underrun (-EPIPE), a suspend (-ESTRPIPE) or an
+// interrupted call, returns false if the device has to be reopened.
+static bool RecoverSoundOutput(int err) {
+  if (err == -EPIPE) {
+    GetSoundMixer()->ReportUnderrun();
+  }
+  err = snd_pcm_recover(g_data.handle, err, 1);
+  return IsSoundOk(err, "Can't recover sound output: ");
+}
+
+void MixSound() {
+  GetSoundMixer()->Mix(static_cast<Si32>(g_data.period_size),
+    g_data.samples.data());
+}
 
+// Fills all the free periods of the device buffer, returns false if the
+// device has to be reopened.
+static bool WriteSoundOutput() {
+  snd_pcm_sframes_t avail = snd_pcm_avail_update(g_data.handle);
+  if (avail < 0) {
+    if (!RecoverSoundOutput(static_cast<int>(avail))) {
+      return false;
+    }
+    avail = snd_pcm_avail_update(g_data.handle);
+    if (!IsSoundOk(static_cast<int>(std::min<snd_pcm_sframes_t>(avail, 0)),
+        "Can't get available sound buffer size: ")) {
+      return false;
+    }
+  }
+  while (avail >= g_data.period_size) {
+    MixSound();
     Si16 *out_buffer = g_data.samples.data();
-    Si32 size_left = g_data.period_size;
+    snd_pcm_sframes_t size_left = g_data.period_size;
     while (size_left > 0) {
-      int err = snd_pcm_writei(g_data.handle, out_buffer, size_left);
-      if (err == -EAGAIN) {
+      snd_pcm_sframes_t written = snd_pcm_writei(g_data.handle, out_buffer,
+          static_cast<snd_pcm_uframes_t>(size_left));
+      if (written == -EAGAIN) {
+        // The device is full, sleep until it takes more.
+        snd_pcm_wait(g_data.handle, 100);
         continue;
-      } else if (err == -EPIPE) {
-        err = snd_pcm_prepare(g_data.handle);
-        Check(err >= 0, "Can't recover sound from underrun: ",
-            snd_strerror(err));
-      } else if (err == -ESTRPIPE) {
-        while (true) {
-          err = snd_pcm_resume(g_data.handle);
-          if (err != -EAGAIN) {
-            break;
-          }
-          sleep(1);
-        }
-        if (err < 0) {
-          err = snd_pcm_prepare(g_data.handle);
-          Check(err >= 0, "Can't recover sound from suspend: ",
-              snd_strerror(err));
+      } else if (written < 0) {
+        if (!RecoverSoundOutput(static_cast<int>(written))) {
+          return false;
         }
-      } else {
-        Check(err >= 0, "Can't write sound data: ",
-            snd_strerror(err));
+        continue;
       }
-      out_buffer += err * 2;
-      size_left -= err;
+      out_buffer += written * 2;
+      size_left -= written;
     }
+    avail -= g_data.period_size;
   }
-}
 
-std::thread sound_thread;
+  snd_pcm_sframes_t delay = 0;
+  if (snd_pcm_delay(g_data.handle, &delay) >= 0) {
+    GetSoundMixer()->ReportLatency(static_cast<Si32>(delay));
+  }
+  return true;
+}
 
-void StartSoundMixer() {
-  snd_pcm_hw_params_t *hwparams;
-  snd_pcm_hw_params_alloca(&hwparams);
-  snd_pcm_sw_params_t *swparams;
-  snd_pcm_sw_params_alloca(&swparams);
-  int err = snd_output_stdio_attach(&g_data.output, stdout, 0);
-  Check(err >= 0, "Sound error output setup failed: ", snd_strerror(err));
+void SoundMixerThreadFunction() {
+  typedef std::chrono::steady_clock Clock;
+  Si64 config_version = -1;
+  Clock::time_point next_period_time = Clock::now();
+  while (!g_sound_mixer_do_quit) {
+    Si64 version = 0;
+    SoundOutputConfig config = GetSoundMixer()->GetOutputConfig(&version);
+    if (!config.is_device_enabled) {
+      if (version != config_version) {
+        CloseSoundOutput();
+        config_version = version;
+        g_data.period_size = config.period_frames;
+        g_data.samples.resize(g_data.period_size * 2);
+        GetSoundMixer()->ReportOutputFormat(config.period_frames, 0, false);
+        next_period_time = Clock::now();
+      }
+      // Mixes a period per period of time and throws it away.
+      MixSound();
+      next_period_time += std::chrono::microseconds(
+        static_cast<Si64>(config.period_frames) * 1000000 / 44100);
+      std::this_thread::sleep_until(next_period_time);
+      continue;
+    }
+    if (version != config_version || !g_data.handle) {
+      CloseSoundOutput();
+      if (!OpenSoundOutput(config) || !WriteSoundOutput()) {
+        // No usable device, the game keeps running silently and the
+        // output tries again a bit later.
+        CloseSoundOutput();
+        g_data.is_failing = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        continue;
+      }
+      config_version = version;
+      g_data.is_failing = false;
+    }
 
-  err = snd_pcm_open(&g_data.handle, "default", SND_PCM_STREAM_PLAYBACK, 0);
-  if (err == -ENOENT) {
-    err = snd_pcm_open(&g_data.handle, "plughw:0,0",
-        SND_PCM_STREAM_PLAYBACK, 0);
-    Check(err >= 0, "Can't open 'plughw:0,0' sound device: ",
-        snd_strerror(err));
-  } else {
-    Check(err >= 0, "Can't open 'default' sound device: ",
-        snd_strerror(err));
-  }
-
-  err = snd_pcm_hw_params_any(g_data.handle, hwparams);
-  Check(err >= 0, "Can't get sound configuration space: ", snd_strerror(err));
-  err = snd_pcm_hw_params_set_rate_resample(g_data.handle, hwparams, 1);
-  Check(err >= 0, "Can't set sound resampling: ", snd_strerror(err));
-  err = snd_pcm_hw_params_set_access(g_data.handle, hwparams,
-      SND_PCM_ACCESS_RW_INTERLEAVED);
-  Check(err >= 0, "Can't set access type for sound: ", snd_strerror(err));
-  err = snd_pcm_hw_params_set_format(g_data.handle, hwparams,
-      SND_PCM_FORMAT_S16);
-  Check(err >= 0, "Can't set sample format for sound: ", snd_strerror(err));
-  err = snd_pcm_hw_params_set_channels(g_data.handle, hwparams, 2);
-  Check(err >= 0, "Can't set 2 channels for sound: ", snd_strerror(err));
-  unsigned int rate = 44100;
-  err = snd_pcm_hw_params_set_rate_near(g_data.handle, hwparams, &rate, 0);
-  Check(err >= 0, "Can't set 44100 Hz rate for sound: ", snd_strerror(err));
-  Check(rate == 44100, "Sound output rate doesn't match requested 44100 Hz.");
-  int dir;
-  err = snd_pcm_hw_params_set_buffer_time_near(g_data.handle, hwparams,
-      &g_buffer_time_us, &dir);
-  Check(err >= 0, "Can't set buffer time for sound: ", snd_strerror(err));
-  snd_pcm_uframes_t size;
-  err = snd_pcm_hw_params_get_buffer_size(hwparams, &size);
-  Check(err >= 0, "Can't get buffer size for sound: ", snd_strerror(err));
-  g_data.buffer_size = size;
-  err = snd_pcm_hw_params_set_period_time_near(g_data.handle, hwparams,
-      &g_period_time_us, &dir);
-  Check(err >= 0, "Can't set period time for sound: ", snd_strerror(err));
-  err = snd_pcm_hw_params_get_period_size(hwparams, &size, &dir);
-  Check(err >= 0, "Can't get period size for sound: ", snd_strerror(err));
-  g_data.period_size = size;
-  err = snd_pcm_hw_params(g_data.handle, hwparams);
-  Check(err >= 0, "Can't set hw params for sound: ", snd_strerror(err));
-
-  err = snd_pcm_sw_params_current(g_data.handle, swparams);
-  Check(err >= 0, "Can't determine current sw params for sound: ",
-      snd_strerror(err));
-  err = snd_pcm_sw_params_set_start_threshold(g_data.handle, swparams,
-      (g_data.buffer_size / g_data.period_size) * g_data.period_size);
-  Check(err >= 0, "Can't set start threshold mode for sound: ",
-      snd_strerror(err));
-  err = snd_pcm_sw_params_set_avail_min(g_data.handle, swparams,
-      g_data.period_size);
-  Check(err >= 0, "Can't set avail min for sound: ", snd_strerror(err));
-  err = snd_pcm_sw_params(g_data.handle, swparams);
-  Check(err >= 0, "Can't set sw params for sound: ", snd_strerror(err));
-
-  // start sound
-  g_data.samples.resize(g_data.period_size * 2, 0);
-  g_data.mix.resize(g_data.period_size * 2, 0);
-  g_data.tmp.resize(g_data.period_size * 2, 0);
-  err = snd_async_add_pcm_handler(&g_data.ahandler, g_data.handle,
-      SoundMixerCallback, &g_data);
-  if (err == -ENOSYS) {
-    sound_thread = std::thread(arctic::SoundMixerThreadFunction);
-  } else {
-    Check(err >= 0, "Can't register async pcm handler for sound:",
-        snd_strerror(err));
-    for (int count = 0; count < 3; count++) {
-      err = snd_pcm_writei(g_data.handle, g_data.samples.data(),
-          g_data.period_size);
-      Check(err >= 0, "Sound pcm write error: ", snd_strerror(err));
-      Check(err == g_data.period_size,
-          "Sound pcm write error: written != expected");
+    // Sleeps until the device can take a period, waking up regularly
+    // to notice quit requests and config changes.
+    int err = poll(g_data.poll_fds.data(),
+        static_cast<nfds_t>(g_data.poll_fds.size()), 100);
+    if (err == 0 || (err < 0 && errno == EINTR)) {
+      continue;
     }
-    if (snd_pcm_state(g_data.handle) == SND_PCM_STATE_PREPARED) {
-      err = snd_pcm_start(g_data.handle);
-      Check(err >= 0, "Sound pcm start error: ", snd_strerror(err));
+    if (err < 0) {
+      Log("Sound output error. Can't poll sound device: ", strerror(errno));
+      CloseSoundOutput();
+      continue;
+    }
+    unsigned short revents = 0;
+    err = snd_pcm_poll_descriptors_revents(g_data.handle,
+        g_data.poll_fds.data(),
+        static_cast<unsigned int>(g_data.poll_fds.size()), &revents);
+    if (!IsSoundOk(err, "Can't get sound poll events: ")) {
+      CloseSoundOutput();
+      continue;
+    }
+    bool is_ok = true;
+    if (revents & POLLERR) {
+      snd_pcm_state_t state = snd_pcm_state(g_data.handle);
+      if (state == SND_PCM_STATE_XRUN) {
+        is_ok = RecoverSoundOutput(-EPIPE);
+      } else if (state == SND_PCM_STATE_SUSPENDED) {
+        is_ok = RecoverSoundOutput(-ESTRPIPE);
+      } else if (state == SND_PCM_STATE_DISCONNECTED) {
+        Log("Sound output error. The sound device is disconnected.");
+        is_ok = false;
+      }
+    }
+    if (is_ok && (revents & (POLLOUT | POLLERR))) {
+      is_ok = WriteSoundOutput();
+    }
+    if (!is_ok) {
+      CloseSoundOutput();
     }
   }
+  CloseSoundOutput();
+  SetSoundThreadRealtime(false);
 }
 
-void StopSoundMixer() {
-  g_sound_mixer_state.do_quit = true;
-  sound_thread.join();
+std::thread sound_thread;
+
+void StartSoundMixer() {
+  if (getenv("ARCTIC_NO_SOUND_DEVICE")) {
+    SoundOutputConfig config = GetSoundMixer()->GetOutputConfig(nullptr);
+    config.is_device_enabled = false;
+    GetSoundMixer()->SetOutputConfig(config);
+  }
+  g_sound_mixer_do_quit = false;
+  sound_thread = std::thread(arctic::SoundMixerThreadFunction);
+}
 
-  if (g_data.ahandler) {
-    int err = snd_async_del_handler(g_data.ahandler);
-    Check(err >= 0, "Can't delete async sound handler", snd_strerror(err));
+void StopSoundMixer() {
+  g_sound_mixer_do_quit = true;
+  if (sound_thread.joinable()) {
+    sound_thread.join();
   }
-  snd_pcm_close(g_data.handle);
 }
 
 Trivalent DoesDirectoryExist(const char *path) {
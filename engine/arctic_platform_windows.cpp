@@ -48,6 +48,7 @@
 #include "engine/engine.h"
 #include "engine/easy.h"
 #include "engine/arctic_input.h"
+#include "engine/arctic_mixer.h"
 #include "engine/arctic_platform.h"
 #include "engine/byte_array.h"
 #include "engine/log.h"
@@ -546,55 +547,6 @@ bool CreateMainWindow(HINSTANCE instance_handle, int cmd_show,
   return true;
 }
 
-static std::mutex g_sound_mixer_mutex;
-struct SoundBuffer {
-  easy::Sound sound;
-  float volume = 1.0f;
-  Si32 next_position = 0;
-};
-struct SoundMixerState {
-  float master_volume = 0.7f;
-  std::vector<SoundBuffer> buffers;
-};
-SoundMixerState g_sound_mixer_state;
-
-void StartSoundBuffer(easy::Sound sound, float volume) {
-  SoundBuffer buffer;
-  buffer.sound = sound;
-  buffer.volume = volume;
-  buffer.next_position = 0;
-  buffer.sound.GetInstance()->IncPlaying();
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  g_sound_mixer_state.buffers.push_back(buffer);
-}
-
-void StopSoundBuffer(easy::Sound sound) {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  for (size_t idx = 0; idx < g_sound_mixer_state.buffers.size(); ++idx) {
-    SoundBuffer &buffer = g_sound_mixer_state.buffers[idx];
-    if (buffer.sound.GetInstance() == sound.GetInstance()) {
-      buffer.sound.GetInstance()->DecPlaying();
-      if (idx != g_sound_mixer_state.buffers.size() - 1) {
-        g_sound_mixer_state.buffers[idx] =
-          g_sound_mixer_state.buffers[
-            g_sound_mixer_state.buffers.size() - 1];
-      }
-      g_sound_mixer_state.buffers.pop_back();
-      idx--;
-    }
-  }
-}
-
-void SetMasterVolume(float volume) {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  g_sound_mixer_state.master_volume = volume;
-}
-
-float GetMasterVolume() {
-  std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-  return g_sound_mixer_state.master_volume;
-}
-
 void SoundMixerThreadFunction() {
   Si32 bytes_per_sample = 2;
 
@@ -623,9 +575,6 @@ void SoundMixerThreadFunction() {
 
   std::vector<WAVEHDR> wave_headers(buffer_count);
   std::vector<std::vector<Si16>> wave_buffers(buffer_count);
-  std::vector<Si16> tmp(buffer_samples_total);
-  std::vector<Si32> mix(buffer_samples_total);
-  memset(&(mix[0]), 0, 2 * buffer_bytes);
   for (Ui32 i = 0; i < wave_headers.size(); ++i) {
     wave_buffers[i].resize(buffer_samples_total);
     memset(&(wave_buffers[i][0]), 0, buffer_bytes);
@@ -638,6 +587,9 @@ void SoundMixerThreadFunction() {
     wave_headers[i].dwFlags = WHDR_DONE;
   }
   Check(result == MMSYSERR_NOERROR, "Error in SoundMixerThreadFunction");
+  GetSoundMixer()->ReportOutputFormat(
+    static_cast<Si32>(buffer_samples_per_channel),
+    static_cast<Si32>(buffer_samples_per_channel * buffer_count), false);
 
   int cur_buffer_idx = 0;
   bool do_continue = true;
@@ -658,44 +610,8 @@ void SoundMixerThreadFunction() {
     waveOutPrepareHeader(wave_out_handle,
       &wave_headers[cur_buffer_idx], sizeof(WAVEHDR));
 
-    float master_volume = 1.0f;
-    {
-      memset(mix.data(), 0, 2 * buffer_bytes);
-      std::lock_guard<std::mutex> lock(g_sound_mixer_mutex);
-      master_volume = g_sound_mixer_state.master_volume;
-      for (Ui32 idx = 0;
-        idx < g_sound_mixer_state.buffers.size(); ++idx) {
-        SoundBuffer &sound = g_sound_mixer_state.buffers[idx];
-
-        Ui32 size = buffer_samples_per_channel;
-        size = sound.sound.StreamOut(sound.next_position, size,
-          tmp.data(), buffer_samples_total);
-        Si16 *in_data = tmp.data();
-        for (Ui32 i = 0; i < size; ++i) {
-          mix[i * 2] += static_cast<Si32>(
-            static_cast<float>(in_data[i * 2]) * sound.volume);
-          mix[i * 2 + 1] += static_cast<Si32>(
-            static_cast<float>(in_data[i * 2 + 1]) * sound.volume);
-          ++sound.next_position;
-        }
-
-        if (sound.next_position == sound.sound.DurationSamples()
-          || size == 0) {
-          sound.sound.GetInstance()->DecPlaying();
-          g_sound_mixer_state.buffers[idx] =
-            g_sound_mixer_state.buffers[
-              g_sound_mixer_state.buffers.size() - 1];
-          g_sound_mixer_state.buffers.pop_back();
-          --idx;
-        }
-      }
-    }
-
     Si16* out_data = &(wave_buffers[cur_buffer_idx][0]);
-    for (Ui32 i = 0; i < buffer_samples_total; ++i) {
-      out_data[i] = static_cast<Si16>(Clamp(
-        static_cast<float>(mix[i]) * master_volume, -32767.0, 32767.0));
-    }
+    GetSoundMixer()->Mix(buffer_samples_per_channel, out_data);
 
     waveOutWrite(wave_out_handle,
       &wave_headers[cur_buffer_idx], sizeof(WAVEHDR));
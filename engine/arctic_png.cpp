@@ -0,0 +1,518 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_png.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "engine/arctic_inflate.h"
+#include "engine/arctic_pixel_convert.h"
+#include "engine/arctic_platform.h"
+#include "engine/arctic_simd.h"
+
+namespace arctic {
+
+static const Ui8 kPngSignature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+enum PngColorType {
+  kPngGrey = 0,
+  kPngRgb = 2,
+  kPngIndexed = 3,
+  kPngGreyAlpha = 4,
+  kPngRgba = 6
+};
+
+struct PngPass {
+  Si32 x;
+  Si32 y;
+  Si32 step_x;
+  Si32 step_y;
+};
+
+static const PngPass kPngWhole[1] = {{0, 0, 1, 1}};
+static const PngPass kPngAdam7[7] = {
+  {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+  {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+
+inline Ui32 ReadPngUi32(const Ui8 *p) {
+  return (static_cast<Ui32>(p[0]) << 24) | (static_cast<Ui32>(p[1]) << 16) |
+    (static_cast<Ui32>(p[2]) << 8) | static_cast<Ui32>(p[3]);
+}
+
+inline Ui8 PaethPredictor(Si32 a, Si32 b, Si32 c) {
+  const Si32 pa = std::abs(b - c);
+  const Si32 pb = std::abs(a - c);
+  const Si32 pc = std::abs(a + b - 2 * c);
+  if (pa <= pb && pa <= pc) {
+    return static_cast<Ui8>(a);
+  }
+  return static_cast<Ui8>(pb <= pc ? b : c);
+}
+
+#if defined(ARCTIC_SIMD_SSE2)
+// The sub, average and paeth filters depend on the pixel to the left, so
+// the 3 and 4 byte per pixel versions work on one pixel per register.
+inline __m128i LoadPngPixel(const Ui8 *p, Si32 bpp) {
+  Ui32 value = 0;
+  std::memcpy(&value, p, bpp);
+  return _mm_cvtsi32_si128(static_cast<int>(value));
+}
+
+inline void StorePngPixel(Ui8 *p, __m128i value, Si32 bpp) {
+  const Ui32 pixel = static_cast<Ui32>(_mm_cvtsi128_si32(value));
+  std::memcpy(p, &pixel, bpp);
+}
+
+static void UnfilterSubSse2(Ui8 *row, Si64 size, Si32 bpp) {
+  __m128i a = _mm_setzero_si128();
+  for (Si64 x = 0; x < size; x += bpp) {
+    a = _mm_add_epi8(a, LoadPngPixel(row + x, bpp));
+    StorePngPixel(row + x, a, bpp);
+  }
+}
+
+static void UnfilterAverageSse2(Ui8 *row, const Ui8 *prev, Si64 size,
+    Si32 bpp) {
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128();
+  for (Si64 x = 0; x < size; x += bpp) {
+    const __m128i b = LoadPngPixel(prev + x, bpp);
+    // avg_epu8 rounds up, the filter rounds down.
+    __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b),
+      _mm_and_si128(_mm_xor_si128(a, b), one));
+    a = _mm_add_epi8(LoadPngPixel(row + x, bpp), average);
+    StorePngPixel(row + x, a, bpp);
+  }
+}
+
+inline __m128i AbsEpi16(__m128i value) {
+  return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+}
+
+inline __m128i SelectEpi16(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void UnfilterPaethSse2(Ui8 *row, const Ui8 *prev, Si64 size,
+    Si32 bpp) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = zero;
+  __m128i c = zero;
+  for (Si64 x = 0; x < size; x += bpp) {
+    const __m128i b = _mm_unpacklo_epi8(LoadPngPixel(prev + x, bpp), zero);
+    __m128i d = _mm_unpacklo_epi8(LoadPngPixel(row + x, bpp), zero);
+    const __m128i pa_signed = _mm_sub_epi16(b, c);
+    const __m128i pb_signed = _mm_sub_epi16(a, c);
+    const __m128i pa = AbsEpi16(pa_signed);
+    const __m128i pb = AbsEpi16(pb_signed);
+    const __m128i pc = AbsEpi16(_mm_add_epi16(pa_signed, pb_signed));
+    const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    const __m128i nearest = SelectEpi16(_mm_cmpeq_epi16(smallest, pa), a,
+      SelectEpi16(_mm_cmpeq_epi16(smallest, pb), b, c));
+    // Adds bytewise so the sum wraps like the scalar filter.
+    d = _mm_and_si128(_mm_add_epi8(d, nearest), _mm_set1_epi16(0xff));
+    StorePngPixel(row + x, _mm_packus_epi16(d, d), bpp);
+    c = b;
+    a = d;
+  }
+}
+#endif
+
+// Undoes the filter of one line in place, prev is the line above after
+// unfiltering, or zeros for the first line of a pass.
+static void UnfilterPngRow(Si32 filter, Ui8 *row, const Ui8 *prev,
+    Si64 size, Si32 bpp) {
+  switch (filter) {
+    case 0:
+      return;
+    case 1:
+#if defined(ARCTIC_SIMD_SSE2)
+      if (bpp == 3 || bpp == 4) {
+        UnfilterSubSse2(row, size, bpp);
+        return;
+      }
+#endif
+      for (Si64 x = bpp; x < size; ++x) {
+        row[x] = static_cast<Ui8>(row[x] + row[x - bpp]);
+      }
+      return;
+    case 2: {
+      Si64 x = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+      for (; x + 16 <= size; x += 16) {
+        __m128i sum = _mm_add_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + x)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), sum);
+      }
+#elif defined(ARCTIC_SIMD_NEON)
+      for (; x + 16 <= size; x += 16) {
+        vst1q_u8(row + x, vaddq_u8(vld1q_u8(row + x), vld1q_u8(prev + x)));
+      }
+#endif
+      for (; x < size; ++x) {
+        row[x] = static_cast<Ui8>(row[x] + prev[x]);
+      }
+      return;
+    }
+    case 3:
+#if defined(ARCTIC_SIMD_SSE2)
+      if (bpp == 3 || bpp == 4) {
+        UnfilterAverageSse2(row, prev, size, bpp);
+        return;
+      }
+#endif
+      for (Si64 x = 0; x < bpp; ++x) {
+        row[x] = static_cast<Ui8>(row[x] + (prev[x] >> 1));
+      }
+      for (Si64 x = bpp; x < size; ++x) {
+        row[x] = static_cast<Ui8>(row[x] + ((row[x - bpp] + prev[x]) >> 1));
+      }
+      return;
+    case 4:
+#if defined(ARCTIC_SIMD_SSE2)
+      if (bpp == 3 || bpp == 4) {
+        UnfilterPaethSse2(row, prev, size, bpp);
+        return;
+      }
+#endif
+      for (Si64 x = 0; x < bpp; ++x) {
+        row[x] = static_cast<Ui8>(row[x] + prev[x]);
+      }
+      for (Si64 x = bpp; x < size; ++x) {
+        row[x] = static_cast<Ui8>(row[x] +
+          PaethPredictor(row[x - bpp], prev[x], prev[x - bpp]));
+      }
+      return;
+    default:
+      Fatal("Error in LoadPng, unknown filter type.");
+  }
+}
+
+class PngDecoder {
+ public:
+  void ReadHeader(const Ui8 *p, Ui32 length) {
+    Check(length == 13, "Error in LoadPng, bad IHDR size.");
+    const Ui32 width = ReadPngUi32(p);
+    const Ui32 height = ReadPngUi32(p + 4);
+    Check(width > 0 && height > 0 && width < 65536 && height < 65536,
+      "Error in LoadPng, unsupported image size.");
+    width_ = static_cast<Si32>(width);
+    height_ = static_cast<Si32>(height);
+    depth_ = p[8];
+    color_type_ = p[9];
+    Check(p[10] == 0 && p[11] == 0,
+      "Error in LoadPng, unknown compression or filter method.");
+    Check(p[12] <= 1, "Error in LoadPng, unknown interlace method.");
+    is_interlaced_ = p[12] == 1;
+    switch (color_type_) {
+      case kPngGrey:
+        channels_ = 1;
+        Check(depth_ == 1 || depth_ == 2 || depth_ == 4 || depth_ == 8 ||
+          depth_ == 16, "Error in LoadPng, bad bit depth.");
+        break;
+      case kPngIndexed:
+        channels_ = 1;
+        Check(depth_ == 1 || depth_ == 2 || depth_ == 4 || depth_ == 8,
+          "Error in LoadPng, bad bit depth.");
+        break;
+      case kPngRgb:
+      case kPngGreyAlpha:
+      case kPngRgba:
+        channels_ = (color_type_ == kPngRgb ? 3 :
+          (color_type_ == kPngRgba ? 4 : 2));
+        Check(depth_ == 8 || depth_ == 16, "Error in LoadPng, bad bit depth.");
+        break;
+      default:
+        Fatal("Error in LoadPng, unknown color type.");
+    }
+    bits_per_pixel_ = channels_ * depth_;
+    bytes_per_pixel_ = std::max(1, bits_per_pixel_ / 8);
+    has_alpha_ = color_type_ == kPngGreyAlpha || color_type_ == kPngRgba;
+    for (Si32 idx = 0; idx < 256; ++idx) {
+      palette_[idx] = Rgba(0, 0, 0, 255);
+    }
+  }
+
+  void ReadPalette(const Ui8 *p, Ui32 length) {
+    Check(length % 3 == 0 && length <= 256 * 3,
+      "Error in LoadPng, bad PLTE size.");
+    for (Ui32 idx = 0; idx < length / 3; ++idx) {
+      palette_[idx] = Rgba(p[idx * 3], p[idx * 3 + 1], p[idx * 3 + 2]);
+    }
+  }
+
+  void ReadTransparency(const Ui8 *p, Ui32 length) {
+    if (color_type_ == kPngIndexed) {
+      Check(length <= 256, "Error in LoadPng, bad tRNS size.");
+      for (Ui32 idx = 0; idx < length; ++idx) {
+        palette_[idx].a = p[idx];
+      }
+      has_alpha_ = true;
+    } else if (color_type_ == kPngGrey || color_type_ == kPngRgb) {
+      Check(length == static_cast<Ui32>(channels_) * 2,
+        "Error in LoadPng, bad tRNS size.");
+      for (Si32 idx = 0; idx < channels_; ++idx) {
+        key_[idx] = static_cast<Ui32>((p[idx * 2] << 8) | p[idx * 2 + 1]);
+      }
+      has_key_ = true;
+      has_alpha_ = true;
+    }
+  }
+
+  std::shared_ptr<easy::SpriteInstance> Decode(
+      const std::vector<InflateSpan> &image_data) {
+    sprite_.reset(new easy::SpriteInstance(width_, height_));
+    pixels_ = reinterpret_cast<Rgba*>(sprite_->RawData());
+    passes_ = is_interlaced_ ? kPngAdam7 : kPngWhole;
+    pass_count_ = is_interlaced_ ? 7 : 1;
+    const Si64 max_row_bytes = (static_cast<Si64>(width_) *
+      bits_per_pixel_ + 7) / 8;
+    // The filter byte, then the line.
+    row_.resize(static_cast<size_t>(max_row_bytes + 1));
+    prev_.resize(static_cast<size_t>(max_row_bytes + 1));
+    if (!is_interlaced_) {
+      spans_.resize(height_);
+    }
+    StartPass(0);
+    ZlibInflate(image_data, [this](const Ui8 *data, Si64 size) {
+      OnImageData(data, size);
+    });
+    Check(pass_ == pass_count_, "Error in LoadPng, image data is too short.");
+    if (is_interlaced_) {
+      // Lines are only complete after the last pass.
+      if (has_alpha_) {
+        sprite_->UpdateOpaqueSpans();
+        return sprite_;
+      }
+      easy::SpanSi32 whole;
+      whole.begin = 0;
+      whole.end = width_;
+      spans_.assign(height_, whole);
+    }
+    sprite_->SetOpaqueSpans(std::move(spans_));
+    return sprite_;
+  }
+
+ private:
+  void StartPass(Si32 pass) {
+    pass_ = pass;
+    for (; pass_ < pass_count_; ++pass_) {
+      const PngPass &p = passes_[pass_];
+      pass_width_ = (width_ - p.x + p.step_x - 1) / p.step_x;
+      pass_height_ = (height_ - p.y + p.step_y - 1) / p.step_y;
+      if (pass_width_ > 0 && pass_height_ > 0) {
+        break;
+      }
+    }
+    if (pass_ == pass_count_) {
+      return;
+    }
+    pass_line_ = 0;
+    row_bytes_ = (static_cast<Si64>(pass_width_) * bits_per_pixel_ + 7) / 8;
+    filled_ = 0;
+    std::fill(prev_.begin(), prev_.end(), Ui8(0));
+  }
+
+  void OnImageData(const Ui8 *data, Si64 size) {
+    while (size > 0) {
+      Check(pass_ < pass_count_, "Error in LoadPng, too much image data.");
+      const Si64 part = std::min(size, row_bytes_ + 1 - filled_);
+      std::memcpy(row_.data() + filled_, data, static_cast<size_t>(part));
+      filled_ += part;
+      data += part;
+      size -= part;
+      if (filled_ == row_bytes_ + 1) {
+        UnfilterPngRow(row_[0], row_.data() + 1, prev_.data() + 1,
+          row_bytes_, bytes_per_pixel_);
+        ConvertLine(row_.data() + 1);
+        row_.swap(prev_);
+        filled_ = 0;
+        ++pass_line_;
+        if (pass_line_ == pass_height_) {
+          StartPass(pass_ + 1);
+        }
+      }
+    }
+  }
+
+  // Reads sample idx of a line packed at depth_ bits per sample.
+  Ui32 Sample(const Ui8 *line, Si64 idx) const {
+    switch (depth_) {
+      case 16:
+        return static_cast<Ui32>((line[idx * 2] << 8) | line[idx * 2 + 1]);
+      case 8:
+        return line[idx];
+      default: {
+        const Si64 bit = idx * depth_;
+        const Si32 shift = 8 - depth_ - static_cast<Si32>(bit & 7);
+        return (line[bit >> 3] >> shift) & ((1u << depth_) - 1);
+      }
+    }
+  }
+
+  // Scales a sample to 8 bits.
+  Ui8 Scale(Ui32 sample) const {
+    if (depth_ == 16) {
+      return static_cast<Ui8>(sample >> 8);
+    }
+    return static_cast<Ui8>(sample * 255 / ((1u << depth_) - 1));
+  }
+
+  Rgba Pixel(const Ui8 *line, Si64 x) const {
+    const Si64 idx = x * channels_;
+    switch (color_type_) {
+      case kPngGrey: {
+        const Ui32 grey = Sample(line, idx);
+        const Ui8 value = Scale(grey);
+        return Rgba(value, value, value,
+          (has_key_ && grey == key_[0]) ? 0 : 255);
+      }
+      case kPngRgb: {
+        const Ui32 r = Sample(line, idx);
+        const Ui32 g = Sample(line, idx + 1);
+        const Ui32 b = Sample(line, idx + 2);
+        const bool is_key = has_key_ && r == key_[0] && g == key_[1] &&
+          b == key_[2];
+        return Rgba(Scale(r), Scale(g), Scale(b), is_key ? 0 : 255);
+      }
+      case kPngIndexed:
+        return palette_[Sample(line, idx)];
+      case kPngGreyAlpha: {
+        const Ui8 value = Scale(Sample(line, idx));
+        return Rgba(value, value, value, Scale(Sample(line, idx + 1)));
+      }
+      default:
+        return Rgba(Scale(Sample(line, idx)), Scale(Sample(line, idx + 1)),
+          Scale(Sample(line, idx + 2)), Scale(Sample(line, idx + 3)));
+    }
+  }
+
+  void ConvertLine(const Ui8 *line) {
+    const PngPass &p = passes_[pass_];
+    // PNG stores the top line first, sprites the bottom one.
+    const Si32 y = height_ - 1 - (p.y + pass_line_ * p.step_y);
+    Rgba *to = pixels_ + static_cast<Si64>(y) * width_ + p.x;
+    const Si32 count = pass_width_;
+    if (p.step_x == 1 && depth_ == 8 && color_type_ == kPngRgba) {
+      std::memcpy(static_cast<void*>(to), line,
+        static_cast<size_t>(count) * sizeof(Rgba));
+    } else if (p.step_x == 1 && depth_ == 8 && color_type_ == kPngRgb &&
+        !has_key_) {
+      ExpandRgbToRgba(line, count, reinterpret_cast<Ui8*>(to));
+    } else if (depth_ == 8 && color_type_ == kPngIndexed) {
+      for (Si32 x = 0; x < count; ++x) {
+        to[x * p.step_x] = palette_[line[x]];
+      }
+    } else {
+      for (Si32 x = 0; x < count; ++x) {
+        to[x * p.step_x] = Pixel(line, x);
+      }
+    }
+    if (!is_interlaced_) {
+      // The line is still in the cache, so its span costs little here.
+      if (has_alpha_) {
+        spans_[y] = easy::FindOpaqueSpan(to, width_);
+      } else {
+        spans_[y].begin = 0;
+        spans_[y].end = width_;
+      }
+    }
+  }
+
+  Si32 width_ = 0;
+  Si32 height_ = 0;
+  Si32 depth_ = 0;
+  Si32 color_type_ = 0;
+  Si32 channels_ = 0;
+  Si32 bits_per_pixel_ = 0;
+  Si32 bytes_per_pixel_ = 0;
+  bool is_interlaced_ = false;
+  bool has_alpha_ = false;
+  bool has_key_ = false;
+  Ui32 key_[3] = {0, 0, 0};
+  Rgba palette_[256];
+
+  std::shared_ptr<easy::SpriteInstance> sprite_;
+  Rgba *pixels_ = nullptr;
+  std::vector<easy::SpanSi32> spans_;
+  const PngPass *passes_ = nullptr;
+  Si32 pass_count_ = 0;
+  Si32 pass_ = 0;
+  Si32 pass_width_ = 0;
+  Si32 pass_height_ = 0;
+  Si32 pass_line_ = 0;
+  Si64 row_bytes_ = 0;
+  Si64 filled_ = 0;
+  std::vector<Ui8> row_;
+  std::vector<Ui8> prev_;
+};
+
+std::shared_ptr<easy::SpriteInstance> LoadPng(const Ui8 *data,
+    const Si64 size) {
+  Check(size >= 8 && std::memcmp(data, kPngSignature, 8) == 0,
+    "Error in LoadPng, not a PNG file.");
+  PngDecoder decoder;
+  std::vector<InflateSpan> image_data;
+  bool has_header = false;
+  bool has_end = false;
+  const Ui8 *p = data + 8;
+  const Ui8 *end = data + size;
+  // Chunk CRCs are not verified.
+  while (!has_end) {
+    Check(end - p >= 12, "Error in LoadPng, unexpected end of file.");
+    const Ui32 length = ReadPngUi32(p);
+    const Ui8 *type = p + 4;
+    const Ui8 *chunk = p + 8;
+    Check(length <= static_cast<Ui64>(end - chunk - 4),
+      "Error in LoadPng, unexpected end of file.");
+    if (std::memcmp(type, "IHDR", 4) == 0) {
+      decoder.ReadHeader(chunk, length);
+      has_header = true;
+    } else {
+      Check(has_header, "Error in LoadPng, IHDR is not the first chunk.");
+      if (std::memcmp(type, "PLTE", 4) == 0) {
+        decoder.ReadPalette(chunk, length);
+      } else if (std::memcmp(type, "tRNS", 4) == 0) {
+        decoder.ReadTransparency(chunk, length);
+      } else if (std::memcmp(type, "IDAT", 4) == 0) {
+        InflateSpan span;
+        span.data = chunk;
+        span.size = length;
+        image_data.push_back(span);
+      } else if (std::memcmp(type, "IEND", 4) == 0) {
+        has_end = true;
+      } else {
+        // Ancillary chunks have a lowercase first letter and can be skipped.
+        Check((type[0] & 32) != 0, "Error in LoadPng, unknown critical chunk.");
+      }
+    }
+    p = chunk + length + 4;
+  }
+  Check(!image_data.empty(), "Error in LoadPng, no image data.");
+  return decoder.Decode(image_data);
+}
+
+}  // namespace arctic
@@ -0,0 +1,101 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_simd.h"
+
+#include "engine/arctic_types.h"
+
+#if defined(ARCTIC_SIMD_SSE2)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace arctic {
+
+#if defined(ARCTIC_SIMD_SSE2)
+static void Cpuid(Ui32 leaf, Ui32 subleaf, Ui32 *regs) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int idx = 0; idx < 4; ++idx) {
+    regs[idx] = static_cast<Ui32>(info[idx]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static bool DetectAvx2() {
+  Ui32 regs[4];
+  Cpuid(0, 0, regs);
+  if (regs[0] < 7) {
+    return false;
+  }
+  Cpuid(1, 0, regs);
+  // The OS has to save the ymm registers, which xgetbv reports.
+  const bool has_osxsave = (regs[2] & (1u << 27)) != 0;
+  const bool has_avx = (regs[2] & (1u << 28)) != 0;
+  if (!has_osxsave || !has_avx) {
+    return false;
+  }
+#if defined(_MSC_VER)
+  const Ui64 xcr0 = _xgetbv(0);
+#else
+  Ui32 eax = 0;
+  Ui32 edx = 0;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  const Ui64 xcr0 = (static_cast<Ui64>(edx) << 32) | eax;
+#endif
+  if ((xcr0 & 6) != 6) {
+    return false;
+  }
+  Cpuid(7, 0, regs);
+  return (regs[1] & (1u << 5)) != 0;
+}
+
+bool CpuHasSsse3() {
+  static const bool has_ssse3 = [] {
+    Ui32 regs[4];
+    Cpuid(1, 0, regs);
+    return (regs[2] & (1u << 9)) != 0;
+  }();
+  return has_ssse3;
+}
+
+bool CpuHasAvx2() {
+  static const bool has_avx2 = DetectAvx2();
+  return has_avx2;
+}
+#else
+bool CpuHasSsse3() {
+  return false;
+}
+
+bool CpuHasAvx2() {
+  return false;
+}
+#endif
+
+}  // namespace arctic
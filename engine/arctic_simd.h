@@ -0,0 +1,57 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_SIMD_H_
+#define ENGINE_ARCTIC_SIMD_H_
+
+// Instruction sets every CPU of the target has, so the kernels that use
+// them need no runtime check. Each kernel keeps a plain C++ fallback.
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARCTIC_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ARCTIC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Newer x86 instruction sets are used by kernels marked with these
+// attributes, and only after a CpuHas check at runtime.
+#if defined(ARCTIC_SIMD_SSE2)
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define ARCTIC_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define ARCTIC_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ARCTIC_TARGET_SSSE3
+#define ARCTIC_TARGET_AVX2
+#endif
+#endif
+
+namespace arctic {
+
+bool CpuHasSsse3();
+bool CpuHasAvx2();
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_SIMD_H_
@@ -0,0 +1,231 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_sound_convert.h"
+
+#include <cmath>
+
+#include "engine/arctic_simd.h"
+
+namespace arctic {
+
+static const float kS16Scale = 32767.0f;
+// Maps the sum of two 16-bit uniform values to a -1 to 1 LSB triangle.
+static const float kDitherScale = 1.0f / 65536.0f;
+
+inline Ui32 NextDither(Ui32 *state) {
+  Ui32 x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+inline Si16 FloatToS16(float value, Ui32 *dither_state) {
+  const Ui32 noise = NextDither(dither_state);
+  const float dither = static_cast<float>(
+    static_cast<Si32>((noise & 0xffff) + (noise >> 16)) - 65535) *
+    kDitherScale;
+  float scaled = value * kS16Scale + dither;
+  scaled = scaled < -32768.0f ? -32768.0f :
+    (scaled > 32767.0f ? 32767.0f : scaled);
+  return static_cast<Si16>(std::lrint(scaled));
+}
+
+void ConvertU8ToS16(const Ui8 *in, Si32 count, Si16 *out) {
+  Si32 i = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  // (x - 128) << 8 is x << 8 with the top bit flipped.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i sign = _mm_set1_epi16(static_cast<short>(0x8000));
+  for (; i + 16 <= count; i += 16) {
+    __m128i in16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+      _mm_xor_si128(_mm_unpacklo_epi8(zero, in16), sign));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+      _mm_xor_si128(_mm_unpackhi_epi8(zero, in16), sign));
+  }
+#elif defined(ARCTIC_SIMD_NEON)
+  const uint16x8_t sign = vdupq_n_u16(0x8000);
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t in16 = vld1q_u8(in + i);
+    vst1q_s16(out + i, vreinterpretq_s16_u16(
+      veorq_u16(vshll_n_u8(vget_low_u8(in16), 8), sign)));
+    vst1q_s16(out + i + 8, vreinterpretq_s16_u16(
+      veorq_u16(vshll_n_u8(vget_high_u8(in16), 8), sign)));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = static_cast<Si16>((static_cast<Si32>(in[i]) - 128) * 256);
+  }
+}
+
+void ExpandMonoToStereo(const Si16 *in, Si32 frames, Si16 *out) {
+  // Goes from the end, so in place expansion never overwrites samples
+  // that are not read yet.
+  Si32 i = frames;
+#if defined(ARCTIC_SIMD_SSE2) || defined(ARCTIC_SIMD_NEON)
+  const Si32 vector_frames = frames - frames % 8;
+  for (; i > vector_frames; --i) {
+    const Si16 value = in[i - 1];
+    out[i * 2 - 2] = value;
+    out[i * 2 - 1] = value;
+  }
+  for (; i >= 8; i -= 8) {
+#if defined(ARCTIC_SIMD_SSE2)
+    __m128i in8 = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(in + i - 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 - 16),
+      _mm_unpacklo_epi16(in8, in8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2 - 8),
+      _mm_unpackhi_epi16(in8, in8));
+#else
+    int16x8_t in8 = vld1q_s16(in + i - 8);
+    int16x8x2_t pairs = vzipq_s16(in8, in8);
+    vst1q_s16(out + i * 2 - 16, pairs.val[0]);
+    vst1q_s16(out + i * 2 - 8, pairs.val[1]);
+#endif
+  }
+#endif
+  for (; i > 0; --i) {
+    const Si16 value = in[i - 1];
+    out[i * 2 - 2] = value;
+    out[i * 2 - 1] = value;
+  }
+}
+
+#if defined(ARCTIC_SIMD_SSE2)
+// Four lanes of the same xorshift generator, returns the dither in LSB.
+inline __m128 NextDither4(__m128i *state) {
+  __m128i x = *state;
+  x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+  x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+  x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+  *state = x;
+  __m128i sum = _mm_add_epi32(_mm_and_si128(x, _mm_set1_epi32(0xffff)),
+    _mm_srli_epi32(x, 16));
+  return _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(sum,
+    _mm_set1_epi32(65535))), _mm_set1_ps(kDitherScale));
+}
+
+inline __m128i ScaleToS32(__m128 value, __m128 dither) {
+  const __m128 scaled = _mm_add_ps(_mm_mul_ps(value,
+    _mm_set1_ps(kS16Scale)), dither);
+  return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(scaled,
+    _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f)));
+}
+#elif defined(ARCTIC_SIMD_NEON)
+inline float32x4_t NextDither4(uint32x4_t *state) {
+  uint32x4_t x = *state;
+  x = veorq_u32(x, vshlq_n_u32(x, 13));
+  x = veorq_u32(x, vshrq_n_u32(x, 17));
+  x = veorq_u32(x, vshlq_n_u32(x, 5));
+  *state = x;
+  int32x4_t sum = vreinterpretq_s32_u32(vaddq_u32(
+    vandq_u32(x, vdupq_n_u32(0xffff)), vshrq_n_u32(x, 16)));
+  return vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(sum, vdupq_n_s32(65535))),
+    kDitherScale);
+}
+
+inline int32x4_t ScaleToS32(float32x4_t value, float32x4_t dither) {
+  float32x4_t scaled = vmlaq_n_f32(dither, value, kS16Scale);
+  scaled = vminq_f32(vmaxq_f32(scaled, vdupq_n_f32(-32768.0f)),
+    vdupq_n_f32(32767.0f));
+  // vcvtq truncates, so round half away from zero first.
+  const float32x4_t half = vbslq_f32(vcltq_f32(scaled, vdupq_n_f32(0.0f)),
+    vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+  return vcvtq_s32_f32(vaddq_f32(scaled, half));
+}
+#endif
+
+void ConvertFloatToS16(const float *const *channels, Si32 channel_count,
+    Si32 frames, Si16 *out, Ui32 *dither_state) {
+  Si32 i = 0;
+  if (*dither_state == 0) {
+    *dither_state = 0x9e3779b9u;
+  }
+#if defined(ARCTIC_SIMD_SSE2) || defined(ARCTIC_SIMD_NEON)
+  if (channel_count == 1 || channel_count == 2) {
+    // Lanes start from different states of the scalar generator.
+    Ui32 seeds[4];
+    for (Si32 lane = 0; lane < 4; ++lane) {
+      seeds[lane] = NextDither(dither_state);
+    }
+#if defined(ARCTIC_SIMD_SSE2)
+    __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seeds));
+    if (channel_count == 1) {
+      const float *left = channels[0];
+      for (; i + 8 <= frames; i += 8) {
+        __m128i low = ScaleToS32(_mm_loadu_ps(left + i), NextDither4(&state));
+        __m128i high = ScaleToS32(_mm_loadu_ps(left + i + 4),
+          NextDither4(&state));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+          _mm_packs_epi32(low, high));
+      }
+    } else {
+      const float *left = channels[0];
+      const float *right = channels[1];
+      for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        __m128i low = ScaleToS32(_mm_unpacklo_ps(l, r), NextDither4(&state));
+        __m128i high = ScaleToS32(_mm_unpackhi_ps(l, r),
+          NextDither4(&state));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 2),
+          _mm_packs_epi32(low, high));
+      }
+    }
+#else
+    uint32x4_t state = vld1q_u32(seeds);
+    if (channel_count == 1) {
+      const float *left = channels[0];
+      for (; i + 8 <= frames; i += 8) {
+        int32x4_t low = ScaleToS32(vld1q_f32(left + i), NextDither4(&state));
+        int32x4_t high = ScaleToS32(vld1q_f32(left + i + 4),
+          NextDither4(&state));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+      }
+    } else {
+      const float *left = channels[0];
+      const float *right = channels[1];
+      for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t pairs = vzipq_f32(vld1q_f32(left + i),
+          vld1q_f32(right + i));
+        int32x4_t low = ScaleToS32(pairs.val[0], NextDither4(&state));
+        int32x4_t high = ScaleToS32(pairs.val[1], NextDither4(&state));
+        vst1q_s16(out + i * 2,
+          vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+      }
+    }
+#endif
+  }
+#endif
+  for (; i < frames; ++i) {
+    for (Si32 channel = 0; channel < channel_count; ++channel) {
+      out[i * channel_count + channel] =
+        FloatToS16(channels[channel][i], dither_state);
+    }
+  }
+}
+
+}  // namespace arctic
@@ -0,0 +1,49 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_SOUND_CONVERT_H_
+#define ENGINE_ARCTIC_SOUND_CONVERT_H_
+
+#include "engine/arctic_types.h"
+
+namespace arctic {
+
+// Sample format converters for the sound loaders, vectorized where the
+// target has SIMD.
+
+// Converts unsigned 8-bit samples, as stored in WAV files, to Si16.
+void ConvertU8ToS16(const Ui8 *in, Si32 count, Si16 *out);
+
+// Duplicates every mono sample into a stereo frame. Works in place when
+// out == in and the buffer has room for frames * 2 samples.
+void ExpandMonoToStereo(const Si16 *in, Si32 frames, Si16 *out);
+
+// Interleaves planar float channels in the -1 to 1 range into Si16 frames,
+// adding triangular dither of 1 LSB to hide the rounding error.
+// dither_state carries the noise generator between calls, any nonzero
+// value is a valid seed.
+void ConvertFloatToS16(const float *const *channels, Si32 channel_count,
+  Si32 frames, Si16 *out, Ui32 *dither_state);
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_SOUND_CONVERT_H_
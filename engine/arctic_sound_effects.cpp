@@ -0,0 +1,294 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/arctic_sound_effects.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "engine/arctic_platform.h"
+
+namespace arctic {
+
+static const float kSampleRate = 44100.0f;
+static const float kFullScale = 32767.0f;
+static const float kPi = 3.14159265358979f;
+// Frames the compressor keeps its gain ramp for, 0.36 ms.
+static const Si32 kGainStepFrames = 16;
+
+// Values this small would turn into denormals and slow the filters down.
+inline float FlushDenormal(float value) {
+  return std::fabs(value) < 1e-15f ? 0.0f : value;
+}
+
+inline float DecibelsToGain(float db) {
+  return std::pow(10.0f, db / 20.0f);
+}
+
+inline float TimeToCoefficient(float time_s) {
+  if (time_s <= 0.0f) {
+    return 0.0f;
+  }
+  return std::exp(-1.0f / (time_s * kSampleRate));
+}
+
+BiquadFilter::BiquadFilter(BiquadFilterType type, float cutoff_hz, float q)
+    : type_(type)
+    , cutoff_hz_(cutoff_hz)
+    , q_(q)
+    , is_dirty_(true) {
+}
+
+void BiquadFilter::SetCutoff(float cutoff_hz) {
+  cutoff_hz_ = cutoff_hz;
+  is_dirty_ = true;
+}
+
+void BiquadFilter::SetQ(float q) {
+  q_ = q;
+  is_dirty_ = true;
+}
+
+void BiquadFilter::UpdateCoefficients() {
+  const float cutoff = std::min(std::max(cutoff_hz_.load(), 10.0f),
+    kSampleRate * 0.49f);
+  const float q = std::max(q_.load(), 0.01f);
+  const float w0 = 2.0f * kPi * cutoff / kSampleRate;
+  const float cos_w0 = std::cos(w0);
+  const float alpha = std::sin(w0) / (2.0f * q);
+  const float a0 = 1.0f + alpha;
+  if (type_ == kBiquadLowPass) {
+    b0_ = (1.0f - cos_w0) * 0.5f / a0;
+    b1_ = (1.0f - cos_w0) / a0;
+  } else {
+    b0_ = (1.0f + cos_w0) * 0.5f / a0;
+    b1_ = -(1.0f + cos_w0) / a0;
+  }
+  b2_ = b0_;
+  a1_ = -2.0f * cos_w0 / a0;
+  a2_ = (1.0f - alpha) / a0;
+}
+
+void BiquadFilter::Process(float *samples, Si32 frames) {
+  if (is_dirty_.exchange(false)) {
+    UpdateCoefficients();
+  }
+  const float b0 = b0_;
+  const float b1 = b1_;
+  const float b2 = b2_;
+  const float a1 = a1_;
+  const float a2 = a2_;
+  for (Si32 channel = 0; channel < 2; ++channel) {
+    float z1 = z1_[channel];
+    float z2 = z2_[channel];
+    float *sample = samples + channel;
+    for (Si32 i = 0; i < frames; ++i) {
+      const float x = *sample;
+      const float y = b0 * x + z1;
+      z1 = b1 * x - a1 * y + z2;
+      z2 = b2 * x - a2 * y;
+      *sample = y;
+      sample += 2;
+    }
+    z1_[channel] = FlushDenormal(z1);
+    z2_[channel] = FlushDenormal(z2);
+  }
+}
+
+Compressor::Compressor(float threshold_db, float ratio, float attack_s,
+    float release_s, float makeup_db)
+    : threshold_db_(threshold_db)
+    , ratio_(ratio)
+    , attack_s_(attack_s)
+    , release_s_(release_s)
+    , makeup_db_(makeup_db)
+    , is_dirty_(true) {
+}
+
+void Compressor::SetThreshold(float threshold_db) {
+  threshold_db_ = threshold_db;
+  is_dirty_ = true;
+}
+
+void Compressor::SetRatio(float ratio) {
+  ratio_ = ratio;
+  is_dirty_ = true;
+}
+
+void Compressor::SetMakeupGain(float makeup_db) {
+  makeup_db_ = makeup_db;
+  is_dirty_ = true;
+}
+
+void Compressor::UpdateCoefficients() {
+  threshold_ = kFullScale * DecibelsToGain(threshold_db_.load());
+  const float ratio = ratio_.load();
+  exponent_ = (ratio <= 0.0f ? -1.0f : 1.0f / std::max(ratio, 1.0f) - 1.0f);
+  attack_ = TimeToCoefficient(attack_s_.load());
+  release_ = TimeToCoefficient(release_s_.load());
+  makeup_ = DecibelsToGain(makeup_db_.load());
+}
+
+void Compressor::Process(float *samples, Si32 frames) {
+  if (is_dirty_.exchange(false)) {
+    UpdateCoefficients();
+  }
+  const float threshold = threshold_;
+  const float exponent = exponent_;
+  const float attack = attack_;
+  const float release = release_;
+  const float makeup = makeup_;
+  float envelope = envelope_;
+  if (exponent == -1.0f) {
+    // A limiter must hold every sample under the threshold, so it takes
+    // the exact gain per sample, which costs only a division.
+    for (Si32 i = 0; i < frames; ++i) {
+      float *frame = samples + i * 2;
+      const float peak = std::max(std::fabs(frame[0]), std::fabs(frame[1]));
+      const float coefficient = (peak > envelope ? attack : release);
+      envelope = peak + coefficient * (envelope - peak);
+      float gain = makeup;
+      if (envelope > threshold) {
+        gain *= threshold / envelope;
+      }
+      frame[0] *= gain;
+      frame[1] *= gain;
+    }
+    envelope_ = FlushDenormal(envelope);
+    return;
+  }
+  // The power law gain is computed once per step from the loudest
+  // envelope in it, the gain ramps linearly between the steps.
+  float gain = gain_;
+  for (Si32 begin = 0; begin < frames; begin += kGainStepFrames) {
+    const Si32 end = std::min(begin + kGainStepFrames, frames);
+    float step_envelope = 0.0f;
+    for (Si32 i = begin; i < end; ++i) {
+      const float *frame = samples + i * 2;
+      const float peak = std::max(std::fabs(frame[0]), std::fabs(frame[1]));
+      const float coefficient = (peak > envelope ? attack : release);
+      envelope = peak + coefficient * (envelope - peak);
+      step_envelope = std::max(step_envelope, envelope);
+    }
+    float target_gain = makeup;
+    if (step_envelope > threshold) {
+      target_gain *= std::pow(step_envelope / threshold, exponent);
+    }
+    const float gain_step = (target_gain - gain) / static_cast<float>(
+      end - begin);
+    for (Si32 i = begin; i < end; ++i) {
+      gain += gain_step;
+      samples[i * 2] *= gain;
+      samples[i * 2 + 1] *= gain;
+    }
+    gain = target_gain;
+  }
+  gain_ = gain;
+  envelope_ = FlushDenormal(envelope);
+}
+
+Limiter::Limiter(float threshold_db, float release_s)
+    : Compressor(threshold_db, 0.0f, 0.0f, release_s) {
+}
+
+Reverb::Reverb(float room_size, float damping, float wet, float dry)
+    : room_size_(room_size)
+    , damping_(damping)
+    , wet_(wet)
+    , dry_(dry) {
+  // Mutually prime delays from Freeverb, the right channel is offset
+  // to decorrelate it from the left.
+  static const Si32 kCombLengths[kCombCount] = {1116, 1188, 1277, 1356};
+  static const Si32 kAllpassLengths[kAllpassCount] = {556, 441};
+  static const Si32 kStereoSpread = 23;
+  for (Si32 channel = 0; channel < 2; ++channel) {
+    for (Si32 idx = 0; idx < kCombCount; ++idx) {
+      combs_[channel][idx].buffer.assign(
+        kCombLengths[idx] + channel * kStereoSpread, 0.0f);
+    }
+    for (Si32 idx = 0; idx < kAllpassCount; ++idx) {
+      allpasses_[channel][idx].buffer.assign(
+        kAllpassLengths[idx] + channel * kStereoSpread, 0.0f);
+    }
+  }
+}
+
+void Reverb::SetRoomSize(float room_size) {
+  room_size_ = room_size;
+}
+
+void Reverb::SetDamping(float damping) {
+  damping_ = damping;
+}
+
+void Reverb::SetWet(float wet) {
+  wet_ = wet;
+}
+
+void Reverb::SetDry(float dry) {
+  dry_ = dry;
+}
+
+void Reverb::Process(float *samples, Si32 frames) {
+  const float feedback = 0.7f +
+    0.28f * std::min(std::max(room_size_.load(), 0.0f), 1.0f);
+  const float damping = std::min(std::max(damping_.load(), 0.0f), 1.0f) *
+    0.4f;
+  const float wet = wet_.load();
+  const float dry = dry_.load();
+  const float input_gain = 0.03f;
+  for (Si32 i = 0; i < frames; ++i) {
+    float *frame = samples + i * 2;
+    const float input = (frame[0] + frame[1]) * input_gain;
+    for (Si32 channel = 0; channel < 2; ++channel) {
+      float out = 0.0f;
+      for (Si32 idx = 0; idx < kCombCount; ++idx) {
+        DelayLine &comb = combs_[channel][idx];
+        const float delayed = comb.buffer[comb.index];
+        comb.filter_state = delayed + damping * (comb.filter_state - delayed);
+        comb.buffer[comb.index] = input + comb.filter_state * feedback;
+        if (++comb.index == static_cast<Si32>(comb.buffer.size())) {
+          comb.index = 0;
+        }
+        out += delayed;
+      }
+      for (Si32 idx = 0; idx < kAllpassCount; ++idx) {
+        DelayLine &allpass = allpasses_[channel][idx];
+        const float delayed = allpass.buffer[allpass.index];
+        allpass.buffer[allpass.index] = out + delayed * 0.5f;
+        out = delayed - out;
+        if (++allpass.index == static_cast<Si32>(allpass.buffer.size())) {
+          allpass.index = 0;
+        }
+      }
+      frame[channel] = frame[channel] * dry + out * wet;
+    }
+  }
+  for (Si32 channel = 0; channel < 2; ++channel) {
+    for (Si32 idx = 0; idx < kCombCount; ++idx) {
+      combs_[channel][idx].filter_state =
+        FlushDenormal(combs_[channel][idx].filter_state);
+    }
+  }
+}
+
+}  // namespace arctic
@@ -0,0 +1,139 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_ARCTIC_SOUND_EFFECTS_H_
+#define ENGINE_ARCTIC_SOUND_EFFECTS_H_
+
+#include <atomic>
+#include <vector>
+
+#include "engine/arctic_types.h"
+
+namespace arctic {
+
+// An effect in a mixer bus chain. The mixer calls Process on its own
+// thread with blocks of interleaved stereo 44100 Hz samples in the Si16
+// range, full scale is 32767. Parameter setters may be called from any
+// thread, the effect picks the new values up at the next block.
+class SoundEffect {
+ public:
+  virtual ~SoundEffect() {}
+  virtual void Process(float *samples, Si32 frames) = 0;
+};
+
+enum BiquadFilterType {
+  kBiquadLowPass,
+  kBiquadHighPass
+};
+
+// A 12 dB/octave low-pass or high-pass filter.
+class BiquadFilter : public SoundEffect {
+ private:
+  BiquadFilterType type_;
+  std::atomic<float> cutoff_hz_;
+  std::atomic<float> q_;
+  std::atomic<bool> is_dirty_;
+  float b0_ = 1.0f;
+  float b1_ = 0.0f;
+  float b2_ = 0.0f;
+  float a1_ = 0.0f;
+  float a2_ = 0.0f;
+  // Transposed direct form II state, per channel.
+  float z1_[2] = {0.0f, 0.0f};
+  float z2_[2] = {0.0f, 0.0f};
+
+  void UpdateCoefficients();
+
+ public:
+  BiquadFilter(BiquadFilterType type, float cutoff_hz, float q = 0.7071f);
+  void SetCutoff(float cutoff_hz);
+  void SetQ(float q);
+  void Process(float *samples, Si32 frames) override;
+};
+
+// Reduces the level above threshold_db by ratio. Levels are in dB relative
+// to full scale. A ratio of 0 means infinity, which makes it a limiter
+// that never lets a sample above the threshold.
+class Compressor : public SoundEffect {
+ private:
+  std::atomic<float> threshold_db_;
+  std::atomic<float> ratio_;
+  std::atomic<float> attack_s_;
+  std::atomic<float> release_s_;
+  std::atomic<float> makeup_db_;
+  std::atomic<bool> is_dirty_;
+  float threshold_ = 32767.0f;
+  float exponent_ = -1.0f;
+  float attack_ = 0.0f;
+  float release_ = 0.0f;
+  float makeup_ = 1.0f;
+  float envelope_ = 0.0f;
+  float gain_ = 1.0f;
+
+  void UpdateCoefficients();
+
+ public:
+  Compressor(float threshold_db, float ratio, float attack_s,
+    float release_s, float makeup_db = 0.0f);
+  void SetThreshold(float threshold_db);
+  void SetRatio(float ratio);
+  void SetMakeupGain(float makeup_db);
+  void Process(float *samples, Si32 frames) override;
+};
+
+// A peak limiter, the compressor with an infinite ratio and instant attack.
+class Limiter : public Compressor {
+ public:
+  explicit Limiter(float threshold_db = -0.3f, float release_s = 0.05f);
+};
+
+// A Schroeder-Moorer reverb: parallel damped combs and serial allpasses.
+class Reverb : public SoundEffect {
+ private:
+  struct DelayLine {
+    std::vector<float> buffer;
+    Si32 index = 0;
+    float filter_state = 0.0f;
+  };
+  static const Si32 kCombCount = 4;
+  static const Si32 kAllpassCount = 2;
+  std::atomic<float> room_size_;
+  std::atomic<float> damping_;
+  std::atomic<float> wet_;
+  std::atomic<float> dry_;
+  DelayLine combs_[2][kCombCount];
+  DelayLine allpasses_[2][kAllpassCount];
+
+ public:
+  Reverb(float room_size = 0.5f, float damping = 0.5f, float wet = 0.3f,
+    float dry = 1.0f);
+  // Room size and damping are in the 0 to 1 range.
+  void SetRoomSize(float room_size);
+  void SetDamping(float damping);
+  void SetWet(float wet);
+  void SetDry(float dry);
+  void Process(float *samples, Si32 frames) override;
+};
+
+}  // namespace arctic
+
+#endif  // ENGINE_ARCTIC_SOUND_EFFECTS_H_
@@ -31,6 +31,7 @@
 #include <utility>
 
 #include "engine/arctic_platform.h"
+#include "engine/easy_rasterizer.h"
 
 namespace arctic {
 namespace easy {
@@ -91,375 +92,58 @@ void DrawLine(Vec2Si32 a, Vec2Si32 b, Rgba color) {
 }
 
 void DrawLine(Vec2Si32 a, Vec2Si32 b, Rgba color_a, Rgba color_b) {
-    Vec2Si32 ab = b - a;
-    Vec2Si32 abs_ab(std::abs(ab.x), std::abs(ab.y));
-    if (abs_ab.x >= abs_ab.y) {
-        if (a.x > b.x) {
-            DrawLine(b, a, color_b, color_a);
-        } else {
-            Sprite back = GetEngine()->GetBackbuffer();
-            Vec2Si32 back_size = back.Size();
-            if (ab.x == 0) {
-                if (a.x >= 0 && a.x < back_size.x &&
-                        a.y >= 0 && a.y < back_size.y) {
-                    back.RgbaData()[a.x + a.y * back.StridePixels()] = color_a;
-                }
-                return;
-            }
-            Si32 x1 = std::max(0, a.x);
-            Si32 x2 = std::min(back_size.x - 1, b.x);
-            Si32 y1 = a.y + ab.y * (x1 - a.x) / ab.x;
-            Si32 y2 = a.y + ab.y * (x2 - a.x) / ab.x;
-            if (y1 < 0) {
-                if (y2 < 0) {
-                    return;
-                }
-                // lower left -> upper right
-                y1 = 0;
-                x1 = a.x + ab.x * (y1 - a.y) / ab.y;
-                x1 = std::max(0, x1);
-            } else if (y1 >= back_size.y) {
-                if (y2 >= back_size.y) {
-                    return;
-                }
-                // upper left -> lower right
-                y1 = back_size.y - 1;
-                x1 = a.x + ab.x * (y1 - a.y) / ab.y;
-                x1 = std::max(0, x1);
-            }
-            if (y2 < 0) {
-                // upper left -> lower right
-                y2 = 0;
-                x2 = a.x + ab.x * (y2 - a.y) / ab.y;
-                x2 = std::min(back_size.x - 1, x2);
-            } else if (y2 >= back_size.y) {
-                // lower left -> upper right
-                y2 = back_size.y - 1;
-                x2 = a.x + ab.x * (y2 - a.y) / ab.y;
-                x2 = std::min(back_size.x - 1, x2);
-            }
+    const Vec2F points[2] = {Vec2F(a), Vec2F(b)};
+    const Rgba colors[2] = {color_a, color_b};
+    RasterizeLines(points, colors, 2, kLineAliased,
+        GetEngine()->GetBackbuffer());
+}
 
-            Vec4Si32 rgba_a(
-                static_cast<Si32>(color_a.r),
-                static_cast<Si32>(color_a.g),
-                static_cast<Si32>(color_a.b),
-                static_cast<Si32>(color_a.a));
-            Vec4Si32 rgba_b(
-                static_cast<Si32>(color_b.r),
-                static_cast<Si32>(color_b.g),
-                static_cast<Si32>(color_b.b),
-                static_cast<Si32>(color_b.a));
-            Vec4Si32 rgba_ab = rgba_b - rgba_a;
-            Vec4Si32 rgba_1 = rgba_a + rgba_ab * (x1 - a.x) / ab.x;
-            Vec4Si32 rgba_2 = rgba_a + rgba_ab * (x2 - a.x) / ab.x;
-            Vec4Si32 rgba_12 = rgba_2 - rgba_1;
-
-            if (x2 <= x1) {
-                if (x2 == x1) {
-                    Rgba color(rgba_1.x, rgba_1.y, rgba_1.z, rgba_1.w);
-                    back.RgbaData()[x1 + y1 * back.StridePixels()] = color;
-                }
-                return;
-            }
-            Vec4Si32 rgba_16 = rgba_1 * 65536;
-            Vec4Si32 rgba_12_16 = rgba_12 * 65536;
-            Vec4Si32 rgba_12_16_step = rgba_12_16 / (x2 - x1);
-            Si32 y_16 = y1 * 65536;
-            Si32 y12_16_step = ((y2 - y1) * 65536) / (x2 - x1);
-            Si32 stride = back.StridePixels();
-            for (Si32 x = x1; x <= x2; ++x) {
-                Rgba color(
-                    rgba_16.x >> 16,
-                    rgba_16.y >> 16,
-                    rgba_16.z >> 16,
-                    rgba_16.w >> 16);
-                back.RgbaData()[x + (y_16 >> 16) * stride] = color;
-                rgba_16 += rgba_12_16_step;
-                y_16 += y12_16_step;
-            }
-        }
-    } else {
-        if (a.y > b.y) {
-            DrawLine(b, a, color_b, color_a);
-        } else {
-            Sprite back = GetEngine()->GetBackbuffer();
-            Vec2Si32 back_size = back.Size();
-            if (ab.y == 0) {
-                if (a.y >= 0 && a.y < back_size.y &&
-                    a.x >= 0 && a.x < back_size.x) {
-                    back.RgbaData()[a.x + a.y * back.StridePixels()] = color_a;
-                }
-                return;
-            }
-            Si32 y1 = std::max(0, a.y);
-            Si32 y2 = std::min(back_size.y - 1, b.y);
-            Si32 x1 = a.x + ab.x * (y1 - a.y) / ab.y;
-            Si32 x2 = a.x + ab.x * (y2 - a.y) / ab.y;
-            if (x1 < 0) {
-                if (x2 < 0) {
-                    return;
-                }
-                // lower left -> upper right
-                x1 = 0;
-                y1 = a.y + ab.y * (x1 - a.x) / ab.x;
-                y1 = std::max(0, y1);
-            } else if (x1 >= back_size.x) {
-                if (x2 >= back_size.x) {
-                    return;
-                }
-                // lower right -> upper left
-                x1 = back_size.x - 1;
-                y1 = a.y + ab.y * (x1 - a.x) / ab.x;
-                y1 = std::max(0, y1);
-            }
-            if (x2 < 0) {
-                // lower right -> upper left
-                x2 = 0;
-                y2 = a.y + ab.y * (x2 - a.x) / ab.x;
-                y2 = std::min(back_size.y - 1, y2);
-            } else if (x2 >= back_size.x) {
-                // lower left -> upper right
-                x2 = back_size.x - 1;
-                y2 = a.y + ab.y * (x2 - a.x) / ab.x;
-                y2 = std::min(back_size.y - 1, y2);
-            }
+void DrawLines(const Vec2F *points, const Rgba *colors, Si32 point_count,
+    DrawLineMode mode) {
+    RasterizeLines(points, colors, point_count, mode,
+        GetEngine()->GetBackbuffer());
+}
 
-            Vec4Si32 rgba_a(
-                static_cast<Si32>(color_a.r),
-                static_cast<Si32>(color_a.g),
-                static_cast<Si32>(color_a.b),
-                static_cast<Si32>(color_a.a));
-            Vec4Si32 rgba_b(
-                static_cast<Si32>(color_b.r),
-                static_cast<Si32>(color_b.g),
-                static_cast<Si32>(color_b.b),
-                static_cast<Si32>(color_b.a));
-            Vec4Si32 rgba_ab = rgba_b - rgba_a;
-            Vec4Si32 rgba_1 = rgba_a + rgba_ab * (y1 - a.y) / ab.y;
-            Vec4Si32 rgba_2 = rgba_a + rgba_ab * (y2 - a.y) / ab.y;
-            Vec4Si32 rgba_12 = rgba_2 - rgba_1;
-
-            if (y2 <= y1) {
-                if (y2 == y1) {
-                    Rgba color(rgba_1.y, rgba_1.x, rgba_1.z, rgba_1.w);
-                    back.RgbaData()[x1 + y1 * back.StridePixels()] = color;
-                }
-                return;
-            }
-            Vec4Si32 rgba_16 = rgba_1 * 65536;
-            Vec4Si32 rgba_12_16 = rgba_12 * 65536;
-            Vec4Si32 rgba_12_16_step = rgba_12_16 / (y2 - y1);
-            Si32 x_16 = x1 * 65536;
-            Si32 x12_16_step = ((x2 - x1) * 65536) / (y2 - y1);
-            Si32 stride = back.StridePixels();
-            for (Si32 y = y1; y <= y2; ++y) {
-                Rgba color(
-                    rgba_16.x >> 16,
-                    rgba_16.y >> 16,
-                    rgba_16.z >> 16,
-                    rgba_16.w >> 16);
-                back.RgbaData()[(x_16 >> 16) + y * stride] = color;
-                rgba_16 += rgba_12_16_step;
-                x_16 += x12_16_step;
-            }
-        }
-    }
+void DrawLines(const Vec2F *points, Si32 point_count, Rgba color,
+    DrawLineMode mode) {
+    RasterizeLines(points, point_count, color, mode,
+        GetEngine()->GetBackbuffer());
 }
 
-void DrawTriangle(Vec2Si32 a, Vec2Si32 b, Vec2Si32 c, Rgba color) {
-    DrawTriangle(a, b, c, color, color, color);
+void DrawPolyline(const Vec2F *points, const Rgba *colors, Si32 point_count,
+    DrawLineMode mode) {
+    RasterizePolyline(points, colors, point_count, mode,
+        GetEngine()->GetBackbuffer());
 }
 
-// Just like MasterBoy wrote in HUGi 17, but without subpixel
-// see http://www.hugi.scene.org/online/coding/hugi%2017%20-%20cotriang.htm
-// or http://www.hugi.scene.org/online/hugi17/
-inline void DrawTrianglePart(Rgba *dst, Si32 stride,
-        float *x1, float *x2, Vec4F *rgba_a, Vec4F *rgba_b,
-        float dxdy1, float dxdy2,
-        Vec4F dcdy1, Vec4F dcdy2,
-        Si32 width, Si32 height,
-        Si32 y1, Si32 y2) {
-    Si32 y = y1;
-    if (y1 < 0) {
-        Si32 yc = std::min(0, y2);
-        float d = static_cast<float>(yc - y);
-        y = yc;
-        *x1 += dxdy1 * d;
-        *x2 += dxdy2 * d;
-        *rgba_a += dcdy1 * d;
-        *rgba_b += dcdy2 * d;
-    }
-    Si32 ye = std::min(height, y2);
-    dst += y * stride;
-    for (; y < ye; y++) {
-        Si32 x1i = static_cast<Si32>(*x1);
-        Si32 x2i = static_cast<Si32>(*x2);
-
-        Si32 x12i = x2i - x1i;
-        Si32 x1c = std::max(0, x1i);
-        Si32 x2c = std::min(width, x2i);
-
-        if (x2c <= x1c) {
-            if (x2c == x1c && x2c < width) {
-                Rgba color(Ui8(rgba_a->x),
-                    Ui8(rgba_a->y),
-                    Ui8(rgba_a->z),
-                    Ui8(rgba_a->w));
-                Rgba *p = dst + x1c;
-                p->rgba = color.rgba;
-            }
-        } else {
-            Vec4F rgba_ab = *rgba_b - *rgba_a;
-            Vec4F rgba_1c = *rgba_a + rgba_ab * static_cast<float>(x1c - x1i) /
-                static_cast<float>(x12i);
-            Vec4F rgba_2c = *rgba_a + rgba_ab * static_cast<float>(x2c - x1i) /
-                static_cast<float>(x12i);
-            Vec4F rgba_1c2c = rgba_2c - rgba_1c;
-
-            Vec4Si32 rgba_16(rgba_1c * 65536.f);
-            Vec4Si32 rgba_12_16(rgba_1c2c * 65536.f);
-            Vec4Si32 rgba_12_16_step = rgba_12_16 / (x2c - x1c);
-
-            Rgba *p = dst + x1c;
-            for (Si32 x = x1c; x < x2c; ++x) {
-                Rgba color(
-                    rgba_16.x >> 16,
-                    rgba_16.y >> 16,
-                    rgba_16.z >> 16,
-                    rgba_16.w >> 16);
-                p->rgba = color.rgba;
-                p++;
-                rgba_16 += rgba_12_16_step;
-            }
-        }
-        *x1 += dxdy1;
-        *x2 += dxdy2;
-        *rgba_a += dcdy1;
-        *rgba_b += dcdy2;
-        dst += stride;
-    }
+void DrawPolyline(const Vec2F *points, Si32 point_count, Rgba color,
+    DrawLineMode mode) {
+    RasterizePolyline(points, point_count, color, mode,
+        GetEngine()->GetBackbuffer());
+}
+
+void DrawTriangle(Vec2Si32 a, Vec2Si32 b, Vec2Si32 c, Rgba color) {
+    DrawTriangle(a, b, c, color, color, color);
 }
 
 void DrawTriangle(Vec2Si32 a, Vec2Si32 b, Vec2Si32 c,
     Rgba color_a, Rgba color_b, Rgba color_c) {
-    if (a.y > b.y) {
-        std::swap(a, b);
-        std::swap(color_a, color_b);
-    }
-    if (a.y > c.y) {
-        std::swap(a, c);
-        std::swap(color_a, color_c);
-    }
-    if (b.y > c.y) {
-        std::swap(b, c);
-        std::swap(color_b, color_c);
-    }
-    if (a.y == c.y) {
-        return;
-    }
-    Sprite back = GetEngine()->GetBackbuffer();
-    Si32 stride = back.StridePixels();
-    Rgba *dst = back.RgbaData();
-    Si32 width = back.Width();
-    Si32 height = back.Height();
-
-    float dxdy_ac = static_cast<float>(c.x - a.x) /
-        static_cast<float>(c.y - a.y);
-    float dxdy_bc = static_cast<float>(c.x - b.x) /
-        static_cast<float>(c.y - b.y);
-    float dxdy_ab = static_cast<float>(b.x - a.x) /
-        static_cast<float>(b.y - a.y);
-
-    Vec4F rgba_a(color_a.r, color_a.g, color_a.b, color_a.a);
-    Vec4F rgba_b(color_b.r, color_b.g, color_b.b, color_b.a);
-    Vec4F rgba_c(color_c.r, color_c.g, color_c.b, color_c.a);
-
-    Vec4F dcdy_ac = (rgba_c - rgba_a) / static_cast<float>(c.y - a.y);
-    Vec4F dcdy_bc = (rgba_c - rgba_b) / static_cast<float>(c.y - b.y);
-    Vec4F dcdy_ab = (rgba_b - rgba_a) / static_cast<float>(b.y - a.y);
-
-    float x1;
-    float x2;
-    float dxdy1;
-    float dxdy2;
-    Vec4F rgba1;
-    Vec4F rgba2;
-    Vec4F dcdy1;
-    Vec4F dcdy2;
-
-    bool is_b_at_the_right_side = dxdy_ac < dxdy_ab;
-    if (is_b_at_the_right_side) {
-        dxdy1 = dxdy_ac;
-        dcdy1 = dcdy_ac;
-        if (a.y == b.y) {
-            dxdy2 = dxdy_bc;
-            x1 = static_cast<float>(a.x);
-            x2 = static_cast<float>(b.x);
-            dcdy2 = dcdy_bc;
-            rgba1 = rgba_a;
-            rgba2 = rgba_b;
-            DrawTrianglePart(dst, stride, &x1, &x2, &rgba1, &rgba2,
-                dxdy1, dxdy2,
-                dcdy1, dcdy2, width, height, a.y, c.y);
-            return;
-        }
-        if (a.y < b.y) {
-            dxdy2 = dxdy_ab;
-            x1 = static_cast<float>(a.x);
-            x2 = static_cast<float>(a.x);
-            dcdy2 = dcdy_ab;
-            rgba1 = rgba_a;
-            rgba2 = rgba_a;
-            DrawTrianglePart(dst, stride, &x1, &x2, &rgba1, &rgba2,
-                dxdy1, dxdy2,
-                dcdy1, dcdy2, width, height, a.y, b.y);
-        }
-        if (b.y < c.y) {
-            dxdy2 = dxdy_bc;
-            x2 = static_cast<float>(b.x);
-            dcdy2 = dcdy_bc;
-            rgba2 = rgba_b;
-            DrawTrianglePart(dst, stride, &x1, &x2, &rgba1, &rgba2,
-                dxdy1, dxdy2,
-                dcdy1, dcdy2, width, height, b.y, c.y);
-        }
-    } else {
-        // b is at the left side
-        dxdy2 = dxdy_ac;
-        dcdy2 = dcdy_ac;
-        if (a.y == b.y) {
-            dxdy1 = dxdy_bc;
-            x1 = static_cast<float>(b.x);
-            x2 = static_cast<float>(a.x);
-            dcdy1 = dcdy_bc;
-            rgba1 = rgba_b;
-            rgba2 = rgba_a;
-            DrawTrianglePart(dst, stride, &x1, &x2, &rgba1, &rgba2,
-                dxdy1, dxdy2,
-                dcdy1, dcdy2, width, height, a.y, c.y);
-            return;
-        }
-        if (a.y < b.y) {
-            dxdy1 = dxdy_ab;
-            x1 = static_cast<float>(a.x);
-            x2 = static_cast<float>(a.x);
-            dcdy1 = dcdy_ab;
-            rgba1 = rgba_a;
-            rgba2 = rgba_a;
-            DrawTrianglePart(dst, stride, &x1, &x2, &rgba1, &rgba2,
-                dxdy1, dxdy2,
-                dcdy1, dcdy2, width, height, a.y, b.y);
-        }
-        if (b.y < c.y) {
-            dxdy1 = dxdy_bc;
-            x1 = static_cast<float>(b.x);
-            dcdy1 = dcdy_bc;
-            rgba1 = rgba_b;
-            DrawTrianglePart(dst, stride, &x1, &x2, &rgba1, &rgba2,
-                dxdy1, dxdy2,
-                dcdy1, dcdy2, width, height, b.y, c.y);
-        }
-    }
+    RasterizeTriangle(Vec2F(a), Vec2F(b), Vec2F(c),
+        color_a, color_b, color_c, GetEngine()->GetBackbuffer());
+}
+
+void DrawTriangles(const Vec2F *positions, const Rgba *colors,
+    Si32 vertex_count, const Ui32 *indices, Si32 index_count) {
+    RasterizeTriangles(positions, colors, vertex_count, indices, index_count,
+        GetEngine()->GetBackbuffer());
+}
+
+void DrawTexturedTriangles(const Vec2F *positions, const Vec2F *tex_coords,
+    Si32 vertex_count, const Ui32 *indices, Si32 index_count,
+    Sprite texture, DrawBlendingMode blending_mode) {
+    RasterizeTexturedTriangles(positions, tex_coords, vertex_count,
+        indices, index_count, texture, GetEngine()->GetBackbuffer(),
+        blending_mode);
 }
 
 void ShowFrame() {
@@ -28,10 +28,13 @@
 
 #include "engine/arctic_input.h"
 #include "engine/arctic_types.h"
+#include "engine/vec2f.h"
 #include "engine/vec2si32.h"
 #include "engine/rgba.h"
 #include "engine/easy_sound.h"
 #include "engine/easy_sprite.h"
+#include "engine/easy_rasterizer.h"
+#include "engine/easy_sprite_atlas.h"
 #include "engine/engine.h"
 #include "engine/font.h"
 #include "engine/log.h"
@@ -41,9 +44,26 @@ namespace easy {
 
 void DrawLine(Vec2Si32 a, Vec2Si32 b, Rgba color);
 void DrawLine(Vec2Si32 a, Vec2Si32 b, Rgba color_a, Rgba color_b);
+// Draw segments from points[2 * i] to points[2 * i + 1].
+void DrawLines(const Vec2F *points, const Rgba *colors, Si32 point_count,
+    DrawLineMode mode = kLineAliased);
+void DrawLines(const Vec2F *points, Si32 point_count, Rgba color,
+    DrawLineMode mode = kLineAliased);
+// Draw segments joining the consecutive points.
+void DrawPolyline(const Vec2F *points, const Rgba *colors, Si32 point_count,
+    DrawLineMode mode = kLineAliased);
+void DrawPolyline(const Vec2F *points, Si32 point_count, Rgba color,
+    DrawLineMode mode = kLineAliased);
 void DrawTriangle(Vec2Si32 a, Vec2Si32 b, Vec2Si32 c, Rgba color);
 void DrawTriangle(Vec2Si32 a, Vec2Si32 b, Vec2Si32 c,
     Rgba color_a, Rgba color_b, Rgba color_c);
+// Draw a batch of triangles, each three indices form a triangle. With no
+// indices each three consecutive vertices do.
+void DrawTriangles(const Vec2F *positions, const Rgba *colors,
+    Si32 vertex_count, const Ui32 *indices = nullptr, Si32 index_count = 0);
+void DrawTexturedTriangles(const Vec2F *positions, const Vec2F *tex_coords,
+    Si32 vertex_count, const Ui32 *indices, Si32 index_count,
+    Sprite texture, DrawBlendingMode blending_mode = kAlphaBlend);
 
 void ShowFrame();
 
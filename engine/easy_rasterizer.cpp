@@ -0,0 +1,1134 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/easy_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "engine/arctic_parallel.h"
+#include "engine/arctic_pixel_convert.h"
+#include "engine/arctic_platform.h"
+#include "engine/arctic_simd.h"
+
+namespace arctic {
+namespace easy {
+
+static const Si32 kSubpixelBits = 4;
+static const float kSubpixel = static_cast<float>(1 << kSubpixelBits);
+static const Si32 kTileSize = 8;
+static const float kGuardBand = 65536.f;
+// Batches are binned into bands of whole tile rows across the target. A
+// band is drawn by one thread in the submission order of its triangles.
+// Spans are never split, so the result matches drawing one by one.
+static const Si32 kBandHeightLog2 = 5;
+static const Si32 kBandHeight = 1 << kBandHeightLog2;
+static const Si32 kSetupTrianglesPerThreadMin = 256;
+// Smaller line batches are drawn on the calling thread.
+static const Si32 kBinnedLinesMin = 1024;
+// Line ends are kept well within the exact integer range of float.
+static const float kLineGuardBand = 8388608.f;
+
+// Edge function value at the center of pixel (x, y) is
+// origin + x * step_x + y * step_y, it is not negative inside.
+struct RasterEdge {
+  Si64 origin;
+  Si32 step_x;
+  Si32 step_y;
+  // step_x times the lane index, for evaluating a tile row at once. Loads
+  // are unaligned, batches keep triangles in a std::vector.
+  Si32 lanes[kTileSize];
+};
+
+// Pixel bounds, end is exclusive.
+struct RasterBounds {
+  Si32 x_begin;
+  Si32 x_end;
+  Si32 y_begin;
+  Si32 y_end;
+};
+
+struct RasterTriangle {
+  RasterEdge edges[3];
+  // Vertices in pixels after snapping to the subpixel grid.
+  Vec2F vertices[3];
+  // Clipped to the target.
+  RasterBounds bounds;
+};
+
+// An attribute that changes linearly over the triangle, in 32.32 fixed
+// point so stepping across the whole target does not drift.
+struct RasterPlane {
+  Si64 at_origin;
+  Si64 step_x;
+  Si64 step_y;
+
+  // The value at the center of pixel (x, y) in 16.16 fixed point.
+  Si32 At16(Si32 x, Si32 y) const {
+    return static_cast<Si32>((at_origin + step_x * x + step_y * y) >> 16);
+  }
+
+  Si32 StepX16() const {
+    return static_cast<Si32>((step_x + 0x8000) >> 16);
+  }
+};
+
+static RasterPlane MakePlane(const RasterTriangle &t,
+    float value_a, float value_b, float value_c) {
+  const double xa = t.vertices[0].x;
+  const double ya = t.vertices[0].y;
+  const double xba = t.vertices[1].x - xa;
+  const double yba = t.vertices[1].y - ya;
+  const double xca = t.vertices[2].x - xa;
+  const double yca = t.vertices[2].y - ya;
+  const double fba = static_cast<double>(value_b) - value_a;
+  const double fca = static_cast<double>(value_c) - value_a;
+  const double det = xba * yca - xca * yba;
+  const double step_x = (fba * yca - fca * yba) / det;
+  const double step_y = (fca * xba - fba * xca) / det;
+  // The value at the center of pixel (0, 0).
+  const double at_origin = value_a + step_x * (0.5 - xa) +
+    step_y * (0.5 - ya);
+  const double one = 4294967296.0;
+  RasterPlane plane;
+  plane.at_origin = static_cast<Si64>(std::floor(at_origin * one));
+  plane.step_x = static_cast<Si64>(std::floor(step_x * one + 0.5));
+  plane.step_y = static_cast<Si64>(std::floor(step_y * one + 0.5));
+  return plane;
+}
+
+// Snaps the vertices and sets up the edges, false when nothing is drawn.
+static bool SetupTriangle(Vec2F a, Vec2F b, Vec2F c,
+    Si32 width, Si32 height, RasterTriangle *t) {
+  const Vec2F in[3] = {a, b, c};
+  Si64 x[3];
+  Si64 y[3];
+  for (Si32 i = 0; i < 3; ++i) {
+    if (!(std::fabs(in[i].x) < kGuardBand && std::fabs(in[i].y) < kGuardBand)) {
+      return false;
+    }
+    x[i] = static_cast<Si64>(std::floor(in[i].x * kSubpixel + 0.5f));
+    y[i] = static_cast<Si64>(std::floor(in[i].y * kSubpixel + 0.5f));
+    t->vertices[i] = Vec2F(static_cast<float>(x[i]) / kSubpixel,
+      static_cast<float>(y[i]) / kSubpixel);
+  }
+  const Si64 area = (x[1] - x[0]) * (y[2] - y[0]) -
+    (x[2] - x[0]) * (y[1] - y[0]);
+  if (area == 0) {
+    return false;
+  }
+  const Si64 orientation = area > 0 ? 1 : -1;
+
+  const Si64 x_min = std::min(x[0], std::min(x[1], x[2]));
+  const Si64 x_max = std::max(x[0], std::max(x[1], x[2]));
+  const Si64 y_min = std::min(y[0], std::min(y[1], y[2]));
+  const Si64 y_max = std::max(y[0], std::max(y[1], y[2]));
+  // Pixels whose centers may be inside.
+  RasterBounds &bounds = t->bounds;
+  bounds.x_begin = static_cast<Si32>(std::max<Si64>(0,
+    (x_min >> kSubpixelBits) - 1));
+  bounds.x_end = static_cast<Si32>(std::min<Si64>(width,
+    (x_max >> kSubpixelBits) + 1));
+  bounds.y_begin = static_cast<Si32>(std::max<Si64>(0,
+    (y_min >> kSubpixelBits) - 1));
+  bounds.y_end = static_cast<Si32>(std::min<Si64>(height,
+    (y_max >> kSubpixelBits) + 1));
+  if (bounds.x_end <= bounds.x_begin || bounds.y_end <= bounds.y_begin) {
+    return false;
+  }
+
+  const Si64 half = 1 << (kSubpixelBits - 1);
+  for (Si32 i = 0; i < 3; ++i) {
+    const Si32 j = (i + 1) % 3;
+    const Si32 k = (i + 2) % 3;
+    // The edge opposite to vertex k, positive on its side.
+    const Si64 dx = (x[j] - x[i]) * orientation;
+    const Si64 dy = (y[j] - y[i]) * orientation;
+    const Si64 step_x = -dy;
+    const Si64 step_y = dx;
+    // Pixels exactly on an edge belong to the triangle on one side only.
+    const bool is_top_left = step_x > 0 || (step_x == 0 && step_y < 0);
+    RasterEdge &edge = t->edges[k];
+    edge.origin = step_x * (half - x[i]) + step_y * (half - y[i]) -
+      (is_top_left ? 0 : 1);
+    edge.step_x = static_cast<Si32>(step_x << kSubpixelBits);
+    edge.step_y = static_cast<Si32>(step_y << kSubpixelBits);
+    for (Si32 lane = 0; lane < kTileSize; ++lane) {
+      edge.lanes[lane] = edge.step_x * lane;
+    }
+  }
+  return true;
+}
+
+// The least and the greatest value of the edge function over the centers
+// of a width by height block of pixels starting at (x, y).
+inline void EdgeRange(const RasterEdge &edge, Si32 x, Si32 y,
+    Si32 width, Si32 height, Si64 *low, Si64 *high) {
+  const Si64 value = edge.origin + static_cast<Si64>(edge.step_x) * x +
+    static_cast<Si64>(edge.step_y) * y;
+  const Si64 span_x = static_cast<Si64>(edge.step_x) * (width - 1);
+  const Si64 span_y = static_cast<Si64>(edge.step_y) * (height - 1);
+  *low = value + std::min<Si64>(0, span_x) + std::min<Si64>(0, span_y);
+  *high = value + std::max<Si64>(0, span_x) + std::max<Si64>(0, span_y);
+}
+
+// Bit i is set when pixel i of a tile row is inside all the given edges.
+// Values are the edge functions at the first pixel of the row.
+inline Ui32 RowCoverage(const Si32 *values, const RasterEdge *const *edges,
+    Si32 edge_count, Ui32 width_mask) {
+#if defined(ARCTIC_SIMD_SSE2)
+  __m128i low = _mm_setzero_si128();
+  __m128i high = _mm_setzero_si128();
+  for (Si32 i = 0; i < edge_count; ++i) {
+    const __m128i value = _mm_set1_epi32(values[i]);
+    const __m128i *lanes = reinterpret_cast<const __m128i*>(edges[i]->lanes);
+    low = _mm_or_si128(low, _mm_add_epi32(value, _mm_loadu_si128(lanes)));
+    high = _mm_or_si128(high,
+      _mm_add_epi32(value, _mm_loadu_si128(lanes + 1)));
+  }
+  const Ui32 outside = static_cast<Ui32>(
+    _mm_movemask_ps(_mm_castsi128_ps(low)) |
+    (_mm_movemask_ps(_mm_castsi128_ps(high)) << 4));
+  return ~outside & width_mask;
+#else
+  Ui32 outside = 0;
+  for (Si32 i = 0; i < edge_count; ++i) {
+    for (Si32 lane = 0; lane < kTileSize; ++lane) {
+      outside |= static_cast<Ui32>(values[i] + edges[i]->lanes[lane] < 0) <<
+        lane;
+    }
+  }
+  return ~outside & width_mask;
+#endif
+}
+
+// Visits the tiles of the triangle within the bounds. Runs of tiles inside
+// all edges are passed to shader.Span a row at a time, tiles on an edge go
+// to shader.Masked with a bit per pixel whose center is inside.
+template<class Shader>
+void RasterizeTiles(const RasterTriangle &t, const RasterBounds &bounds,
+    Rgba *data, Si32 stride, Shader *shader) {
+  // Tiles are aligned to the target, so tile rows fill whole cache lines.
+  const Si32 x_begin = bounds.x_begin & ~(kTileSize - 1);
+  const Si32 y_begin = bounds.y_begin & ~(kTileSize - 1);
+  for (Si32 tile_y = y_begin; tile_y < bounds.y_end; tile_y += kTileSize) {
+    const Si32 tile_height = std::min(kTileSize, bounds.y_end - tile_y);
+    Rgba *tile_row = data + static_cast<Si64>(tile_y) * stride;
+    Si32 run_begin = 0;
+    Si32 run_end = 0;
+    auto draw_run = [&]() {
+      Rgba *row = tile_row + run_begin;
+      for (Si32 y = tile_y; y < tile_y + tile_height; ++y) {
+        shader->Span(row, run_begin, y, run_end - run_begin);
+        row += stride;
+      }
+      run_begin = run_end = 0;
+    };
+    for (Si32 tile_x = x_begin; tile_x < bounds.x_end;
+        tile_x += kTileSize) {
+      const Si32 tile_width = std::min(kTileSize, bounds.x_end - tile_x);
+      const RasterEdge *crossing[3];
+      Si32 values[3];
+      Si32 crossing_count = 0;
+      bool is_outside = false;
+      for (Si32 i = 0; i < 3 && !is_outside; ++i) {
+        const RasterEdge &edge = t.edges[i];
+        Si64 low;
+        Si64 high;
+        EdgeRange(edge, tile_x, tile_y, tile_width, tile_height, &low, &high);
+        if (high < 0) {
+          is_outside = true;
+        } else if (low < 0) {
+          // Within an edge crossing tile the values fit in 32 bits.
+          crossing[crossing_count] = &edge;
+          values[crossing_count] = static_cast<Si32>(edge.origin +
+            static_cast<Si64>(edge.step_x) * tile_x +
+            static_cast<Si64>(edge.step_y) * tile_y);
+          ++crossing_count;
+        }
+      }
+      if (!is_outside && crossing_count == 0) {
+        if (run_end != tile_x) {
+          run_begin = tile_x;
+        }
+        run_end = tile_x + tile_width;
+        continue;
+      }
+      if (run_end > run_begin) {
+        draw_run();
+      }
+      if (is_outside) {
+        continue;
+      }
+      const Ui32 width_mask = (1u << tile_width) - 1;
+      Rgba *row = tile_row + tile_x;
+      for (Si32 y = tile_y; y < tile_y + tile_height; ++y) {
+        const Ui32 mask = RowCoverage(values, crossing, crossing_count,
+          width_mask);
+        if (mask) {
+          shader->Masked(row, tile_x, y, tile_width, mask);
+        }
+        for (Si32 i = 0; i < crossing_count; ++i) {
+          values[i] += crossing[i]->step_y;
+        }
+        row += stride;
+      }
+    }
+    if (run_end > run_begin) {
+      draw_run();
+    }
+  }
+}
+
+struct FlatShader {
+  Ui32 color;
+
+  void Span(Rgba *to, Si32 /*x*/, Si32 /*y*/, Si32 count) {
+    FillPixels(&to->rgba, count, color);
+  }
+
+  void Masked(Rgba *to, Si32 /*x*/, Si32 /*y*/, Si32 count, Ui32 mask) {
+    for (Si32 i = 0; i < count; ++i) {
+      if (mask & (1u << i)) {
+        to[i].rgba = color;
+      }
+    }
+  }
+};
+
+struct GouraudShader {
+  // The channels are biased by a half, so dropping the fraction rounds.
+  RasterPlane channels[4];
+  Si32 step_x[4];
+
+  template<bool kIsMasked>
+  void Row(Rgba *to, Si32 x, Si32 y, Si32 count, Ui32 mask) {
+#if defined(ARCTIC_SIMD_SSE2)
+    // Packing with saturation clamps to 0..255 for free.
+    __m128i value = _mm_setr_epi32(channels[0].At16(x, y),
+      channels[1].At16(x, y), channels[2].At16(x, y), channels[3].At16(x, y));
+    const __m128i step = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(step_x));
+    for (Si32 i = 0; i < count; ++i) {
+      if (!kIsMasked || (mask & (1u << i))) {
+        __m128i rgba = _mm_srai_epi32(value, 16);
+        rgba = _mm_packs_epi32(rgba, rgba);
+        rgba = _mm_packus_epi16(rgba, rgba);
+        to[i].rgba = static_cast<Ui32>(_mm_cvtsi128_si32(rgba));
+      }
+      value = _mm_add_epi32(value, step);
+    }
+#else
+    Si32 value[4];
+    for (Si32 c = 0; c < 4; ++c) {
+      value[c] = channels[c].At16(x, y);
+    }
+    for (Si32 i = 0; i < count; ++i) {
+      if (!kIsMasked || (mask & (1u << i))) {
+        Ui32 rgba = 0;
+        for (Si32 c = 0; c < 4; ++c) {
+          const Si32 channel = std::min(255, std::max(0, value[c] >> 16));
+          rgba |= static_cast<Ui32>(channel) << (c * 8);
+        }
+        to[i].rgba = rgba;
+      }
+      for (Si32 c = 0; c < 4; ++c) {
+        value[c] += step_x[c];
+      }
+    }
+#endif
+  }
+
+  void Span(Rgba *to, Si32 x, Si32 y, Si32 count) {
+    Row<false>(to, x, y, count, 0);
+  }
+
+  void Masked(Rgba *to, Si32 x, Si32 y, Si32 count, Ui32 mask) {
+    Row<true>(to, x, y, count, mask);
+  }
+};
+
+template<DrawBlendingMode kBlendingMode>
+struct TextureShader {
+  RasterPlane u;
+  RasterPlane v;
+  Si32 u_step;
+  Si32 v_step;
+  const Rgba *texels;
+  Si32 stride;
+  Si32 u_max;
+  Si32 v_max;
+
+  void SetTexture(Sprite texture) {
+    texels = texture.RgbaData();
+    stride = texture.StridePixels();
+    u_max = texture.Width() - 1;
+    v_max = texture.Height() - 1;
+  }
+
+  void Setup(const RasterTriangle &t, Vec2F tex_a, Vec2F tex_b, Vec2F tex_c) {
+    u = MakePlane(t, tex_a.x, tex_b.x, tex_c.x);
+    v = MakePlane(t, tex_a.y, tex_b.y, tex_c.y);
+    u_step = u.StepX16();
+    v_step = v.StepX16();
+  }
+
+  template<bool kIsMasked, bool kIsClamped>
+  void Row(Rgba *to, Si32 x, Si32 y, Si32 count, Ui32 mask) {
+    Si32 u_16 = u.At16(x, y);
+    Si32 v_16 = v.At16(x, y);
+    for (Si32 i = 0; i < count; ++i) {
+      if (!kIsMasked || (mask & (1u << i))) {
+        Si32 tu = u_16 >> 16;
+        Si32 tv = v_16 >> 16;
+        if (kIsClamped) {
+          tu = std::min(u_max, std::max(0, tu));
+          tv = std::min(v_max, std::max(0, tv));
+        }
+        DrawPixel<kBlendingMode>(texels[tv * stride + tu], to + i);
+      }
+      u_16 += u_step;
+      v_16 += v_step;
+    }
+  }
+
+  void Span(Rgba *to, Si32 x, Si32 y, Si32 count) {
+    const Si32 u_first = u.At16(x, y);
+    const Si32 v_first = v.At16(x, y);
+    const Si32 u_last = u_first + u_step * (count - 1);
+    const Si32 v_last = v_first + v_step * (count - 1);
+    // Centers on the edge may land a hair outside the texture, the span
+    // needs no clamping when both of its ends are inside.
+    if (std::min(u_first, u_last) >= 0 && std::min(v_first, v_last) >= 0 &&
+        (std::max(u_first, u_last) >> 16) <= u_max &&
+        (std::max(v_first, v_last) >> 16) <= v_max) {
+      Row<false, false>(to, x, y, count, 0);
+    } else {
+      Row<false, true>(to, x, y, count, 0);
+    }
+  }
+
+  void Masked(Rgba *to, Si32 x, Si32 y, Si32 count, Ui32 mask) {
+    Row<true, true>(to, x, y, count, mask);
+  }
+};
+
+// Interpolates the vertex colors, or fills when they are all the same.
+struct VertexColorShader {
+  bool is_flat;
+  FlatShader flat;
+  GouraudShader gouraud;
+
+  void Setup(const RasterTriangle &t,
+      Rgba color_a, Rgba color_b, Rgba color_c) {
+    is_flat = color_a.rgba == color_b.rgba && color_a.rgba == color_c.rgba;
+    if (is_flat) {
+      flat.color = color_a.rgba;
+      return;
+    }
+    for (Si32 i = 0; i < 4; ++i) {
+      gouraud.channels[i] = MakePlane(t, color_a.element[i] + 0.5f,
+        color_b.element[i] + 0.5f, color_c.element[i] + 0.5f);
+      gouraud.step_x[i] = gouraud.channels[i].StepX16();
+    }
+  }
+
+  void Span(Rgba *to, Si32 x, Si32 y, Si32 count) {
+    if (is_flat) {
+      flat.Span(to, x, y, count);
+    } else {
+      gouraud.Span(to, x, y, count);
+    }
+  }
+
+  void Masked(Rgba *to, Si32 x, Si32 y, Si32 count, Ui32 mask) {
+    if (is_flat) {
+      flat.Masked(to, x, y, count, mask);
+    } else {
+      gouraud.Masked(to, x, y, count, mask);
+    }
+  }
+};
+
+void RasterizeTriangle(Vec2F a, Vec2F b, Vec2F c,
+    Rgba color_a, Rgba color_b, Rgba color_c, Sprite to_sprite) {
+  RasterTriangle t;
+  if (!SetupTriangle(a, b, c, to_sprite.Width(), to_sprite.Height(), &t)) {
+    return;
+  }
+  VertexColorShader shader;
+  shader.Setup(t, color_a, color_b, color_c);
+  RasterizeTiles(t, t.bounds, to_sprite.RgbaData(), to_sprite.StridePixels(),
+    &shader);
+}
+
+void RasterizeTexturedTriangle(Vec2F a, Vec2F b, Vec2F c,
+    Vec2F tex_a, Vec2F tex_b, Vec2F tex_c,
+    Sprite texture, Sprite to_sprite, DrawBlendingMode blending_mode) {
+  RasterTriangle t;
+  if (texture.Width() <= 0 || texture.Height() <= 0 ||
+      !SetupTriangle(a, b, c, to_sprite.Width(), to_sprite.Height(), &t)) {
+    return;
+  }
+  Rgba *data = to_sprite.RgbaData();
+  const Si32 stride = to_sprite.StridePixels();
+  switch (blending_mode) {
+    case kCopyRgba: {
+      TextureShader<kCopyRgba> shader;
+      shader.SetTexture(texture);
+      shader.Setup(t, tex_a, tex_b, tex_c);
+      RasterizeTiles(t, t.bounds, data, stride, &shader);
+      break;
+    }
+    case kAlphaBlend: {
+      TextureShader<kAlphaBlend> shader;
+      shader.SetTexture(texture);
+      shader.Setup(t, tex_a, tex_b, tex_c);
+      RasterizeTiles(t, t.bounds, data, stride, &shader);
+      break;
+    }
+  }
+}
+
+// Items of a batch binned into bands, band i has the items
+// items[offsets[i]..offsets[i + 1]) in the order they were added.
+struct RasterBands {
+  // Band and item index of each item reaching a band.
+  std::vector<std::pair<Si32, Si32>> refs;
+  std::vector<Si32> offsets;
+  std::vector<Si32> items;
+
+  void Add(Si32 band, Si32 item) {
+    refs.emplace_back(band, item);
+  }
+
+  // Moves the refs to the bands with a counting sort, which keeps the
+  // order within each band.
+  void Sort(Si32 band_count) {
+    offsets.assign(static_cast<size_t>(band_count) + 1, 0);
+    for (const std::pair<Si32, Si32> &ref : refs) {
+      ++offsets[ref.first + 1];
+    }
+    for (Si32 band = 0; band < band_count; ++band) {
+      offsets[band + 1] += offsets[band];
+    }
+    items.resize(refs.size());
+    for (const std::pair<Si32, Si32> &ref : refs) {
+      items[offsets[ref.first]++] = ref.second;
+    }
+    // Each offset has moved to the end of its band.
+    for (Si32 band = band_count; band > 0; --band) {
+      offsets[band] = offsets[band - 1];
+    }
+    offsets[0] = 0;
+    refs.clear();
+  }
+};
+
+static Si32 BandCount(Si32 height) {
+  return (height + kBandHeight - 1) >> kBandHeightLog2;
+}
+
+// Calls draw(item, y_begin, y_end) for the items of each band in order,
+// a band is drawn by a single thread.
+template<class Draw>
+static void DrawBands(const RasterBands &bands, Si32 band_count,
+    const Draw &draw) {
+  const Si32 thread_count = GetParallelThreadCount();
+  ParallelFor(0, thread_count, 1, [&](Si32 begin, Si32 end) {
+    for (Si32 first = begin; first < end; ++first) {
+      // Interleaved bands spread crowded areas over the threads.
+      for (Si32 band = first; band < band_count; band += thread_count) {
+        const Si32 y = band << kBandHeightLog2;
+        for (Si32 ref = bands.offsets[band]; ref < bands.offsets[band + 1];
+            ++ref) {
+          draw(bands.items[ref], y, y + kBandHeight);
+        }
+      }
+    }
+  });
+}
+
+// Scratch memory of the batches, kept between the calls.
+template<class Shader>
+struct RasterBatch {
+  std::vector<RasterTriangle> triangles;
+  std::vector<Shader> shaders;
+  std::vector<Ui8> is_visible;
+  RasterBands bands;
+};
+
+// Sets the triangles up in parallel with setup(i, &triangle, &shader),
+// which returns false for the triangles that are not drawn. Then bins
+// them into bands and draws the bands in parallel.
+template<class Shader, class Setup>
+static void RasterizeBatch(Si32 triangle_count, const Setup &setup,
+    Sprite to_sprite) {
+  Rgba *data = to_sprite.RgbaData();
+  const Si32 stride = to_sprite.StridePixels();
+  if (GetParallelThreadCount() == 1) {
+    // Binning pays off only when the bands are drawn in parallel.
+    RasterTriangle t;
+    Shader shader;
+    for (Si32 i = 0; i < triangle_count; ++i) {
+      if (setup(i, &t, &shader)) {
+        RasterizeTiles(t, t.bounds, data, stride, &shader);
+      }
+    }
+    return;
+  }
+
+  // The workers see the buffers of the calling thread through a reference.
+  static thread_local RasterBatch<Shader> scratch;
+  RasterBatch<Shader> &batch = scratch;
+  batch.triangles.resize(static_cast<size_t>(triangle_count));
+  batch.shaders.resize(static_cast<size_t>(triangle_count));
+  batch.is_visible.resize(static_cast<size_t>(triangle_count));
+  ParallelFor(0, triangle_count, kSetupTrianglesPerThreadMin,
+      [&](Si32 begin, Si32 end) {
+    for (Si32 i = begin; i < end; ++i) {
+      batch.is_visible[i] = setup(i, &batch.triangles[i], &batch.shaders[i]);
+    }
+  });
+
+  const Si32 band_count = BandCount(to_sprite.Height());
+  for (Si32 i = 0; i < triangle_count; ++i) {
+    if (!batch.is_visible[i]) {
+      continue;
+    }
+    const RasterTriangle &t = batch.triangles[i];
+    const RasterBounds &bounds = t.bounds;
+    const Si32 band_begin = bounds.y_begin >> kBandHeightLog2;
+    const Si32 band_end = ((bounds.y_end - 1) >> kBandHeightLog2) + 1;
+    for (Si32 band = band_begin; band < band_end; ++band) {
+      // Long thin triangles skip the bands they only pass by.
+      bool is_outside = false;
+      for (Si32 k = 0; k < 3 && band_end - band_begin > 1 && !is_outside;
+          ++k) {
+        const Si32 y = std::max(bounds.y_begin, band << kBandHeightLog2);
+        const Si32 y_end = std::min(bounds.y_end,
+          (band + 1) << kBandHeightLog2);
+        Si64 low;
+        Si64 high;
+        EdgeRange(t.edges[k], bounds.x_begin, y,
+          bounds.x_end - bounds.x_begin, y_end - y, &low, &high);
+        is_outside = high < 0;
+      }
+      if (!is_outside) {
+        batch.bands.Add(band, i);
+      }
+    }
+  }
+  batch.bands.Sort(band_count);
+  DrawBands(batch.bands, band_count, [&](Si32 i, Si32 y, Si32 y_end) {
+    const RasterTriangle &t = batch.triangles[i];
+    RasterBounds bounds = t.bounds;
+    bounds.y_begin = std::max(bounds.y_begin, y);
+    bounds.y_end = std::min(bounds.y_end, y_end);
+    RasterizeTiles(t, bounds, data, stride, &batch.shaders[i]);
+  });
+}
+
+// Number of triangles in a batch, checks the indices.
+static Si32 BatchTriangleCount(Si32 vertex_count, const Ui32 *indices,
+    Si32 index_count) {
+  if (!indices) {
+    Check(vertex_count % 3 == 0, "Error in RasterizeTriangles,"
+      " vertex_count must be a multiple of 3 when there are no indices.");
+    return vertex_count / 3;
+  }
+  Check(index_count % 3 == 0, "Error in RasterizeTriangles,"
+    " index_count must be a multiple of 3.");
+  for (Si32 i = 0; i < index_count; ++i) {
+    Check(indices[i] < static_cast<Ui32>(vertex_count),
+      "Error in RasterizeTriangles, index out of range.");
+  }
+  return index_count / 3;
+}
+
+void RasterizeTriangles(const Vec2F *positions, const Rgba *colors,
+    Si32 vertex_count, const Ui32 *indices, Si32 index_count,
+    Sprite to_sprite) {
+  const Si32 triangle_count = BatchTriangleCount(vertex_count,
+    indices, index_count);
+  const Si32 width = to_sprite.Width();
+  const Si32 height = to_sprite.Height();
+  RasterizeBatch<VertexColorShader>(triangle_count,
+      [&](Si32 i, RasterTriangle *t, VertexColorShader *shader) {
+    Si32 idx[3];
+    for (Si32 k = 0; k < 3; ++k) {
+      idx[k] = indices ? static_cast<Si32>(indices[i * 3 + k]) : i * 3 + k;
+    }
+    if (!SetupTriangle(positions[idx[0]], positions[idx[1]],
+        positions[idx[2]], width, height, t)) {
+      return false;
+    }
+    shader->Setup(*t, colors[idx[0]], colors[idx[1]], colors[idx[2]]);
+    return true;
+  }, to_sprite);
+}
+
+template<DrawBlendingMode kBlendingMode>
+static void RasterizeTexturedBatch(const Vec2F *positions,
+    const Vec2F *tex_coords, const Ui32 *indices, Si32 triangle_count,
+    Sprite texture, Sprite to_sprite) {
+  const Si32 width = to_sprite.Width();
+  const Si32 height = to_sprite.Height();
+  TextureShader<kBlendingMode> textured;
+  textured.SetTexture(texture);
+  RasterizeBatch<TextureShader<kBlendingMode>>(triangle_count,
+      [&](Si32 i, RasterTriangle *t, TextureShader<kBlendingMode> *shader) {
+    Si32 idx[3];
+    for (Si32 k = 0; k < 3; ++k) {
+      idx[k] = indices ? static_cast<Si32>(indices[i * 3 + k]) : i * 3 + k;
+    }
+    if (!SetupTriangle(positions[idx[0]], positions[idx[1]],
+        positions[idx[2]], width, height, t)) {
+      return false;
+    }
+    *shader = textured;
+    shader->Setup(*t, tex_coords[idx[0]], tex_coords[idx[1]],
+      tex_coords[idx[2]]);
+    return true;
+  }, to_sprite);
+}
+
+void RasterizeTexturedTriangles(const Vec2F *positions,
+    const Vec2F *tex_coords, Si32 vertex_count,
+    const Ui32 *indices, Si32 index_count,
+    Sprite texture, Sprite to_sprite, DrawBlendingMode blending_mode) {
+  const Si32 triangle_count = BatchTriangleCount(vertex_count,
+    indices, index_count);
+  if (texture.Width() <= 0 || texture.Height() <= 0) {
+    return;
+  }
+  switch (blending_mode) {
+    case kCopyRgba:
+      RasterizeTexturedBatch<kCopyRgba>(positions, tex_coords, indices,
+        triangle_count, texture, to_sprite);
+      break;
+    case kAlphaBlend:
+      RasterizeTexturedBatch<kAlphaBlend>(positions, tex_coords, indices,
+        triangle_count, texture, to_sprite);
+      break;
+  }
+}
+
+// A line segment of a batch in pixels.
+struct LineSegment {
+  Vec2F a;
+  Vec2F b;
+  Rgba color_a;
+  Rgba color_b;
+};
+
+// Colors along a line in 16.16 fixed point, step i has
+// value + step * i exactly, wherever the line is clipped.
+struct LineColor {
+#if defined(ARCTIC_SIMD_SSE2)
+  __m128i value;
+  __m128i step;
+#else
+  Si32 value[4];
+  Si32 step[4];
+#endif
+
+  // The line goes from color_a to color_b in step_count steps and is
+  // drawn from step first on.
+  void Setup(Rgba color_a, Rgba color_b, Si64 step_count, Si64 first) {
+    Si32 values[4];
+    Si32 steps[4];
+    for (Si32 c = 0; c < 4; ++c) {
+      const Si64 delta =
+        (static_cast<Si64>(color_b.element[c]) - color_a.element[c]) << 16;
+      steps[c] = step_count ? static_cast<Si32>(delta / step_count) : 0;
+      values[c] = static_cast<Si32>((static_cast<Si64>(color_a.element[c]) <<
+        16) + 0x8000 + steps[c] * first);
+    }
+#if defined(ARCTIC_SIMD_SSE2)
+    value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+    step = _mm_loadu_si128(reinterpret_cast<const __m128i*>(steps));
+#else
+    for (Si32 c = 0; c < 4; ++c) {
+      value[c] = values[c];
+      step[c] = steps[c];
+    }
+#endif
+  }
+
+  Rgba Get() const {
+#if defined(ARCTIC_SIMD_SSE2)
+    __m128i rgba = _mm_srai_epi32(value, 16);
+    rgba = _mm_packs_epi32(rgba, rgba);
+    rgba = _mm_packus_epi16(rgba, rgba);
+    return Rgba(static_cast<Ui32>(_mm_cvtsi128_si32(rgba)));
+#else
+    return Rgba(static_cast<Ui8>(value[0] >> 16),
+      static_cast<Ui8>(value[1] >> 16), static_cast<Ui8>(value[2] >> 16),
+      static_cast<Ui8>(value[3] >> 16));
+#endif
+  }
+
+  void Step() {
+#if defined(ARCTIC_SIMD_SSE2)
+    value = _mm_add_epi32(value, step);
+#else
+    for (Si32 c = 0; c < 4; ++c) {
+      value[c] += step[c];
+    }
+#endif
+  }
+};
+
+inline Si64 FloorDiv(Si64 a, Si64 b) {
+  return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+inline Si64 CeilDiv(Si64 a, Si64 b) {
+  return -FloorDiv(-a, b);
+}
+
+// Bresenham line between the pixels containing the segment ends, clipped
+// to the bounds exactly with integer math and copied to the target.
+static void DrawAliasedSegment(const LineSegment &segment,
+    const RasterBounds &clip, Rgba *data, Si32 stride) {
+  const Si64 x0 = static_cast<Si64>(std::floor(segment.a.x));
+  const Si64 y0 = static_cast<Si64>(std::floor(segment.a.y));
+  const Si64 dx = static_cast<Si64>(std::floor(segment.b.x)) - x0;
+  const Si64 dy = static_cast<Si64>(std::floor(segment.b.y)) - y0;
+  // u is the major axis, v is the minor one.
+  const bool is_x_major = std::abs(dx) >= std::abs(dy);
+  const Si64 u0 = is_x_major ? x0 : y0;
+  const Si64 v0 = is_x_major ? y0 : x0;
+  const Si64 du = is_x_major ? dx : dy;
+  const Si64 dv = is_x_major ? dy : dx;
+  const Si64 n = std::abs(du);
+  const Si64 m = std::abs(dv);
+  const Si64 u_sign = du < 0 ? -1 : 1;
+  const Si64 v_sign = dv < 0 ? -1 : 1;
+  const Si64 u_begin = is_x_major ? clip.x_begin : clip.y_begin;
+  const Si64 u_end = is_x_major ? clip.x_end : clip.y_end;
+  const Si64 v_begin = is_x_major ? clip.y_begin : clip.x_begin;
+  const Si64 v_end = is_x_major ? clip.y_end : clip.x_end;
+
+  // Step i in [0, n] draws u = u0 + u_sign * i, v = v0 + v_sign * q(i)
+  // where q(i) = floor((2 * m * i + n) / (2 * n)).
+  Si64 i_begin = 0;
+  Si64 i_end = n + 1;
+  Si64 q = 0;
+  const Si64 u1 = u0 + du;
+  const Si64 v1 = v0 + dv;
+  // Most segments are inside and skip the divisions.
+  if (std::min(u0, u1) < u_begin || std::max(u0, u1) >= u_end ||
+      std::min(v0, v1) < v_begin || std::max(v0, v1) >= v_end) {
+    if (u_sign > 0) {
+      i_begin = std::max(i_begin, u_begin - u0);
+      i_end = std::min(i_end, u_end - u0);
+    } else {
+      i_begin = std::max(i_begin, u0 - u_end + 1);
+      i_end = std::min(i_end, u0 - u_begin + 1);
+    }
+    const Si64 q_low = v_sign > 0 ? v_begin - v0 : v0 - v_end + 1;
+    const Si64 q_high = v_sign > 0 ? v_end - 1 - v0 : v0 - v_begin;
+    if (m == 0) {
+      if (q_low > 0 || q_high < 0) {
+        return;
+      }
+    } else {
+      i_begin = std::max(i_begin, CeilDiv(2 * n * q_low - n, 2 * m));
+      i_end = std::min(i_end,
+        FloorDiv(2 * n * (q_high + 1) - n - 1, 2 * m) + 1);
+      q = FloorDiv(2 * m * i_begin + n, 2 * n);
+    }
+    if (i_begin >= i_end) {
+      return;
+    }
+  }
+
+  const Si64 u = u0 + u_sign * i_begin;
+  const Si64 v = v0 + v_sign * q;
+  Rgba *to = data + (is_x_major ? v * stride + u : u * stride + v);
+  const Si32 major_step = static_cast<Si32>(is_x_major ?
+    u_sign : u_sign * stride);
+  const Si32 minor_step = static_cast<Si32>(is_x_major ?
+    v_sign * stride : v_sign);
+  const Si32 error_step = static_cast<Si32>(2 * m);
+  const Si32 error_limit = static_cast<Si32>(2 * n);
+  Si32 error = static_cast<Si32>(2 * m * i_begin + n - q * 2 * n);
+  const Si32 count = static_cast<Si32>(i_end - i_begin);
+  if (segment.color_a.rgba == segment.color_b.rgba) {
+    const Ui32 color = segment.color_a.rgba;
+    to->rgba = color;
+    for (Si32 i = 1; i < count; ++i) {
+      error += error_step;
+      if (error >= error_limit) {
+        error -= error_limit;
+        to += minor_step;
+      }
+      to += major_step;
+      to->rgba = color;
+    }
+    return;
+  }
+  LineColor color;
+  color.Setup(segment.color_a, segment.color_b, n, i_begin);
+  *to = color.Get();
+  for (Si32 i = 1; i < count; ++i) {
+    error += error_step;
+    if (error >= error_limit) {
+      error -= error_limit;
+      to += minor_step;
+    }
+    to += major_step;
+    color.Step();
+    *to = color.Get();
+  }
+}
+
+// Blends color with its alpha scaled by coverage in 0..256.
+inline void BlendCoverage(Rgba color, Si32 coverage, Rgba *to) {
+  color.a = static_cast<Ui8>((color.a * coverage) >> 8);
+  DrawPixel<kAlphaBlend>(color, to);
+}
+
+// Wu's antialiased line, blended to the target within the bounds.
+static void DrawAntialiasedSegment(const LineSegment &segment,
+    const RasterBounds &clip, Rgba *data, Si32 stride) {
+  // Coordinates where pixel centers are whole numbers.
+  const double ax = segment.a.x - 0.5;
+  const double ay = segment.a.y - 0.5;
+  const double bx = segment.b.x - 0.5;
+  const double by = segment.b.y - 0.5;
+  // u is the major axis, v is the minor one.
+  const bool is_x_major = std::fabs(bx - ax) >= std::fabs(by - ay);
+  double u0 = is_x_major ? ax : ay;
+  double v0 = is_x_major ? ay : ax;
+  double u1 = is_x_major ? bx : by;
+  double v1 = is_x_major ? by : bx;
+  Rgba color_0 = segment.color_a;
+  Rgba color_1 = segment.color_b;
+  if (u0 > u1) {
+    std::swap(u0, u1);
+    std::swap(v0, v1);
+    std::swap(color_0, color_1);
+  }
+  const double gradient = u1 > u0 ? (v1 - v0) / (u1 - u0) : 0.0;
+  const Si32 u_begin = is_x_major ? clip.x_begin : clip.y_begin;
+  const Si32 u_end = is_x_major ? clip.x_end : clip.y_end;
+  const Si32 v_begin = is_x_major ? clip.y_begin : clip.x_begin;
+  const Si32 v_end = is_x_major ? clip.y_end : clip.x_end;
+
+  // The end columns are covered only partly along the major axis.
+  const Si64 c_first = static_cast<Si64>(std::floor(u0 + 0.5));
+  const Si64 c_last = static_cast<Si64>(std::floor(u1 + 0.5));
+  Si32 cover_first = static_cast<Si32>(
+    (static_cast<double>(c_first) + 0.5 - u0) * 256.0);
+  Si32 cover_last = static_cast<Si32>(
+    (u1 - (static_cast<double>(c_last) - 0.5)) * 256.0);
+  if (c_first == c_last) {
+    cover_first = cover_last = static_cast<Si32>((u1 - u0) * 256.0);
+  }
+  Si64 c_begin = std::max<Si64>(c_first, u_begin);
+  Si64 c_end = std::min<Si64>(c_last + 1, u_end);
+  if (gradient != 0.0) {
+    // Columns whose pixel pair may reach the minor range.
+    const double low = u0 + (v_begin - 1 - v0) / gradient;
+    const double high = u0 + (v_end - v0) / gradient;
+    c_begin = std::max(c_begin,
+      static_cast<Si64>(std::floor(std::min(low, high))) - 1);
+    c_end = std::min(c_end,
+      static_cast<Si64>(std::ceil(std::max(low, high))) + 2);
+  }
+  if (c_begin >= c_end) {
+    return;
+  }
+
+  // The minor coordinate in 32.32 fixed point, stepping it is exact so
+  // the pixels do not depend on where the segment is clipped.
+  const double one = 4294967296.0;
+  const Si64 v_step = static_cast<Si64>(std::floor(gradient * one + 0.5));
+  const Si64 v_first = static_cast<Si64>(std::floor((v0 + gradient *
+    (static_cast<double>(c_first) - u0)) * one + 0.5));
+  Si64 v = v_first + v_step * (c_begin - c_first);
+  LineColor color;
+  color.Setup(color_0, color_1, c_last - c_first, c_begin - c_first);
+  const Si32 major_step = is_x_major ? 1 : stride;
+  const Si32 minor_step = is_x_major ? stride : 1;
+  for (Si64 c = c_begin; c < c_end; ++c) {
+    const Si32 vi = static_cast<Si32>(v >> 32);
+    const Si32 high = static_cast<Si32>((v >> 24) & 255);
+    Si32 cover = 256;
+    if (c == c_first) {
+      cover = cover_first;
+    } else if (c == c_last) {
+      cover = cover_last;
+    }
+    const Rgba rgba = color.Get();
+    // The two pixels may lie outside the target, so their pointers are
+    // formed only after the clip test.
+    Rgba *line = data + c * major_step;
+    if (vi >= v_begin && vi < v_end) {
+      BlendCoverage(rgba, ((256 - high) * cover) >> 8,
+        line + static_cast<Si64>(vi) * minor_step);
+    }
+    if (vi + 1 >= v_begin && vi + 1 < v_end) {
+      BlendCoverage(rgba, (high * cover) >> 8,
+        line + static_cast<Si64>(vi + 1) * minor_step);
+    }
+    v += v_step;
+    color.Step();
+  }
+}
+
+static void DrawSegment(const LineSegment &segment, DrawLineMode mode,
+    const RasterBounds &clip, Rgba *data, Si32 stride) {
+  if (mode == kLineAntialiased) {
+    DrawAntialiasedSegment(segment, clip, data, stride);
+  } else {
+    DrawAliasedSegment(segment, clip, data, stride);
+  }
+}
+
+// Cohen-Sutherland outcode of a point against the target grown by a
+// pixel, segments whose ends share a bit are outside.
+inline Ui32 Outcode(Vec2F p, float width, float height) {
+  return static_cast<Ui32>(p.x < -1.f) |
+    (static_cast<Ui32>(p.x > width + 1.f) << 1) |
+    (static_cast<Ui32>(p.y < -1.f) << 2) |
+    (static_cast<Ui32>(p.y > height + 1.f) << 3);
+}
+
+// Draws segment i from points[first(i)] to points[first(i) + 1]. Colors
+// advance by color_step per point, 0 gives every point the same color.
+template<class First>
+static void RasterizeSegments(const Vec2F *points, const Rgba *colors,
+    Si32 color_step, Si32 segment_count, const First &first,
+    DrawLineMode mode, Sprite to_sprite) {
+  const Si32 width = to_sprite.Width();
+  const Si32 height = to_sprite.Height();
+  Rgba *data = to_sprite.RgbaData();
+  const Si32 stride = to_sprite.StridePixels();
+  RasterBounds clip;
+  clip.x_begin = 0;
+  clip.x_end = width;
+  clip.y_begin = 0;
+  clip.y_end = height;
+  // The workers see the buffers of the calling thread through a reference.
+  static thread_local std::vector<LineSegment> scratch_segments;
+  static thread_local RasterBands scratch_bands;
+  std::vector<LineSegment> &segments = scratch_segments;
+  segments.clear();
+  const float width_f = static_cast<float>(width);
+  const float height_f = static_cast<float>(height);
+  for (Si32 i = 0; i < segment_count; ++i) {
+    const Si32 a = first(i);
+    const Si32 b = a + 1;
+    LineSegment segment;
+    segment.a = points[a];
+    segment.b = points[b];
+    if (!(std::fabs(segment.a.x) < kLineGuardBand &&
+        std::fabs(segment.a.y) < kLineGuardBand &&
+        std::fabs(segment.b.x) < kLineGuardBand &&
+        std::fabs(segment.b.y) < kLineGuardBand) ||
+        (Outcode(segment.a, width_f, height_f) &
+        Outcode(segment.b, width_f, height_f))) {
+      continue;
+    }
+    segment.color_a = colors[a * color_step];
+    segment.color_b = colors[b * color_step];
+    segments.push_back(segment);
+  }
+
+  const Si32 visible_count = static_cast<Si32>(segments.size());
+  if (visible_count < kBinnedLinesMin || GetParallelThreadCount() == 1) {
+    for (const LineSegment &segment : segments) {
+      DrawSegment(segment, mode, clip, data, stride);
+    }
+    return;
+  }
+  RasterBands &bands = scratch_bands;
+  const Si32 band_count = BandCount(height);
+  for (Si32 i = 0; i < visible_count; ++i) {
+    const LineSegment &segment = segments[i];
+    // Rows the segment may touch, antialiased ones reach a row further.
+    const float y_min = std::min(segment.a.y, segment.b.y);
+    const float y_max = std::max(segment.a.y, segment.b.y);
+    const Si32 y_begin = std::max(0,
+      static_cast<Si32>(std::floor(y_min)) - 1);
+    const Si32 y_end = std::min(height,
+      static_cast<Si32>(std::floor(y_max)) + 2);
+    if (y_begin >= y_end) {
+      continue;
+    }
+    const Si32 band_end = ((y_end - 1) >> kBandHeightLog2) + 1;
+    for (Si32 band = y_begin >> kBandHeightLog2; band < band_end; ++band) {
+      bands.Add(band, i);
+    }
+  }
+  bands.Sort(band_count);
+  DrawBands(bands, band_count, [&](Si32 i, Si32 y, Si32 y_end) {
+    RasterBounds band_clip = clip;
+    band_clip.y_begin = y;
+    band_clip.y_end = std::min(y_end, height);
+    DrawSegment(segments[i], mode, band_clip, data, stride);
+  });
+}
+
+static void CheckLineArguments(const Vec2F *points, const Rgba *colors,
+    Si32 point_count) {
+  Check(point_count >= 0, "Error in RasterizeLines, point_count < 0.");
+  Check(point_count == 0 || (points && colors),
+    "Error in RasterizeLines, points and colors are required.");
+}
+
+void RasterizeLines(const Vec2F *points, const Rgba *colors,
+    Si32 point_count, DrawLineMode mode, Sprite to_sprite) {
+  CheckLineArguments(points, colors, point_count);
+  RasterizeSegments(points, colors, 1, point_count / 2,
+    [](Si32 i) { return i * 2; }, mode, to_sprite);
+}
+
+void RasterizeLines(const Vec2F *points, Si32 point_count, Rgba color,
+    DrawLineMode mode, Sprite to_sprite) {
+  CheckLineArguments(points, &color, point_count);
+  RasterizeSegments(points, &color, 0, point_count / 2,
+    [](Si32 i) { return i * 2; }, mode, to_sprite);
+}
+
+void RasterizePolyline(const Vec2F *points, const Rgba *colors,
+    Si32 point_count, DrawLineMode mode, Sprite to_sprite) {
+  CheckLineArguments(points, colors, point_count);
+  RasterizeSegments(points, colors, 1, std::max(0, point_count - 1),
+    [](Si32 i) { return i; }, mode, to_sprite);
+}
+
+void RasterizePolyline(const Vec2F *points, Si32 point_count, Rgba color,
+    DrawLineMode mode, Sprite to_sprite) {
+  CheckLineArguments(points, &color, point_count);
+  RasterizeSegments(points, &color, 0, std::max(0, point_count - 1),
+    [](Si32 i) { return i; }, mode, to_sprite);
+}
+
+}  // namespace easy
+}  // namespace arctic
@@ -0,0 +1,94 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_EASY_RASTERIZER_H_
+#define ENGINE_EASY_RASTERIZER_H_
+
+#include "engine/easy_sprite.h"
+#include "engine/rgba.h"
+#include "engine/vec2f.h"
+
+namespace arctic {
+namespace easy {
+
+// How line batches are drawn.
+enum DrawLineMode {
+  // Bresenham lines copied to the target.
+  kLineAliased,
+  // Wu's lines blended to the target by coverage.
+  kLineAntialiased
+};
+
+// Triangle rasterizer working on 8x8 pixel tiles. Edges are integer edge
+// functions with 1/16 pixel precision and the top-left fill rule, so
+// triangles that share an edge neither overlap nor leave a gap. Vertices
+// are in pixels with pixel centers at +0.5. Triangles reaching farther
+// than 65536 pixels from the origin are not drawn.
+
+// Fills a triangle, interpolating the vertex colors.
+void RasterizeTriangle(Vec2F a, Vec2F b, Vec2F c,
+  Rgba color_a, Rgba color_b, Rgba color_c, Sprite to_sprite);
+
+// Draws a triangle of texture, texture coordinates are in texels.
+void RasterizeTexturedTriangle(Vec2F a, Vec2F b, Vec2F c,
+  Vec2F tex_a, Vec2F tex_b, Vec2F tex_c,
+  Sprite texture, Sprite to_sprite, DrawBlendingMode blending_mode);
+
+// Batches of triangles, each three indices form a triangle. With no
+// indices each three consecutive vertices do. The triangles are set up in
+// parallel, binned into 32 pixel high bands and the bands are drawn in
+// parallel, overlapping triangles are drawn in the order given.
+
+// Fills triangles, interpolating the vertex colors.
+void RasterizeTriangles(const Vec2F *positions, const Rgba *colors,
+  Si32 vertex_count, const Ui32 *indices, Si32 index_count,
+  Sprite to_sprite);
+
+// Draws triangles of texture, texture coordinates are in texels.
+void RasterizeTexturedTriangles(const Vec2F *positions,
+  const Vec2F *tex_coords, Si32 vertex_count,
+  const Ui32 *indices, Si32 index_count,
+  Sprite texture, Sprite to_sprite, DrawBlendingMode blending_mode);
+
+// Line batches. Aliased segments go between the pixels the points are in,
+// antialiased ones between the points. Segments outside the target are
+// rejected in bulk, the rest are clipped once. Large batches are binned
+// into bands that are drawn in parallel. Colors are given per point and
+// interpolated along the segments. Points farther than 8388608 pixels
+// from the origin are not drawn.
+
+// Draws segments from points[2 * i] to points[2 * i + 1].
+void RasterizeLines(const Vec2F *points, const Rgba *colors,
+  Si32 point_count, DrawLineMode mode, Sprite to_sprite);
+void RasterizeLines(const Vec2F *points, Si32 point_count, Rgba color,
+  DrawLineMode mode, Sprite to_sprite);
+
+// Draws segments joining the consecutive points.
+void RasterizePolyline(const Vec2F *points, const Rgba *colors,
+  Si32 point_count, DrawLineMode mode, Sprite to_sprite);
+void RasterizePolyline(const Vec2F *points, Si32 point_count, Rgba color,
+  DrawLineMode mode, Sprite to_sprite);
+
+}  // namespace easy
+}  // namespace arctic
+
+#endif  // ENGINE_EASY_RASTERIZER_H_
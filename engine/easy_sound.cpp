@@ -26,11 +26,12 @@
 #include <vector>
 
 #include "engine/arctic_platform.h"
+#include "engine/arctic_sound_convert.h"
 #include "engine/easy.h"
 #include "engine/easy_sound_instance.h"
+#include "engine/easy_sound_stream.h"
 
 #define STB_VORBIS_NO_PUSHDATA_API
-#define STB_VORBIS_NO_STDIO
 #define STB_VORBIS_MAX_CHANNELS    2
 #include "engine/stb_vorbis.inc"
 
@@ -51,21 +52,43 @@ void Sound::Load(const char *file_name, bool do_unpack) {
     sound_instance_ = LoadWav(data.data(), data.size());
   } else if (strcmp(last_dot, ".ogg") == 0) {
     std::vector<Ui8> data = ReadFile(file_name);
+    int error = 0;
+    vorbis_codec_ = stb_vorbis_open_memory(data.data(),
+      static_cast<int>(data.size()), &error, nullptr);
+    Check(!!vorbis_codec_, "Error in Sound::Load, can't decode ogg file: ",
+      file_name);
+    stb_vorbis_info info = stb_vorbis_get_info(vorbis_codec_);
+    Si32 channels = (info.channels == 1 ? 1 : 2);
+    Si32 size = static_cast<Si32>(
+      stb_vorbis_stream_length_in_samples(vorbis_codec_));
     if (do_unpack) {
-      int error = 0;
-      vorbis_codec_ = stb_vorbis_open_memory(data.data(),
-        static_cast<int>(data.size()), &error, nullptr);
-      Si32 size = stb_vorbis_stream_length_in_samples(vorbis_codec_);
-      sound_instance_.reset(new SoundInstance(size));
-      // int res =
-      stb_vorbis_get_samples_short_interleaved(
-        vorbis_codec_, 2, sound_instance_->GetWavData(), size * 2);
-      // TODO(Huldra): if (res) {
-      stb_vorbis_close(vorbis_codec_);
-      vorbis_codec_ = nullptr;
+      sound_instance_.reset(new SoundInstance(kSoundDataWav, size, channels));
+      // Decodes to float and converts with dither instead of letting stb
+      // round each sample separately.
+      const Si32 kChunkFrames = 4096;
+      std::vector<float> planar(static_cast<size_t>(kChunkFrames) * 2);
+      float *buffers[2] = {planar.data(), planar.data() + kChunkFrames};
+      Si16 *out = sound_instance_->GetWavData();
+      Ui32 dither_state = 1;
+      Si32 position = 0;
+      while (position < size) {
+        Si32 frames = stb_vorbis_get_samples_float(vorbis_codec_, channels,
+          buffers, std::min(kChunkFrames, size - position));
+        if (frames <= 0) {
+          break;
+        }
+        ConvertFloatToS16(buffers, channels, frames,
+          out + static_cast<size_t>(position) * channels, &dither_state);
+        position += frames;
+      }
+      std::fill(out + static_cast<size_t>(position) * channels,
+        out + static_cast<size_t>(size) * channels, Si16(0));
     } else {
-      sound_instance_.reset(new SoundInstance(data));
+      sound_instance_.reset(new SoundInstance(std::move(data), channels,
+        size));
     }
+    stb_vorbis_close(vorbis_codec_);
+    vorbis_codec_ = nullptr;
   } else {
     Fatal("Error in Sprite::Load, unknown file extension.");
   }
@@ -79,6 +102,17 @@ void Sound::Load(const std::string &file_name, bool do_unpack) {
   Load(file_name.c_str(), do_unpack);
 }
 
+void Sound::LoadStreamed(const char *file_name) {
+  Clear();
+  Check(!!file_name, "Error in Sound::LoadStreamed, file_name is nullptr.");
+  std::shared_ptr<SoundStream> stream(new SoundStream(file_name));
+  sound_instance_.reset(new SoundInstance(stream));
+}
+
+void Sound::LoadStreamed(const std::string &file_name) {
+  LoadStreamed(file_name.c_str());
+}
+
 void Sound::Create(double duration) {
   Clear();
   double samples = duration * 44100.f + 0.5f;
@@ -91,7 +125,21 @@ void Sound::Create(double duration) {
   }
 }
 
+void Sound::Create(SoundCallback callback, Si32 channels) {
+  Clear();
+  sound_instance_.reset(new SoundInstance(std::move(callback), channels));
+}
+
+void Sound::SetParameter(Si32 index, float value) {
+  sound_instance_->GetParameters()->Set(index, value);
+}
+
+float Sound::GetParameter(Si32 index) {
+  return sound_instance_->GetParameters()->Get(index);
+}
+
 void Sound::Clear() {
+  adpcm_cursor_ = AdpcmCursor();
   if (vorbis_codec_) {
     stb_vorbis_close(vorbis_codec_);
     vorbis_codec_ = nullptr;
@@ -99,6 +147,17 @@ void Sound::Clear() {
   sound_instance_.reset();
 }
 
+void Sound::Compress() {
+  if (!sound_instance_ || sound_instance_->GetFormat() != kSoundDataWav) {
+    return;
+  }
+  adpcm_cursor_ = AdpcmCursor();
+  const SoundBus bus = sound_instance_->GetBus();
+  sound_instance_ = EncodeAdpcm(sound_instance_->GetWavData(),
+    sound_instance_->GetDurationSamples(), sound_instance_->GetChannels());
+  sound_instance_->SetBus(bus);
+}
+
 void Sound::Play() {
   Play(1.0f);
 }
@@ -107,34 +166,28 @@ void Sound::Play(float volume) {
   arctic::StartSoundBuffer(*this, volume);
 }
 
+void Sound::Play(float volume, Si32 priority) {
+  arctic::StartSoundBuffer(*this, volume, priority);
+}
+
+void Sound::Play(float volume, Si32 priority, float pan) {
+  arctic::StartSoundBuffer(*this, volume, priority, pan);
+}
+
 void Sound::Stop() {
   arctic::StopSoundBuffer(*this);
 }
 
+void Sound::SetBus(SoundBus bus) {
+  sound_instance_->SetBus(bus);
+}
+
+SoundBus Sound::GetBus() {
+  return sound_instance_->GetBus();
+}
+
 double Sound::Duration() const {
-  Si32 duration_samples = 0;
-  switch (sound_instance_->GetFormat()) {
-  case kSoundDataWav: {
-    duration_samples = sound_instance_->GetDurationSamples();
-    break;
-  }
-  case kSoundDataVorbis: {
-    if (vorbis_codec_) {
-      duration_samples =
-        stb_vorbis_stream_length_in_samples(vorbis_codec_);
-    } else {
-      int error = 0;
-      stb_vorbis *vorbis_codec = stb_vorbis_open_memory(
-        sound_instance_->GetVorbisData(),
-        sound_instance_->GetVorbisSize(), &error, nullptr);
-      duration_samples = stb_vorbis_stream_length_in_samples(
-        vorbis_codec_);
-      stb_vorbis_close(vorbis_codec);
-    }
-    break;
-  }
-  }
-  return static_cast<double>(duration_samples) * (1.0 / 44100.0);
+  return sound_instance_->GetDuration();
 }
 
 Si16 *Sound::RawData() {
@@ -145,8 +198,24 @@ Si32 Sound::DurationSamples() {
   return sound_instance_->GetDurationSamples();
 }
 
+Si32 Sound::Channels() {
+  return sound_instance_->GetChannels();
+}
+
 Si32 Sound::StreamOut(Si32 offset, Si32 size,
-  Si16 *out_buffer, Si32 out_buffer_samples) {
+    Si16 *out_buffer, Si32 out_buffer_samples) {
+  if (sound_instance_->GetChannels() == 2) {
+    return StreamOutNative(offset, size, out_buffer, out_buffer_samples);
+  }
+  size = std::min(size, out_buffer_samples / 2);
+  Si32 frames = StreamOutNative(offset, size, out_buffer, size);
+  ExpandMonoToStereo(out_buffer, frames, out_buffer);
+  return frames;
+}
+
+Si32 Sound::StreamOutNative(Si32 offset, Si32 size,
+    Si16 *out_buffer, Si32 out_buffer_samples) {
+  const Si32 channels = sound_instance_->GetChannels();
   switch (sound_instance_->GetFormat()) {
   case kSoundDataWav: {
     Si16 *data = sound_instance_->GetWavData();
@@ -156,10 +225,24 @@ Si32 Sound::StreamOut(Si32 offset, Si32 size,
     if (offset + size > sound_instance_->GetDurationSamples()) {
       return 0;
     }
-    Si32 to_copy = std::min(size, out_buffer_samples / 2);
-    memcpy(out_buffer, data + offset * 2, to_copy * 4);
+    Si32 to_copy = std::min(size, out_buffer_samples / channels);
+    memcpy(out_buffer, data + offset * channels,
+      to_copy * channels * sizeof(Si16));
     return to_copy;
   }
+  case kSoundDataAdpcm: {
+    return sound_instance_->DecodeAdpcm(offset,
+      std::min(size, out_buffer_samples / channels), out_buffer,
+      &adpcm_cursor_);
+  }
+  case kSoundDataStream: {
+    return sound_instance_->GetStream()->Read(offset,
+      std::min(size, out_buffer_samples / channels), out_buffer);
+  }
+  case kSoundDataCallback: {
+    return sound_instance_->Generate(offset,
+      std::min(size, out_buffer_samples / channels), out_buffer);
+  }
   case kSoundDataVorbis: {
     int error = 0;
     if (!vorbis_codec_) {
@@ -167,10 +250,14 @@ Si32 Sound::StreamOut(Si32 offset, Si32 size,
         sound_instance_->GetVorbisData(),
         sound_instance_->GetVorbisSize(), &error, nullptr);
     }
-    stb_vorbis_seek(vorbis_codec_, offset);
+    // Playback reads consecutive blocks, only a jump needs the costly seek.
+    if (stb_vorbis_get_sample_offset(vorbis_codec_) != offset) {
+      stb_vorbis_seek(vorbis_codec_, offset);
+    }
+    const Si32 requested = std::min(size, out_buffer_samples / channels);
     int res = stb_vorbis_get_samples_short_interleaved(
-      vorbis_codec_, 2, out_buffer, out_buffer_samples);
-    if (res < out_buffer_samples / 2) {
+      vorbis_codec_, channels, out_buffer, requested * channels);
+    if (res < requested) {
       stb_vorbis_close(vorbis_codec_);
       vorbis_codec_ = nullptr;
     }
@@ -37,21 +37,52 @@ class Sound {
  private:
   std::shared_ptr<SoundInstance> sound_instance_;
   stb_vorbis *vorbis_codec_ = nullptr;
+  // Each playing voice holds its own copy of the sound, so this is the
+  // decode position of that voice.
+  AdpcmCursor adpcm_cursor_;
  public:
   void Load(const std::string &file_name, bool do_unpack);
   void Load(const char *file_name, bool do_unpack);
   void Load(const char *file_name);
   void Load(const std::string &file_name);
+  // Plays an OGG file from disk, decoding it on a background thread
+  // with a few hundred KiB of memory. Meant for long music tracks.
+  void LoadStreamed(const char *file_name);
+  void LoadStreamed(const std::string &file_name);
   void Create(double duration);
+  // Creates a sound generated on the fly by the callback while it plays.
+  void Create(SoundCallback callback, Si32 channels = 2);
+  // Passes a value to the callback of a sound created from one.
+  void SetParameter(Si32 index, float value);
+  float GetParameter(Si32 index);
   void Clear();
+  // Converts unpacked samples to IMA-ADPCM, it takes a quarter of the
+  // memory and is cheap to decode while mixing.
+  void Compress();
   void Play();
   void Play(float volume);
+  void Play(float volume, Si32 priority);
+  // Pan goes from -1 for left only to 1 for right only, 0 plays a mono
+  // sound at full volume on both sides. Stereo sounds ignore it.
+  void Play(float volume, Si32 priority, float pan);
   void Stop();
+  // Routes the sound through a mixer bus, kSoundBusSfx by default.
+  void SetBus(SoundBus bus);
+  SoundBus GetBus();
   double Duration() const;
   Si32 DurationSamples();
+  Si32 Channels();
+  // Interleaved samples, Channels() per frame, nullptr unless unpacked.
+  // Mono sounds are no longer expanded to stereo on load, so they hold
+  // one sample per frame. Use StreamOut to get stereo frames.
   Si16 *RawData();
+  // Writes up to size stereo frames starting at offset.
   Si32 StreamOut(Si32 offset, Si32 size,
       Si16 *out_buffer, Si32 out_buffer_samples);
+  // Writes up to size frames of Channels() samples each, so mono sounds
+  // are not expanded to stereo.
+  Si32 StreamOutNative(Si32 offset, Si32 size,
+      Si16 *out_buffer, Si32 out_buffer_samples);
   std::shared_ptr<SoundInstance> GetInstance();
   bool IsPlaying();
 };
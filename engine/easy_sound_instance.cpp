@@ -21,9 +21,13 @@
 
 #include "engine/easy_sound_instance.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 
 #include "engine/arctic_platform.h"
+#include "engine/arctic_sound_convert.h"
+#include "engine/easy_sound_stream.h"
 
 namespace arctic {
 namespace easy {
@@ -62,19 +66,144 @@ struct WaveHeader {
 };
 #pragma pack()
 
-SoundInstance::SoundInstance(Ui32 wav_samples) {
-  format_ = kSoundDataWav;
+static const Si32 g_adpcm_index_table[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const Si32 g_adpcm_step_table[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+  19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+  130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+  337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+  876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+  2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+  5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+inline Si16 DecodeAdpcmNibble(Ui32 nibble, Si32 *predictor, Si32 *index) {
+  const Si32 step = g_adpcm_step_table[*index];
+  Si32 diff = step >> 3;
+  if (nibble & 4) {
+    diff += step;
+  }
+  if (nibble & 2) {
+    diff += step >> 1;
+  }
+  if (nibble & 1) {
+    diff += step >> 2;
+  }
+  Si32 value = (nibble & 8) ? *predictor - diff : *predictor + diff;
+  value = value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+  *predictor = value;
+  Si32 next_index = *index + g_adpcm_index_table[nibble];
+  *index = next_index < 0 ? 0 : (next_index > 88 ? 88 : next_index);
+  return static_cast<Si16>(value);
+}
+
+inline Ui32 EncodeAdpcmNibble(Si32 sample, Si32 *predictor, Si32 *index) {
+  const Si32 step = g_adpcm_step_table[*index];
+  Si32 diff = sample - *predictor;
+  Ui32 nibble = 0;
+  if (diff < 0) {
+    nibble = 8;
+    diff = -diff;
+  }
+  if (diff >= step) {
+    nibble |= 4;
+    diff -= step;
+  }
+  if (diff >= (step >> 1)) {
+    nibble |= 2;
+    diff -= step >> 1;
+  }
+  if (diff >= (step >> 2)) {
+    nibble |= 1;
+  }
+  // Keeps the encoder state in sync with what the decoder will see.
+  DecodeAdpcmNibble(nibble, predictor, index);
+  return nibble;
+}
+
+static Ui64 DataSize(SoundDataFormat format, Ui32 samples, Si32 channels) {
+  if (format == kSoundDataAdpcm) {
+    Ui64 blocks = (static_cast<Ui64>(samples) + kAdpcmBlockSamples - 1) /
+      kAdpcmBlockSamples;
+    return blocks * kAdpcmChannelBlockBytes * channels;
+  }
+  return static_cast<Ui64>(samples) * channels * sizeof(Si16);
+}
+
+SoundParameters::SoundParameters() {
+  for (Si32 idx = 0; idx < kCount; ++idx) {
+    values_[idx].store(0.0f, std::memory_order_relaxed);
+  }
+}
+
+void SoundParameters::Set(Si32 index, float value) {
+  Check(index >= 0 && index < kCount,
+      "Error in SoundParameters::Set, index is out of range.");
+  values_[index].store(value, std::memory_order_release);
+}
+
+float SoundParameters::Get(Si32 index) const {
+  Check(index >= 0 && index < kCount,
+      "Error in SoundParameters::Get, index is out of range.");
+  return values_[index].load(std::memory_order_acquire);
+}
+
+SoundInstance::SoundInstance(Ui32 wav_samples)
+    : SoundInstance(kSoundDataWav, wav_samples, 2) {
+}
+
+SoundInstance::SoundInstance(SoundDataFormat format, Ui32 samples,
+    Si32 channels) {
+  Check(format != kSoundDataVorbis,
+      "Error in SoundInstance, use the vorbis_file constructor.");
+  Check(channels == 1 || channels == 2,
+      "Error in SoundInstance, channels is not 1 or 2.");
+  format_ = format;
+  channels_ = channels;
+  duration_samples_ = static_cast<Si32>(samples);
+  bus_ = kSoundBusSfx;
   playing_count_ = 0;
-  data_.Resize(wav_samples * 2 * sizeof(Si16));
+  data_.Resize(DataSize(format, samples, channels));
 }
 
-SoundInstance::SoundInstance(std::vector<Ui8> vorbis_file) {
+SoundInstance::SoundInstance(std::vector<Ui8> vorbis_file, Si32 channels,
+    Si32 duration_samples) {
   format_ = kSoundDataVorbis;
+  channels_ = channels;
+  duration_samples_ = duration_samples;
+  bus_ = kSoundBusSfx;
   playing_count_ = 0;
   data_.Resize(vorbis_file.size());
   std::memcpy(data_.data(), vorbis_file.data(), vorbis_file.size());
 }
 
+SoundInstance::SoundInstance(std::shared_ptr<SoundStream> stream) {
+  format_ = kSoundDataStream;
+  channels_ = stream->GetChannels();
+  duration_samples_ = stream->GetDurationSamples();
+  stream_ = std::move(stream);
+  bus_ = kSoundBusSfx;
+  playing_count_ = 0;
+}
+
+SoundInstance::SoundInstance(SoundCallback callback, Si32 channels) {
+  Check(!!callback, "Error in SoundInstance, callback is empty.");
+  Check(channels == 1 || channels == 2,
+      "Error in SoundInstance, channels is not 1 or 2.");
+  format_ = kSoundDataCallback;
+  channels_ = channels;
+  duration_samples_ = 0;
+  callback_ = std::move(callback);
+  bus_ = kSoundBusSfx;
+  playing_count_ = 0;
+}
+
 Si16* SoundInstance::GetWavData() {
   if (format_ == kSoundDataWav) {
     return static_cast<Si16*>(data_.GetVoidData());
@@ -91,16 +220,146 @@ Si32 SoundInstance::GetVorbisSize() const {
   return static_cast<Ui32>(data_.size());
 }
 
+Ui8* SoundInstance::GetAdpcmData() {
+  if (format_ == kSoundDataAdpcm) {
+    return static_cast<Ui8*>(data_.GetVoidData());
+  } else {
+    return nullptr;
+  }
+}
+
+SoundStream* SoundInstance::GetStream() const {
+  return stream_.get();
+}
+
+SoundParameters* SoundInstance::GetParameters() {
+  return &parameters_;
+}
+
+Si32 SoundInstance::Generate(Si32 offset, Si32 size, Si16 *out_buffer) {
+  if (format_ != kSoundDataCallback || size <= 0) {
+    return 0;
+  }
+  Si32 frames = callback_(parameters_, offset, size, out_buffer);
+  return std::max(0, std::min(frames, size));
+}
+
 SoundDataFormat SoundInstance::GetFormat() const {
   return format_;
 }
 
-Si32 SoundInstance::GetDurationSamples() {
-  if (format_ == kSoundDataWav) {
-    return static_cast<Si32>(data_.size() / 4);
-  } else {
+Si32 SoundInstance::GetChannels() const {
+  return channels_;
+}
+
+SoundBus SoundInstance::GetBus() const {
+  return static_cast<SoundBus>(bus_.load());
+}
+
+void SoundInstance::SetBus(SoundBus bus) {
+  Check(bus >= 0 && bus < kSoundBusCount,
+      "Error in SoundInstance::SetBus, bus is out of range.");
+  bus_ = bus;
+}
+
+Si32 SoundInstance::GetDurationSamples() const {
+  return duration_samples_;
+}
+
+double SoundInstance::GetDuration() const {
+  // The mixer plays every sound at 44100 Hz, whatever its file says.
+  return static_cast<double>(duration_samples_) / 44100.0;
+}
+
+Si32 SoundInstance::DecodeAdpcm(Si32 offset, Si32 size,
+    Si16 *out_buffer, AdpcmCursor *cursor) const {
+  if (format_ != kSoundDataAdpcm || offset < 0 || size <= 0) {
+    return 0;
+  }
+  size = std::min(size, duration_samples_ - offset);
+  if (size <= 0) {
     return 0;
   }
+  const Ui8 *data = static_cast<const Ui8*>(data_.GetVoidData());
+  const Si32 end = offset + size;
+  Si32 block_begin = offset - offset % kAdpcmBlockSamples;
+  for (; block_begin < end; block_begin += kAdpcmBlockSamples) {
+    const Ui8 *block = data + static_cast<Ui64>(
+      block_begin / kAdpcmBlockSamples) * kAdpcmChannelBlockBytes * channels_;
+    const Si32 from = std::max(offset, block_begin) - block_begin;
+    const Si32 to = std::min(end, block_begin + kAdpcmBlockSamples) -
+      block_begin;
+    // Continues from the cursor when it stopped inside this block.
+    const bool is_continued = cursor && from > 0 &&
+      cursor->position == block_begin + from;
+    for (Si32 channel = 0; channel < channels_; ++channel) {
+      const Ui8 *header = block + channel * kAdpcmChannelBlockBytes;
+      Si32 predictor = static_cast<Si16>(
+        static_cast<Ui16>(header[0]) | (static_cast<Ui16>(header[1]) << 8));
+      Si32 index = header[2];
+      Si32 i = 0;
+      if (is_continued) {
+        predictor = cursor->predictor[channel];
+        index = cursor->index[channel];
+        i = from;
+      }
+      const Ui8 *codes = header + 4;
+      Si16 *out = out_buffer +
+        (block_begin + from - offset) * channels_ + channel;
+      for (; i < to; ++i) {
+        Ui32 nibble = (codes[i >> 1] >> ((i & 1) * 4)) & 15;
+        Si16 value = DecodeAdpcmNibble(nibble, &predictor, &index);
+        if (i >= from) {
+          *out = value;
+          out += channels_;
+        }
+      }
+      if (cursor) {
+        cursor->predictor[channel] = predictor;
+        cursor->index[channel] = index;
+      }
+    }
+    if (cursor) {
+      cursor->position = block_begin + to;
+    }
+  }
+  return size;
+}
+
+std::shared_ptr<easy::SoundInstance> EncodeAdpcm(const Si16 *data,
+    const Si32 samples, const Si32 channels) {
+  std::shared_ptr<easy::SoundInstance> sound(
+    new easy::SoundInstance(kSoundDataAdpcm, samples, channels));
+  Ui8 *block = sound->GetAdpcmData();
+  for (Si32 block_begin = 0; block_begin < samples;
+      block_begin += kAdpcmBlockSamples) {
+    const Si32 count = std::min(kAdpcmBlockSamples, samples - block_begin);
+    for (Si32 channel = 0; channel < channels; ++channel) {
+      const Si16 *in = data + block_begin * channels + channel;
+      // The block starts from its first sample, so it needs no history.
+      Si32 predictor = in[0];
+      Si32 index = 0;
+      if (count > 1) {
+        // Picks a step that fits the first difference to cut the lag.
+        Si32 diff = std::abs(static_cast<Si32>(in[channels]) - predictor);
+        while (index < 88 && g_adpcm_step_table[index] < diff) {
+          ++index;
+        }
+      }
+      block[0] = static_cast<Ui8>(predictor & 255);
+      block[1] = static_cast<Ui8>((predictor >> 8) & 255);
+      block[2] = static_cast<Ui8>(index);
+      block[3] = 0;
+      Ui8 *codes = block + 4;
+      std::memset(codes, 0, kAdpcmBlockSamples / 2);
+      for (Si32 i = 0; i < count; ++i) {
+        Ui32 nibble = EncodeAdpcmNibble(in[i * channels], &predictor, &index);
+        codes[i >> 1] |= static_cast<Ui8>(nibble << ((i & 1) * 4));
+      }
+      block += kAdpcmChannelBlockBytes;
+    }
+  }
+  return sound;
 }
 
 std::shared_ptr<easy::SoundInstance> LoadWav(const Ui8 *data,
@@ -134,47 +393,34 @@ std::shared_ptr<easy::SoundInstance> LoadWav(const Ui8 *data,
 
   std::shared_ptr<easy::SoundInstance> sound;
   Ui32 sample_count = wav->subchunk_2_size / wav->block_align;
-  sound.reset(new easy::SoundInstance(sample_count));
+  // Mono stays mono, the mixer sends it to both speakers.
+  const Si32 channels = (wav->channels == 1 ? 1 : 2);
+  sound.reset(new easy::SoundInstance(kSoundDataWav, sample_count, channels));
   const Ui8 *in_data = data + 44;
   Si16 *out_data = sound->GetWavData();
   Ui16 block_align = wav->block_align;
   if (wav->bits_per_sample == 8) {
-    if (wav->channels == 1) {
-      for (Ui32 idx = 0; idx < sample_count; ++idx) {
-        Si16 value = static_cast<Si16>(*static_cast<const Si8*>(
-              static_cast<const void*>(in_data))) * 256;
-        out_data[idx * 2] = value;
-        out_data[idx * 2 + 1] = value;
-        in_data += block_align;
-      }
-    } else {
-      for (Ui32 idx = 0; idx < sample_count; ++idx) {
-        Si16 value = static_cast<Si16>(*static_cast<const Si8*>(
-              static_cast<const void*>(in_data))) * 256;
-        out_data[idx * 2] = value;
-        value = static_cast<Si16>(*static_cast<const Si8*>(
-              static_cast<const void*>(in_data + sizeof(Ui16)))) * 256;
-        out_data[idx * 2 + 1] = value;
-        in_data += block_align;
+    // 8-bit WAV samples are unsigned.
+    if (block_align == channels) {
+      ConvertU8ToS16(in_data, static_cast<Si32>(sample_count) * channels,
+        out_data);
+      return sound;
+    }
+    for (Ui32 idx = 0; idx < sample_count; ++idx) {
+      for (Si32 channel = 0; channel < channels; ++channel) {
+        out_data[idx * channels + channel] = static_cast<Si16>(
+          (static_cast<Si32>(in_data[channel]) - 128) * 256);
       }
+      in_data += block_align;
     }
   } else if (wav->bits_per_sample == 16) {
-    if (wav->channels == 1) {
-      for (Ui32 idx = 0; idx < sample_count; ++idx) {
-        Si16 value = *static_cast<const Si16*>(
-            static_cast<const void*>(in_data));
-        out_data[idx * 2] = value;
-        out_data[idx * 2 + 1] = value;
-        in_data += block_align;
-      }
+    if (block_align == channels * sizeof(Si16)) {
+      std::memcpy(out_data, in_data,
+        static_cast<size_t>(sample_count) * block_align);
     } else {
       for (Ui32 idx = 0; idx < sample_count; ++idx) {
-        Si16 value = *static_cast<const Ui16*>(
-            static_cast<const void*>(in_data));
-        out_data[idx * 2] = value;
-        value = *static_cast<const Si16*>(
-            static_cast<const void*>(in_data + sizeof(Si16)));
-        out_data[idx * 2 + 1] = value;
+        std::memcpy(out_data + idx * channels, in_data,
+          channels * sizeof(Si16));
         in_data += block_align;
       }
     }
@@ -185,6 +431,30 @@ std::shared_ptr<easy::SoundInstance> LoadWav(const Ui8 *data,
   return sound;
 }
 
+std::vector<Ui8> SaveWav(const Si16 *data, const Si64 frames) {
+  const Ui32 data_size = static_cast<Ui32>(frames * 2 * sizeof(Si16));
+  std::vector<Ui8> file(sizeof(WaveHeader) + data_size);
+  WaveHeader *wav = static_cast<WaveHeader*>(
+      static_cast<void*>(file.data()));
+  wav->chunk_id.raw = ToBe(static_cast<Ui32>(0x52494646));
+  wav->chunk_size = static_cast<Ui32>(file.size() - 8);
+  wav->format.raw = ToBe(static_cast<Ui32>(0x57415645));
+  wav->subchunk_1_id.raw = ToBe(static_cast<Ui32>(0x666d7420));
+  wav->subchunk_1_size = 16;
+  wav->audio_format = 1;
+  wav->channels = 2;
+  wav->sample_rate = 44100;
+  wav->block_align = 2 * sizeof(Si16);
+  wav->byte_rate = wav->sample_rate * wav->block_align;
+  wav->bits_per_sample = 16;
+  wav->subchunk_2_id.raw = ToBe(static_cast<Ui32>(0x64617461));
+  wav->subchunk_2_size = data_size;
+  if (data_size) {
+    std::memcpy(file.data() + sizeof(WaveHeader), data, data_size);
+  }
+  return file;
+}
+
 bool SoundInstance::IsPlaying() {
   return (playing_count_.load() != 0);
 }
@@ -24,6 +24,7 @@
 #define ENGINE_EASY_SOUND_INSTANCE_H_
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -35,22 +36,99 @@ namespace easy {
 
 enum SoundDataFormat {
   kSoundDataWav,
-  kSoundDataVorbis
+  kSoundDataVorbis,
+  kSoundDataAdpcm,
+  kSoundDataStream,
+  kSoundDataCallback
+};
+
+// The mixer bus a sound plays through. Every bus has its own gain and
+// effect chain, then they all mix into the master bus.
+enum SoundBus {
+  kSoundBusSfx = 0,
+  kSoundBusMusic,
+  kSoundBusUi,
+  kSoundBusMaster,
+  kSoundBusCount
+};
+
+class SoundStream;
+
+// Parameter slots the game writes and a sound callback reads on the mixer
+// thread. Each slot is a lock-free atomic, so neither side ever waits.
+class SoundParameters {
+ public:
+  static const Si32 kCount = 16;
+  SoundParameters();
+  void Set(Si32 index, float value);
+  float Get(Si32 index) const;
+ private:
+  std::atomic<float> values_[kCount];
+};
+
+// Fills frames frames of interleaved samples for the sound position, called
+// on the mixer thread. Returns the number of frames filled, filling less
+// than frames ends the sound after those frames. It runs even while the
+// voice is inaudible, so the sound still ends. Must not block, allocate or
+// take locks.
+typedef std::function<Si32(const SoundParameters &parameters,
+  Si32 position, Si32 frames, Si16 *out_samples)> SoundCallback;
+
+// IMA-ADPCM data is split into blocks of kAdpcmBlockSamples samples per
+// channel, so playback can start at any block. Each block holds a 4-byte
+// header and the packed 4-bit codes for every channel in turn.
+static const Si32 kAdpcmBlockSamples = 256;
+static const Si32 kAdpcmChannelBlockBytes = 4 + kAdpcmBlockSamples / 2;
+
+// Where a sequential ADPCM decode stopped, so the next call continues from
+// there instead of decoding its block again from the block header.
+struct AdpcmCursor {
+  Si32 position = -1;
+  Si32 predictor[2] = {0, 0};
+  Si32 index[2] = {0, 0};
 };
 
 class SoundInstance {
   double duration_;
   SoundDataFormat format_;
+  Si32 channels_;
+  Si32 duration_samples_;
+  std::atomic<Si32> bus_;
   ByteArray data_;
+  std::shared_ptr<SoundStream> stream_;
+  SoundCallback callback_;
+  SoundParameters parameters_;
   std::atomic<Si32> playing_count_;
  public:
   explicit SoundInstance(Ui32 wav_samples);
-  explicit SoundInstance(std::vector<Ui8> vorbis_file);
+  // Allocates room for the samples with 1 or 2 channels, kSoundDataWav
+  // holds unpacked interleaved 16-bit samples.
+  SoundInstance(SoundDataFormat format, Ui32 samples, Si32 channels);
+  // The metadata is parsed once at load and served from here, so queries
+  // never need a decoder.
+  SoundInstance(std::vector<Ui8> vorbis_file, Si32 channels,
+    Si32 duration_samples);
+  explicit SoundInstance(std::shared_ptr<SoundStream> stream);
+  SoundInstance(SoundCallback callback, Si32 channels);
   Si16* GetWavData();
   Ui8* GetVorbisData() const;
   Si32 GetVorbisSize() const;
+  Ui8* GetAdpcmData();
+  SoundStream* GetStream() const;
+  SoundParameters* GetParameters();
+  Si32 Generate(Si32 offset, Si32 size, Si16 *out_buffer);
   SoundDataFormat GetFormat() const;
-  Si32 GetDurationSamples();
+  Si32 GetChannels() const;
+  SoundBus GetBus() const;
+  void SetBus(SoundBus bus);
+  Si32 GetDurationSamples() const;
+  double GetDuration() const;
+  // Decodes size frames of ADPCM data starting at offset into
+  // out_buffer, GetChannels() interleaved samples per frame. A cursor
+  // left by the previous call lets a decode that continues from it skip
+  // the samples before offset.
+  Si32 DecodeAdpcm(Si32 offset, Si32 size, Si16 *out_buffer,
+    AdpcmCursor *cursor = nullptr) const;
   bool IsPlaying();
   void IncPlaying();
   void DecPlaying();
@@ -58,6 +136,12 @@ class SoundInstance {
 
 std::shared_ptr<easy::SoundInstance> LoadWav(const Ui8 *data,
     const Si64 size);
+// Compresses 16-bit samples with 1 or 2 interleaved channels to IMA-ADPCM,
+// a quarter of the size.
+std::shared_ptr<easy::SoundInstance> EncodeAdpcm(const Si16 *data,
+    const Si32 samples, const Si32 channels);
+// Returns a 44100 Hz 16-bit stereo WAV file with the interleaved samples.
+std::vector<Ui8> SaveWav(const Si16 *data, const Si64 frames);
 
 }  // namespace easy
 }  // namespace arctic
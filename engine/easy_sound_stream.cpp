@@ -0,0 +1,193 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/easy_sound_stream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "engine/arctic_platform.h"
+#include "engine/arctic_sound_convert.h"
+
+#define STB_VORBIS_HEADER_ONLY
+#define STB_VORBIS_NO_PUSHDATA_API
+#define STB_VORBIS_MAX_CHANNELS    2
+#include "engine/stb_vorbis.inc"
+
+namespace arctic {
+namespace easy {
+
+// About 0.75 seconds, 128 KiB for a stereo stream.
+static const Si32 kSoundStreamRingFrames = 32768;
+static const Si32 kSoundStreamChunkFrames = 4096;
+
+SoundStream::SoundStream(const char *file_name)
+    : file_name_(file_name) {
+  int error = 0;
+  vorbis_codec_ = stb_vorbis_open_filename(file_name, &error, nullptr);
+  Check(!!vorbis_codec_, "Error in SoundStream, can't open ogg file: ",
+    file_name);
+  stb_vorbis_info info = stb_vorbis_get_info(vorbis_codec_);
+  channels_ = (info.channels == 1 ? 1 : 2);
+  duration_samples_ = static_cast<Si32>(
+    stb_vorbis_stream_length_in_samples(vorbis_codec_));
+  stb_vorbis_seek_start(vorbis_codec_);
+  ring_.resize(static_cast<size_t>(kSoundStreamRingFrames) * channels_);
+  thread_ = std::thread(&SoundStream::ThreadFunction, this);
+}
+
+SoundStream::~SoundStream() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    do_quit_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+  stb_vorbis_close(vorbis_codec_);
+}
+
+Si32 SoundStream::GetChannels() const {
+  return channels_;
+}
+
+Si32 SoundStream::GetDurationSamples() const {
+  return duration_samples_;
+}
+
+void SoundStream::ThreadFunction() {
+  std::vector<Si16> chunk(
+    static_cast<size_t>(kSoundStreamChunkFrames) * channels_);
+  std::vector<float> planar(static_cast<size_t>(kSoundStreamChunkFrames) * 2);
+  float *buffers[2] = {planar.data(), planar.data() + kSoundStreamChunkFrames};
+  Ui32 dither_state = 1;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] {
+      return do_quit_ || seek_request_ >= 0 ||
+        (!is_end_of_file_ &&
+         ring_count_ + kSoundStreamChunkFrames <= kSoundStreamRingFrames);
+    });
+    if (do_quit_) {
+      return;
+    }
+    Si32 seek_to = seek_request_;
+    seek_request_ = -1;
+    if (seek_to >= 0) {
+      is_end_of_file_ = false;
+    }
+    Si32 position = (seek_to >= 0 ? seek_to : decode_position_);
+    lock.unlock();
+
+    // The file is read and decoded without holding the lock.
+    if (seek_to == 0) {
+      stb_vorbis_seek_start(vorbis_codec_);
+    } else if (seek_to > 0) {
+      stb_vorbis_seek(vorbis_codec_, static_cast<unsigned int>(seek_to));
+    }
+    Si32 frames = stb_vorbis_get_samples_float(vorbis_codec_, channels_,
+      buffers, kSoundStreamChunkFrames);
+    if (frames > 0) {
+      ConvertFloatToS16(buffers, channels_, frames, chunk.data(),
+        &dither_state);
+    }
+
+    lock.lock();
+    if (seek_request_ >= 0) {
+      // The reader jumped again while this chunk was decoded.
+      continue;
+    }
+    if (frames <= 0) {
+      is_end_of_file_ = true;
+      decode_position_ = position;
+      lock.unlock();
+      condition_.notify_all();
+      lock.lock();
+      continue;
+    }
+    Si32 write_index = (ring_read_index_ + ring_count_) %
+      kSoundStreamRingFrames;
+    // At most two copies, before and after the ring wraps around.
+    Si32 first = std::min(frames, kSoundStreamRingFrames - write_index);
+    std::memcpy(&ring_[static_cast<size_t>(write_index) * channels_],
+      chunk.data(), static_cast<size_t>(first) * channels_ * sizeof(Si16));
+    std::memcpy(ring_.data(), &chunk[static_cast<size_t>(first) * channels_],
+      static_cast<size_t>(frames - first) * channels_ * sizeof(Si16));
+    ring_count_ += frames;
+    decode_position_ = position + frames;
+    lock.unlock();
+    condition_.notify_all();
+    lock.lock();
+  }
+}
+
+void SoundStream::WaitForFrames(Si32 offset, Si32 size) {
+  size = std::min(size, kSoundStreamRingFrames - kSoundStreamChunkFrames);
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (offset != read_position_) {
+    ring_count_ = 0;
+    ring_read_index_ = 0;
+    seek_request_ = offset;
+    read_position_ = offset;
+    condition_.notify_all();
+  }
+  condition_.wait(lock, [this, size] {
+    return seek_request_ < 0 && (ring_count_ >= size || is_end_of_file_);
+  });
+}
+
+Si32 SoundStream::Read(Si32 offset, Si32 size, Si16 *out_buffer) {
+  if (size <= 0) {
+    return 0;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (offset != read_position_) {
+    // Restarted or skipped ahead, throw away what was decoded.
+    ring_count_ = 0;
+    ring_read_index_ = 0;
+    seek_request_ = offset;
+    read_position_ = offset;
+  }
+  const Si32 available = std::min(size, ring_count_);
+  Si32 first = std::min(available, kSoundStreamRingFrames - ring_read_index_);
+  std::memcpy(out_buffer,
+    &ring_[static_cast<size_t>(ring_read_index_) * channels_],
+    static_cast<size_t>(first) * channels_ * sizeof(Si16));
+  std::memcpy(out_buffer + static_cast<size_t>(first) * channels_,
+    ring_.data(),
+    static_cast<size_t>(available - first) * channels_ * sizeof(Si16));
+  ring_read_index_ = (ring_read_index_ + available) % kSoundStreamRingFrames;
+  ring_count_ -= available;
+  // Only the decoded frames count, so the music resumes where it stopped
+  // once the decoder catches up and no part of it is skipped.
+  read_position_ = offset + available;
+  lock.unlock();
+  condition_.notify_all();
+  return available;
+}
+
+bool SoundStream::IsFinished() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return is_end_of_file_ && ring_count_ == 0 && seek_request_ < 0;
+}
+
+}  // namespace easy
+}  // namespace arctic
@@ -0,0 +1,92 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_EASY_SOUND_STREAM_H_
+#define ENGINE_EASY_SOUND_STREAM_H_
+
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "engine/arctic_types.h"
+
+struct stb_vorbis;
+
+namespace arctic {
+namespace easy {
+
+// Plays an OGG file from disk without loading it into memory.
+// A background thread reads and decodes the file ahead of the playback
+// position into a ring buffer of kSoundStreamRingFrames frames, so the
+// memory used does not depend on the length of the file.
+// A stream has a single play position, so it plays as one voice at a
+// time. Starting a second voice of it is an error.
+class SoundStream {
+ private:
+  std::string file_name_;
+  stb_vorbis *vorbis_codec_ = nullptr;
+  Si32 channels_ = 2;
+  Si32 duration_samples_ = 0;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool do_quit_ = false;
+  std::vector<Si16> ring_;
+  // Decoded frames that follow read_position_.
+  Si32 ring_count_ = 0;
+  Si32 ring_read_index_ = 0;
+  // The position the decoder continues from.
+  Si32 decode_position_ = 0;
+  // The sound position expected in the next Read call.
+  Si32 read_position_ = 0;
+  Si32 seek_request_ = -1;
+  bool is_end_of_file_ = false;
+
+  void ThreadFunction();
+
+ public:
+  explicit SoundStream(const char *file_name);
+  ~SoundStream();
+  SoundStream(const SoundStream&) = delete;
+  SoundStream &operator=(const SoundStream&) = delete;
+
+  Si32 GetChannels() const;
+  Si32 GetDurationSamples() const;
+  // Writes up to size frames starting at offset and returns how many.
+  // It returns fewer while the decoder is behind, the next read continues
+  // right after them. Reading any other offset than the one right after
+  // the previous read makes the decoder seek there.
+  Si32 Read(Si32 offset, Si32 size, Si16 *out_buffer);
+  // True once the whole file is decoded and read.
+  bool IsFinished();
+  // Blocks until size frames from offset are decoded or the file ends, so
+  // the next Read returns no silence. For offline mixing.
+  void WaitForFrames(Si32 offset, Si32 size);
+};
+
+}  // namespace easy
+}  // namespace arctic
+
+#endif  // ENGINE_EASY_SOUND_STREAM_H_
@@ -28,372 +28,401 @@
 #include <utility>
 #include <vector>
 
+#include "engine/arctic_parallel.h"
+#include "engine/arctic_pixel_convert.h"
+#include "engine/arctic_png.h"
+#include "engine/arctic_simd.h"
 #include "engine/easy.h"
+#include "engine/easy_rasterizer.h"
 #include "engine/rgba.h"
 
 namespace arctic {
 namespace easy {
 
-// Just like MasterBoy wrote in HUGi 17, but without subpixel
-// see http://www.hugi.scene.org/online/coding/hugi%2017%20-%20cotriang.htm
-// or http://www.hugi.scene.org/online/hugi17/
-template<DrawBlendingMode kBlendingMode>
-inline void DrawTrianglePart(Rgba *dst, Si32 stride,
-  float *x1, float *x2, Vec2F *tex_a, Vec2F *tex_b,
-  float dxdy1, float dxdy2,
-  Vec2F dtdy1, Vec2F dtdy2,
-  Si32 width, Si32 height,
-  Si32 y1, Si32 y2, Sprite texture) {
-  Si32 y = y1;
-  if (y1 < 0) {
-    Si32 yc = std::min(0, y2);
-    float d = static_cast<float>(yc - y);
-    y = yc;
-    *x1 += dxdy1 * d;
-    *x2 += dxdy2 * d;
-    *tex_a += dtdy1 * d;
-    *tex_b += dtdy2 * d;
-  }
-  Si32 ye = std::min(height, y2);
-  dst += y * stride;
-  Si32 tex_stride = texture.StridePixels();
-  Rgba *tex_data = texture.RgbaData();
-  for (; y < ye; y++) {
-    Si32 x1i = static_cast<Si32>(*x1);
-    Si32 x2i = static_cast<Si32>(*x2);
-
-    Si32 x12i = x2i - x1i;
-    Si32 x1c = std::max(0, x1i);
-    Si32 x2c = std::min(width, x2i);
-
-    if (x2c <= x1c) {
-      if (x2c == x1c && x2c < width) {
-        Vec2F tex_ab = *tex_b - *tex_a;
-        Vec2F tex_1c = (x12i == 0 ? *tex_a :
-          *tex_a + tex_ab * static_cast<float>(x1c - x1i) /
-          static_cast<float>(x12i));
-        Si32 offset = static_cast<Si32>(tex_1c.x) +
-          static_cast<Si32>(tex_1c.y) * tex_stride;
-        Rgba color = tex_data[offset];
-        if (color.a == 255) {
-          Rgba *p = dst + x1c;
-          p->rgba = color.rgba;
-        } else if (color.a) {
-          Rgba *p = dst + x1c;
-          Ui32 m = 255 - color.a;
-          Ui32 rb = (p->rgba & 0x00ff00fful) * m;
-          Ui32 g = ((p->rgba & 0x0000ff00ul) >> 8) * m;
-          Ui32 m2 = color.a;
-          Ui32 rb2 = (color.rgba & 0x00ff00fful) * m2;
-          Ui32 g2 = ((color.rgba & 0x0000ff00ul) >> 8) * m2;
-          p->rgba = (((rb + rb2) >> 8) & 0x00ff00fful) |
-            ((g + g2) & 0x0000ff00ul);
-        }
+// Large clears are split between threads, each gets at least this many
+// pixels.
+static const Si32 kClearPixelsPerThreadMin = 1 << 19;
+
+// Picks the deepest mip level that still has at least one texel per
+// destination pixel when the image is shrunk by the given factor.
+inline Si32 PickMipmapLevel(float shrink, Si32 level_count) {
+  Si32 level = 0;
+  while (level < level_count && shrink >= 2.f) {
+    shrink *= 0.5f;
+    ++level;
+  }
+  return level;
+}
+
+// Everything a blit needs once the destination is clipped. The to pointer
+// is at the destination corner and from is at the source corner, both may
+// point outside of their images, only the clipped range is accessed.
+struct BlitParams {
+  Rgba *to;
+  Si32 to_stride;
+  const Rgba *from;
+  Si32 from_stride;
+  Si32 from_width;
+  Si32 from_height;
+  Si32 to_width;
+  Si32 to_height;
+  Si32 x_begin;
+  Si32 x_end;
+  Si32 y_begin;
+  Si32 y_end;
+  bool flip_y;
+  // Opaque spans of the source sprite and the source corner within it,
+  // for unscaled blits only.
+  const SpanSi32 *opaque;
+  Si32 from_x;
+  Si32 from_y;
+};
+
+// Source line for a destination line.
+inline Si32 BlitSourceLine(const BlitParams &p, Si32 to_y_disp) {
+  const Si32 y = p.flip_y ? p.to_height - 1 - to_y_disp : to_y_disp;
+  return static_cast<Si32>(static_cast<Si64>(p.from_height) * y /
+    p.to_height);
+}
+
+template<DrawBlendingMode kBlendingMode, bool kFlipX>
+void BlitUnscaled(const BlitParams &p) {
+  for (Si32 to_y_disp = p.y_begin; to_y_disp < p.y_end; ++to_y_disp) {
+    const Si32 from_y_disp = BlitSourceLine(p, to_y_disp);
+    Si32 x_begin = p.x_begin;
+    Si32 x_end = p.x_end;
+    if (p.opaque) {
+      // Skips the transparent ends, the span is in sprite coordinates.
+      const SpanSi32 &span = p.opaque[p.from_y + from_y_disp];
+      const Si32 span_begin = kFlipX ?
+        p.from_width + p.from_x - span.end : span.begin - p.from_x;
+      const Si32 span_end = kFlipX ?
+        p.from_width + p.from_x - span.begin : span.end - p.from_x;
+      x_begin = std::max(x_begin, span_begin);
+      x_end = std::min(x_end, span_end);
+    }
+    const Rgba *from_line = p.from + from_y_disp * p.from_stride;
+    Rgba *to_line = p.to + to_y_disp * p.to_stride;
+    if (kFlipX) {
+      const Rgba *from_rgba = from_line + p.from_width - 1 - x_begin;
+      for (Si32 x = x_begin; x < x_end; ++x) {
+        DrawPixel<kBlendingMode>(*from_rgba, to_line + x);
+        --from_rgba;
+      }
+    } else if (kBlendingMode == kCopyRgba) {
+      if (x_end > x_begin) {
+        memcpy(static_cast<void*>(to_line + x_begin), from_line + x_begin,
+          static_cast<size_t>(x_end - x_begin) * sizeof(Rgba));
       }
     } else {
-      Vec2F tex_ab = *tex_b - *tex_a;
-      Vec2F tex_1c = (x1c == x1i ? *tex_a :
-        *tex_a + tex_ab * static_cast<float>(x1c - x1i) /
-        static_cast<float>(x12i));
-      Vec2F tex_2c = (x2c == x2i ? *tex_b :
-        *tex_a + tex_ab * static_cast<float>(x2c - x1i) /
-        static_cast<float>(x12i));
-      Vec2F tex_1c2c = tex_2c - tex_1c;
-
-      Vec2Si32 tex_16(tex_1c * 65536.f);
-      Vec2Si32 tex_12_16(tex_1c2c * 65536.f);
-      Vec2Si32 tex_12_16_step = tex_12_16 / (x2c - x1c);
-
-      Rgba *p = dst + x1c;
-      for (Si32 x = x1c; x < x2c; ++x) {
-        Si32 offset = (tex_16.x >> 16) +
-          (tex_16.y >> 16) * tex_stride;
-        if (kBlendingMode == kCopyRgba) {
-          p->rgba = tex_data[offset].rgba;
-        } else if (kBlendingMode == kAlphaBlend) {
-          Rgba color = tex_data[offset];
-          if (color.a == 255) {
-            p->rgba = color.rgba;
-          } else if (color.a) {
-            Ui32 m = 255 - color.a;
-            Ui32 rb = (p->rgba & 0x00ff00fful) * m;
-            Ui32 g = ((p->rgba & 0x0000ff00ul) >> 8) * m;
-            Ui32 m2 = color.a;
-            Ui32 rb2 = (color.rgba & 0x00ff00fful) * m2;
-            Ui32 g2 = ((color.rgba & 0x0000ff00ul) >> 8) * m2;
-            p->rgba = (((rb + rb2) >> 8) & 0x00ff00fful) |
-              ((g + g2) & 0x0000ff00ul);
-          }
-        }
-        p++;
-        tex_16 += tex_12_16_step;
+      for (Si32 x = x_begin; x < x_end; ++x) {
+        DrawPixel<kBlendingMode>(from_line[x], to_line + x);
       }
     }
-    *x1 += dxdy1;
-    *x2 += dxdy2;
-    *tex_a += dtdy1;
-    *tex_b += dtdy2;
-    dst += stride;
   }
 }
 
-template<DrawBlendingMode kBlendingMode>
-void DrawTriangle(Vec2Si32 a, Vec2Si32 b, Vec2Si32 c,
-  Vec2F tex_a, Vec2F tex_b, Vec2F tex_c,
-  Sprite texture, Sprite to_sprite) {
-  if (a.y > b.y) {
-    std::swap(a, b);
-    std::swap(tex_a, tex_b);
-  }
-  if (a.y > c.y) {
-    std::swap(a, c);
-    std::swap(tex_a, tex_c);
-  }
-  if (b.y > c.y) {
-    std::swap(b, c);
-    std::swap(tex_b, tex_c);
-  }
-  if (a.y == c.y) {
-    return;
+// Writes each of count source pixels kScale times in a row.
+template<Si32 kScale>
+inline void ReplicatePixels(const Rgba *from, Si32 count, Rgba *to) {
+  Si32 i = 0;
+#if defined(ARCTIC_SIMD_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    const __m128i p = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(from + i));
+    __m128i *out = reinterpret_cast<__m128i*>(to + i * kScale);
+    if (kScale == 2) {
+      _mm_storeu_si128(out, _mm_unpacklo_epi32(p, p));
+      _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(p, p));
+    } else if (kScale == 3) {
+      _mm_storeu_si128(out, _mm_shuffle_epi32(p, _MM_SHUFFLE(1, 0, 0, 0)));
+      _mm_storeu_si128(out + 1,
+        _mm_shuffle_epi32(p, _MM_SHUFFLE(2, 2, 1, 1)));
+      _mm_storeu_si128(out + 2,
+        _mm_shuffle_epi32(p, _MM_SHUFFLE(3, 3, 3, 2)));
+    } else if (kScale == 4) {
+      _mm_storeu_si128(out, _mm_shuffle_epi32(p, 0x00));
+      _mm_storeu_si128(out + 1, _mm_shuffle_epi32(p, 0x55));
+      _mm_storeu_si128(out + 2, _mm_shuffle_epi32(p, 0xaa));
+      _mm_storeu_si128(out + 3, _mm_shuffle_epi32(p, 0xff));
+    } else {
+      break;
+    }
   }
-  Si32 stride = to_sprite.StridePixels();
-  Rgba *dst = to_sprite.RgbaData();
-  Si32 width = to_sprite.Width();
-  Si32 height = to_sprite.Height();
-
-  float dxdy_ac = static_cast<float>(c.x - a.x) /
-    static_cast<float>(c.y - a.y);
-  float dxdy_bc = static_cast<float>(c.x - b.x) /
-    static_cast<float>(c.y - b.y);
-  float dxdy_ab = static_cast<float>(b.x - a.x) /
-    static_cast<float>(b.y - a.y);
-
-  Vec2F dcdy_ac = (tex_c - tex_a) / static_cast<float>(c.y - a.y);
-  Vec2F dcdy_bc = (tex_c - tex_b) / static_cast<float>(c.y - b.y);
-  Vec2F dcdy_ab = (tex_b - tex_a) / static_cast<float>(b.y - a.y);
-
-  float x1;
-  float x2;
-  float dxdy1;
-  float dxdy2;
-  Vec2F tex1;
-  Vec2F tex2;
-  Vec2F dtdy1;
-  Vec2F dtdy2;
-
-  bool is_b_at_the_right_side = dxdy_ac < dxdy_ab;
-  if (is_b_at_the_right_side) {
-    dxdy1 = dxdy_ac;
-    dtdy1 = dcdy_ac;
-    if (a.y == b.y) {
-      dxdy2 = dxdy_bc;
-      x1 = static_cast<float>(a.x);
-      x2 = static_cast<float>(b.x);
-      dtdy2 = dcdy_bc;
-      tex1 = tex_a;
-      tex2 = tex_b;
-      DrawTrianglePart<kBlendingMode>(dst, stride, &x1, &x2, &tex1, &tex2,
-        dxdy1, dxdy2,
-        dtdy1, dtdy2, width, height, a.y, c.y, texture);
-      return;
+#elif defined(ARCTIC_SIMD_NEON)
+  for (; i + 4 <= count; i += 4) {
+    const uint32x4_t p = vld1q_u32(reinterpret_cast<const uint32_t*>(
+      from + i));
+    uint32_t *out = reinterpret_cast<uint32_t*>(to + i * kScale);
+    if (kScale == 2) {
+      const uint32x4x2_t zipped = vzipq_u32(p, p);
+      vst1q_u32(out, zipped.val[0]);
+      vst1q_u32(out + 4, zipped.val[1]);
+    } else if (kScale == 4) {
+      vst1q_u32(out, vdupq_n_u32(vgetq_lane_u32(p, 0)));
+      vst1q_u32(out + 4, vdupq_n_u32(vgetq_lane_u32(p, 1)));
+      vst1q_u32(out + 8, vdupq_n_u32(vgetq_lane_u32(p, 2)));
+      vst1q_u32(out + 12, vdupq_n_u32(vgetq_lane_u32(p, 3)));
+    } else {
+      break;
     }
-    if (a.y < b.y) {
-      dxdy2 = dxdy_ab;
-      x1 = static_cast<float>(a.x);
-      x2 = static_cast<float>(a.x);
-      dtdy2 = dcdy_ab;
-      tex1 = tex_a;
-      tex2 = tex_a;
-      DrawTrianglePart<kBlendingMode>(dst, stride, &x1, &x2, &tex1, &tex2,
-        dxdy1, dxdy2,
-        dtdy1, dtdy2, width, height, a.y, b.y, texture);
+  }
+#endif
+  for (; i < count; ++i) {
+    for (Si32 k = 0; k < kScale; ++k) {
+      to[i * kScale + k] = from[i];
     }
-    if (b.y < c.y) {
-      dxdy2 = dxdy_bc;
-      x2 = static_cast<float>(b.x);
-      dtdy2 = dcdy_bc;
-      tex2 = tex_b;
-      DrawTrianglePart<kBlendingMode>(dst, stride, &x1, &x2, &tex1, &tex2,
-        dxdy1, dxdy2,
-        dtdy1, dtdy2, width, height, b.y, c.y, texture);
+  }
+}
+
+template<DrawBlendingMode kBlendingMode, Si32 kScale, bool kFlipX>
+void BlitIntegerScaled(const BlitParams &p) {
+  // Each source pixel covers kScale destination pixels, phase counts them.
+  const Si32 x_first = kFlipX ? p.to_width - 1 - p.x_begin : p.x_begin;
+  const size_t line_bytes =
+    static_cast<size_t>(p.x_end - p.x_begin) * sizeof(Rgba);
+  Si32 previous_from_y = -1;
+  for (Si32 to_y_disp = p.y_begin; to_y_disp < p.y_end; ++to_y_disp) {
+    const Si32 y = p.flip_y ? p.to_height - 1 - to_y_disp : to_y_disp;
+    const Si32 from_y_disp = y / kScale;
+    Rgba *to_line = p.to + to_y_disp * p.to_stride;
+    if (kBlendingMode == kCopyRgba) {
+      // Copies repeat the line above while the source line is the same.
+      if (from_y_disp == previous_from_y) {
+        memcpy(static_cast<void*>(to_line + p.x_begin),
+          to_line - p.to_stride + p.x_begin, line_bytes);
+        continue;
+      }
+      previous_from_y = from_y_disp;
     }
-  } else {
-    // b is at the left side
-    dxdy2 = dxdy_ac;
-    dtdy2 = dcdy_ac;
-    if (a.y == b.y) {
-      dxdy1 = dxdy_bc;
-      x1 = static_cast<float>(b.x);
-      x2 = static_cast<float>(a.x);
-      dtdy1 = dcdy_bc;
-      tex1 = tex_b;
-      tex2 = tex_a;
-      DrawTrianglePart<kBlendingMode>(dst, stride, &x1, &x2, &tex1, &tex2,
-        dxdy1, dxdy2,
-        dtdy1, dtdy2, width, height, a.y, c.y, texture);
-      return;
+    const Rgba *from_line = p.from + from_y_disp * p.from_stride;
+    if (kBlendingMode == kCopyRgba && !kFlipX) {
+      Si32 x = p.x_begin;
+      for (; x < p.x_end && x % kScale; ++x) {
+        to_line[x] = from_line[x / kScale];
+      }
+      const Si32 whole = (p.x_end - x) / kScale;
+      ReplicatePixels<kScale>(from_line + x / kScale, whole, to_line + x);
+      x += whole * kScale;
+      for (; x < p.x_end; ++x) {
+        to_line[x] = from_line[x / kScale];
+      }
+      continue;
     }
-    if (a.y < b.y) {
-      dxdy1 = dxdy_ab;
-      x1 = static_cast<float>(a.x);
-      x2 = static_cast<float>(a.x);
-      dtdy1 = dcdy_ab;
-      tex1 = tex_a;
-      tex2 = tex_a;
-      DrawTrianglePart<kBlendingMode>(dst, stride, &x1, &x2, &tex1, &tex2,
-        dxdy1, dxdy2,
-        dtdy1, dtdy2, width, height, a.y, b.y, texture);
+    const Rgba *from_rgba = from_line + x_first / kScale;
+    Si32 phase = x_first % kScale;
+    for (Si32 x = p.x_begin; x < p.x_end; ++x) {
+      DrawPixel<kBlendingMode>(*from_rgba, to_line + x);
+      if (kFlipX) {
+        if (--phase < 0) {
+          phase = kScale - 1;
+          --from_rgba;
+        }
+      } else if (++phase == kScale) {
+        phase = 0;
+        ++from_rgba;
+      }
     }
-    if (b.y < c.y) {
-      dxdy1 = dxdy_bc;
-      x1 = static_cast<float>(b.x);
-      dtdy1 = dcdy_bc;
-      tex1 = tex_b;
-      DrawTrianglePart<kBlendingMode>(dst, stride, &x1, &x2, &tex1, &tex2,
-        dxdy1, dxdy2,
-        dtdy1, dtdy2, width, height, b.y, c.y, texture);
+  }
+}
+
+template<DrawBlendingMode kBlendingMode, bool kFlipX>
+void BlitScaled(const BlitParams &p) {
+  // Source columns are looked up once per draw, not stepped per pixel.
+  // The table persists across draws, so small sprites do not allocate.
+  static thread_local std::vector<Si32> scratch_columns;
+  std::vector<Si32> &columns = scratch_columns;
+  const size_t count = static_cast<size_t>(p.x_end - p.x_begin);
+  if (columns.size() < count) {
+    columns.resize(count);
+  }
+  const Si64 from_x_step_16 = 65536ll * p.from_width / p.to_width;
+  for (Si32 x = p.x_begin; x < p.x_end; ++x) {
+    const Si32 x_mirrored = kFlipX ? p.to_width - 1 - x : x;
+    columns[x - p.x_begin] =
+      static_cast<Si32>((x_mirrored * from_x_step_16) >> 16);
+  }
+  const Si64 from_y_step_16 = 65536ll * p.from_height / p.to_height;
+  const size_t line_bytes = count * sizeof(Rgba);
+  const Si32 *column = columns.data() - p.x_begin;
+  Si32 previous_from_y = -1;
+  for (Si32 to_y_disp = p.y_begin; to_y_disp < p.y_end; ++to_y_disp) {
+    const Si32 y = p.flip_y ? p.to_height - 1 - to_y_disp : to_y_disp;
+    const Si32 from_y_disp = static_cast<Si32>((y * from_y_step_16) >> 16);
+    Rgba *to_line = p.to + to_y_disp * p.to_stride;
+    if (kBlendingMode == kCopyRgba) {
+      if (from_y_disp == previous_from_y) {
+        memcpy(static_cast<void*>(to_line + p.x_begin),
+          to_line - p.to_stride + p.x_begin, line_bytes);
+        continue;
+      }
+      previous_from_y = from_y_disp;
     }
+    const Rgba *from_line = p.from + from_y_disp * p.from_stride;
+    for (Si32 x = p.x_begin; x < p.x_end; ++x) {
+      DrawPixel<kBlendingMode>(from_line[column[x]], to_line + x);
+    }
+  }
+}
+
+// Mixes two colors channel by channel, weight is that of b in 0..256.
+inline Ui32 LerpRgba(Ui32 a, Ui32 b, Ui32 weight) {
+  const Ui32 rb = ((a & 0x00ff00ffu) * (256 - weight) +
+    (b & 0x00ff00ffu) * weight) >> 8;
+  const Ui32 ga = ((a >> 8) & 0x00ff00ffu) * (256 - weight) +
+    ((b >> 8) & 0x00ff00ffu) * weight;
+  return (rb & 0x00ff00ffu) | (ga & 0xff00ff00u);
+}
+
+// A source pixel pair and the weight of the second one, 0..256.
+struct BilinearTap {
+  Si32 index;
+  Si32 next;
+  Ui32 weight;
+};
+
+// Maps the center of a destination pixel to the source, clamped to the
+// centers of the edge pixels.
+inline BilinearTap FindBilinearTap(Si32 to, Si32 to_size, Si32 from_size) {
+  Si64 position_16 = (static_cast<Si64>(2 * to + 1) * from_size * 65536) /
+    (2 * static_cast<Si64>(to_size)) - 32768;
+  position_16 = std::min(std::max(position_16, static_cast<Si64>(0)),
+    static_cast<Si64>(from_size - 1) * 65536);
+  BilinearTap tap;
+  tap.index = static_cast<Si32>(position_16 >> 16);
+  tap.next = std::min(tap.index + 1, from_size - 1);
+  tap.weight = static_cast<Ui32>((position_16 & 0xffff) >> 8);
+  return tap;
+}
+
+template<DrawBlendingMode kBlendingMode, bool kFlipX>
+void BlitBilinear(const BlitParams &p) {
+  static thread_local std::vector<BilinearTap> scratch_columns;
+  std::vector<BilinearTap> &columns = scratch_columns;
+  const size_t count = static_cast<size_t>(p.x_end - p.x_begin);
+  if (columns.size() < count) {
+    columns.resize(count);
+  }
+  for (Si32 x = p.x_begin; x < p.x_end; ++x) {
+    columns[x - p.x_begin] = FindBilinearTap(
+      kFlipX ? p.to_width - 1 - x : x, p.to_width, p.from_width);
+  }
+  const BilinearTap *column = columns.data() - p.x_begin;
+  for (Si32 to_y_disp = p.y_begin; to_y_disp < p.y_end; ++to_y_disp) {
+    const BilinearTap row = FindBilinearTap(
+      p.flip_y ? p.to_height - 1 - to_y_disp : to_y_disp,
+      p.to_height, p.from_height);
+    const Ui32 *line0 = &(p.from + row.index * p.from_stride)->rgba;
+    const Ui32 *line1 = &(p.from + row.next * p.from_stride)->rgba;
+    Rgba *to_line = p.to + to_y_disp * p.to_stride;
+    for (Si32 x = p.x_begin; x < p.x_end; ++x) {
+      const BilinearTap &tap = column[x];
+      const Ui32 top = LerpRgba(line0[tap.index], line0[tap.next],
+        tap.weight);
+      const Ui32 bottom = LerpRgba(line1[tap.index], line1[tap.next],
+        tap.weight);
+      DrawPixel<kBlendingMode>(Rgba(LerpRgba(top, bottom, row.weight)),
+        to_line + x);
+    }
+  }
+}
+
+// Picks the loop for the scale and filter once per draw.
+template<DrawBlendingMode kBlendingMode, bool kFlipX>
+void Blit(const BlitParams &p, DrawFilterMode filter_mode) {
+  const Si32 fw = p.from_width;
+  const Si32 fh = p.from_height;
+  if (p.to_width == fw && p.to_height == fh) {
+    BlitUnscaled<kBlendingMode, kFlipX>(p);
+  } else if (filter_mode == kFilterBilinear) {
+    BlitBilinear<kBlendingMode, kFlipX>(p);
+  } else if (p.to_width == fw * 2 && p.to_height == fh * 2) {
+    BlitIntegerScaled<kBlendingMode, 2, kFlipX>(p);
+  } else if (p.to_width == fw * 3 && p.to_height == fh * 3) {
+    BlitIntegerScaled<kBlendingMode, 3, kFlipX>(p);
+  } else if (p.to_width == fw * 4 && p.to_height == fh * 4) {
+    BlitIntegerScaled<kBlendingMode, 4, kFlipX>(p);
+  } else {
+    BlitScaled<kBlendingMode, kFlipX>(p);
   }
 }
 
+// Negative to_width or to_height mirror the sprite around its pivot.
 template<DrawBlendingMode kBlendingMode>
 void DrawSprite(
     const Si32 to_x_pivot, const Si32 to_y_pivot,
-    const Si32 to_width, const Si32 to_height,
+    const Si32 to_width_signed, const Si32 to_height_signed,
     const Si32 from_x, const Si32 from_y,
     const Si32 from_width, const Si32 from_height,
-    Sprite to_sprite, Sprite from_sprite) {
-  const Si32 from_stride_pixels = from_sprite.StridePixels();
-  const Si32 to_stride_pixels = to_sprite.Width();
-
-  if (to_width == from_width && to_height == from_height
-      && !from_sprite.IsRef() && !from_sprite.Opaque().empty()) {
-    const std::vector<SpanSi32> &opaque = from_sprite.Opaque();
-
-    const Si32 to_x = to_x_pivot - from_sprite.Pivot().x;
-    const Si32 to_y = to_y_pivot - from_sprite.Pivot().y;
-
-    Rgba *to = to_sprite.RgbaData()
-      + to_y * to_stride_pixels
-      + to_x;
-    const Rgba *from = from_sprite.RgbaData()
-      + from_y * from_stride_pixels
-      + from_x;
-
-    const Si32 to_y_db = (to_y >= 0 ? 0 : -to_y);
-    const Si32 to_y_d_max = to_sprite.Height() - to_y;
-    const Si32 to_y_de = (to_height < to_y_d_max ? to_height : to_y_d_max);
-
-    const Si32 k_to_x_db = (to_x >= 0 ? 0 : -to_x);
-    const Si32 to_x_d_max = to_sprite.Width() - to_x;
-    const Si32 k_to_x_de = (to_width < to_x_d_max ? to_width : to_x_d_max);
-    const Si32 from_x_ab = k_to_x_db + from_x;
-    const Si32 from_x_ae = k_to_x_de + from_x;
-
-    for (Si32 to_y_disp = to_y_db; to_y_disp < to_y_de; ++to_y_disp) {
-      const Si32 from_y_disp = to_y_disp;
-
-      Si32 from_x_acc = 0;
-      const SpanSi32 &span = opaque[from_y + to_y_disp];
-
-      Si32 to_x_db = k_to_x_db;
-      if (span.begin > from_x_ab) {
-        to_x_db += span.begin - from_x_ab;
-      }
-      Si32 to_x_de = k_to_x_de;
-      if (span.end < from_x_ae) {
-        Si32 offset = span.end - from_x_ae;
-        to_x_de += offset;
-      }
-
-      const Rgba *from_line = from + from_y_disp * from_stride_pixels;
-      Rgba *to_line = to + to_y_disp * to_stride_pixels;
-
-      for (Si32 to_x_disp = to_x_db; to_x_disp < to_x_de; ++to_x_disp) {
-        Rgba *to_rgba = to_line + to_x_disp;
-        const Si32 from_x_disp = to_x_db + from_x_acc;
-        from_x_acc++;
-        const Rgba *from_rgba = from_line + from_x_disp;
-        Rgba color = *from_rgba;
-        if (kBlendingMode == kCopyRgba) {
-          to_rgba->rgba = from_rgba->rgba;
-        } else if (kBlendingMode == kAlphaBlend) {
-          if (color.a == 255) {
-            to_rgba->rgba = from_rgba->rgba;
-          } else if (color.a) {
-            Ui32 m = 255 - color.a;
-            Ui32 rb = (to_rgba->rgba & 0x00ff00fful) * m;
-            Ui32 g = ((to_rgba->rgba & 0x0000ff00ul) >> 8) * m;
-            Ui32 m2 = color.a;
-            Ui32 rb2 = (color.rgba & 0x00ff00fful) * m2;
-            Ui32 g2 = ((color.rgba & 0x0000ff00ul) >> 8) * m2;
-            to_rgba->rgba = (((rb + rb2) >> 8) & 0x00ff00fful) |
-            ((g + g2) & 0x0000ff00ul);
-          }
-        } else {  // Unknown blending mode!
-          to_rgba->rgba = from_rgba->rgba;
-        }
-      }
-    }
+    Sprite to_sprite, Sprite from_sprite, DrawFilterMode filter_mode) {
+  const bool flip_x = to_width_signed < 0;
+  const bool flip_y = to_height_signed < 0;
+  const Si32 to_width = flip_x ? -to_width_signed : to_width_signed;
+  const Si32 to_height = flip_y ? -to_height_signed : to_height_signed;
+  if (to_width == 0 || to_height == 0 ||
+      from_width <= 0 || from_height <= 0) {
     return;
   }
 
-  const Si32 to_x = to_x_pivot -
-    from_sprite.Pivot().x * to_width / from_width;
-  const Si32 to_y = to_y_pivot -
-    from_sprite.Pivot().y * to_height / from_height;
-
-  Rgba *to = to_sprite.RgbaData()
-    + to_y * to_stride_pixels
-    + to_x;
-  const Rgba *from = from_sprite.RgbaData()
-    + from_y * from_stride_pixels
-    + from_x;
-
-  const Si32 to_y_db = (to_y >= 0 ? 0 : -to_y);
-  const Si32 to_y_d_max = to_sprite.Height() - to_y;
-  const Si32 to_y_de = (to_height < to_y_d_max ? to_height : to_y_d_max);
-
-  const Si32 to_x_db = (to_x >= 0 ? 0 : -to_x);
-  const Si32 to_x_d_max = to_sprite.Width() - to_x;
-  const Si32 to_x_de = (to_width < to_x_d_max ? to_width : to_x_d_max);
-
-  for (Si32 to_y_disp = to_y_db; to_y_disp < to_y_de; ++to_y_disp) {
-    const Si32 from_y_disp = (from_height * to_y_disp) / to_height;
-
-    const Si32 from_x_b = (from_width * to_x_db) / to_width;
-    const Si32 from_x_step_16 = 65536 * from_width / to_width;
-    Si32 from_x_acc_16 = 0;
-
-    const Rgba *from_line = from + from_y_disp * from_stride_pixels;
-    Rgba *to_line = to + to_y_disp * to_stride_pixels;
-
-    for (Si32 to_x_disp = to_x_db; to_x_disp < to_x_de; ++to_x_disp) {
-      Rgba *to_rgba = to_line + to_x_disp;
-      const Si32 from_x_disp = from_x_b + (from_x_acc_16 / 65536);
-      from_x_acc_16 += from_x_step_16;
-      const Rgba *from_rgba = from_line + from_x_disp;
-      Rgba color = *from_rgba;
-      if (kBlendingMode == kCopyRgba) {
-        to_rgba->rgba = from_rgba->rgba;
-      } else if (kBlendingMode == kAlphaBlend) {
-        if (color.a == 255) {
-          to_rgba->rgba = from_rgba->rgba;
-        } else if (color.a) {
-          Ui32 m = 255 - color.a;
-          Ui32 rb = (to_rgba->rgba & 0x00ff00fful) * m;
-          Ui32 g = ((to_rgba->rgba & 0x0000ff00ul) >> 8) * m;
-          Ui32 m2 = color.a;
-          Ui32 rb2 = (color.rgba & 0x00ff00fful) * m2;
-          Ui32 g2 = ((color.rgba & 0x0000ff00ul) >> 8) * m2;
-          to_rgba->rgba = (((rb + rb2) >> 8) & 0x00ff00fful) |
-            ((g + g2) & 0x0000ff00ul);
-        }
-      } else {  // Unknown blending mode!
-        to_rgba->rgba = from_rgba->rgba;
-      }
+  const Si32 pivot_x = from_sprite.Pivot().x * to_width / from_width;
+  const Si32 pivot_y = from_sprite.Pivot().y * to_height / from_height;
+  const Si32 to_x = to_x_pivot - (flip_x ? to_width - pivot_x : pivot_x);
+  const Si32 to_y = to_y_pivot - (flip_y ? to_height - pivot_y : pivot_y);
+
+  BlitParams p;
+  p.to_stride = to_sprite.StridePixels();
+  p.to = to_sprite.RgbaData() + to_y * p.to_stride + to_x;
+  p.to_width = to_width;
+  p.to_height = to_height;
+  p.x_begin = std::max(0, -to_x);
+  p.x_end = std::min(to_width, to_sprite.Width() - to_x);
+  p.y_begin = std::max(0, -to_y);
+  p.y_end = std::min(to_height, to_sprite.Height() - to_y);
+  if (p.x_end <= p.x_begin || p.y_end <= p.y_begin) {
+    return;
+  }
+  p.flip_y = flip_y;
+  p.opaque = nullptr;
+  p.from_x = from_x;
+  p.from_y = from_y;
+
+  // When shrinking, read from the mip level that matches the scale.
+  Sprite source = from_sprite;
+  Si32 source_x = from_x;
+  Si32 source_y = from_y;
+  Si32 source_width = from_width;
+  Si32 source_height = from_height;
+  if (from_sprite.MipmapCount()) {
+    const float shrink = std::min(
+      static_cast<float>(from_width) / static_cast<float>(to_width),
+      static_cast<float>(from_height) / static_cast<float>(to_height));
+    const Si32 level = PickMipmapLevel(shrink, from_sprite.MipmapCount());
+    if (level) {
+      source = from_sprite.Mipmap(level);
+      source_x = std::min(from_x >> level, source.Width() - 1);
+      source_y = std::min(from_y >> level, source.Height() - 1);
+      source_width = std::min(
+        std::max(1, ((from_x + from_width) >> level) - source_x),
+        source.Width() - source_x);
+      source_height = std::min(
+        std::max(1, ((from_y + from_height) >> level) - source_y),
+        source.Height() - source_y);
     }
   }
+  if (to_width == from_width && to_height == from_height &&
+      !from_sprite.Opaque().empty()) {
+    p.opaque = from_sprite.Opaque().data();
+  }
+  p.from_stride = source.StridePixels();
+  p.from = source.RgbaData() + source_y * p.from_stride + source_x;
+  p.from_width = source_width;
+  p.from_height = source_height;
+
+  if (flip_x) {
+    Blit<kBlendingMode, true>(p, filter_mode);
+  } else {
+    Blit<kBlendingMode, false>(p, filter_mode);
+  }
 }
 
 template void DrawSprite<kCopyRgba>(
@@ -401,13 +430,13 @@ template void DrawSprite<kCopyRgba>(
   const Si32 to_width, const Si32 to_height,
   const Si32 from_x, const Si32 from_y,
   const Si32 from_width, const Si32 from_height,
-  Sprite to_sprite, Sprite from_sprite);
+  Sprite to_sprite, Sprite from_sprite, DrawFilterMode filter_mode);
 template void DrawSprite<kAlphaBlend>(
   const Si32 to_x_pivot, const Si32 to_y_pivot,
   const Si32 to_width, const Si32 to_height,
   const Si32 from_x, const Si32 from_y,
   const Si32 from_width, const Si32 from_height,
-  Sprite to_sprite, Sprite from_sprite);
+  Sprite to_sprite, Sprite from_sprite, DrawFilterMode filter_mode);
 
 
 Sprite::Sprite() {
@@ -418,29 +447,53 @@ Sprite::Sprite() {
 
 void Sprite::Load(const char *file_name) {
   Check(!!file_name, "Error in Sprite::Load, file_name is nullptr.");
-  const char *last_dot = strchr(file_name, '.');
+  const char *last_dot = strrchr(file_name, '.');
   Check(!!last_dot, "Error in Sprite::Load, file_name has no extension.");
-  if (strcmp(last_dot, ".tga") == 0) {
-    std::vector<Ui8> data = ReadFile(file_name);
+  std::vector<Ui8> data;
+  pivot_ = Vec2Si32(0, 0);
+  if (strcmp(last_dot, ".asprite") == 0) {
+    sprite_instance_ = LoadSpriteFile(file_name, &pivot_);
+  } else if (strcmp(last_dot, ".tga") == 0) {
+    data = ReadFile(file_name);
     sprite_instance_ = LoadTga(data.data(), data.size());
-    ref_pos_ = Vec2Si32(0, 0);
-    ref_size_ = Vec2Si32(sprite_instance_->width(),
-      sprite_instance_->height());
-    pivot_ = Vec2Si32(0, 0);
+  } else if (strcmp(last_dot, ".png") == 0) {
+    data = ReadFile(file_name);
+    sprite_instance_ = LoadPng(data.data(), data.size());
+  } else if (strcmp(last_dot, ".qoi") == 0) {
+    data = ReadFile(file_name);
+    sprite_instance_ = LoadQoi(data.data(), data.size());
   } else {
     Fatal("Error in Sprite::Load, unknown file extension.");
   }
+  ref_pos_ = Vec2Si32(0, 0);
+  ref_size_ = Vec2Si32(sprite_instance_->width(),
+    sprite_instance_->height());
+  ref_opaque_.reset();
 }
 
 void Sprite::Load(const std::string &file_name) {
   Load(file_name.c_str());
 }
 
+void Sprite::Save(const char *file_name) {
+  Check(!!file_name, "Error in Sprite::Save, file_name is nullptr.");
+  const char *last_dot = strrchr(file_name, '.');
+  Check(!!last_dot && strcmp(last_dot, ".asprite") == 0,
+    "Error in Sprite::Save, only .asprite files are supported.");
+  SaveSpriteFile(file_name, RgbaData(), Width(), Height(), StridePixels(),
+    pivot_);
+}
+
+void Sprite::Save(const std::string &file_name) {
+  Save(file_name.c_str());
+}
+
 void Sprite::Create(const Si32 width, const Si32 height) {
   sprite_instance_.reset(new SpriteInstance(width, height));
   ref_pos_ = Vec2Si32(0, 0);
   ref_size_ = Vec2Si32(width, height);
   pivot_ = Vec2Si32(0, 0);
+  ref_opaque_.reset();
   Clear();
 }
 
@@ -455,37 +508,34 @@ void Sprite::Reference(Sprite from, const Si32 from_x, const Si32 from_y,
     std::min(from_height, max_size.y));
   pivot_ = Vec2Si32(0, 0);
   sprite_instance_ = from.sprite_instance_;
+  ref_opaque_.reset();
 }
 
 void Sprite::Clear() {
-  if (!sprite_instance_.get()) {
-    return;
-  }
-  const size_t size = static_cast<size_t>(ref_size_.x) * sizeof(Rgba);
-  Ui8 *data = sprite_instance_->RawData();
-  const Si32 stride = StrideBytes();
-  for (Si32 y = 0; y < ref_size_.y; ++y) {
-    memset(data, 0, size);
-    data += stride;
-  }
+  Clear(Rgba(0, 0, 0, 0));
 }
 
 void Sprite::Clear(Rgba color) {
   if (!sprite_instance_.get()) {
     return;
   }
+  Rgba *data = RgbaData();
+  const Si32 width = ref_size_.x;
   const Si32 stride = StridePixels();
-  Rgba *begin = reinterpret_cast<Rgba*>(sprite_instance_->RawData());
-  Rgba *end = begin + ref_size_.x;
-  for (Si32 y = 0; y < ref_size_.y; ++y) {
-    Rgba *p = begin;
-    while (p != end) {
-      p->rgba = color.rgba;
-      p++;
+  const Si32 min_lines = std::max(1,
+    kClearPixelsPerThreadMin / std::max(1, width));
+  ParallelFor(0, ref_size_.y, min_lines, [&](Si32 line_begin, Si32 line_end) {
+    Rgba *line = data + static_cast<Si64>(line_begin) * stride;
+    if (width == stride) {
+      FillPixels(&line->rgba, static_cast<Si64>(line_end - line_begin) * width,
+        color.rgba);
+      return;
     }
-    begin += stride;
-    end += stride;
-  }
+    for (Si32 y = line_begin; y < line_end; ++y) {
+      FillPixels(&line->rgba, width, color.rgba);
+      line += stride;
+    }
+  });
 }
 
 void Sprite::Clone(Sprite from) {
@@ -512,12 +562,12 @@ void Sprite::Draw(const Si32 to_x_pivot, const Si32 to_y_pivot,
     case kAlphaBlend:
       DrawSprite<kAlphaBlend>(to_x_pivot, to_y_pivot, Width(), Height(),
         0, 0, Width(), Height(),
-        GetEngine()->GetBackbuffer(), *this);
+        GetEngine()->GetBackbuffer(), *this, kFilterNearest);
       break;
     case kCopyRgba:
       DrawSprite<kCopyRgba>(to_x_pivot, to_y_pivot, Width(), Height(),
         0, 0, Width(), Height(),
-        GetEngine()->GetBackbuffer(), *this);
+        GetEngine()->GetBackbuffer(), *this, kFilterNearest);
       break;
   }
 }
@@ -563,64 +613,66 @@ void Sprite::Draw(const Si32 to_x, const Si32 to_y,
 
   // d c
   // a b
-  Vec2Si32 a(pivot + left + down + 0.5f);
-  Vec2Si32 b(pivot + right + down + 0.5f);
-  Vec2Si32 c(pivot + right + up + 0.5f);
-  Vec2Si32 d(pivot + left + up + 0.5f);
-
-  Vec2F ta(0.001f,
-    0.001f);
-  Vec2F tb(static_cast<float>(ref_size_.x) - 0.001f,
-    0.001f);
-  Vec2F tc(static_cast<float>(ref_size_.x) - 0.001f,
-    static_cast<float>(ref_size_.y) - 0.001f);
-  Vec2F td(0.001f,
-    static_cast<float>(ref_size_.y) - 0.001f);
-
-  switch (blending_mode) {
-    case kCopyRgba:
-      DrawTriangle<kCopyRgba>(a, b, c, ta, tb, tc, *this, to_sprite);
-      DrawTriangle<kCopyRgba>(c, d, a, tc, td, ta, *this, to_sprite);
-      break;
-    case kAlphaBlend:
-      DrawTriangle<kAlphaBlend>(a, b, c, ta, tb, tc, *this, to_sprite);
-      DrawTriangle<kAlphaBlend>(c, d, a, tc, td, ta, *this, to_sprite);
-      break;
+  Vec2F a = pivot + left + down;
+  Vec2F b = pivot + right + down;
+  Vec2F c = pivot + right + up;
+  Vec2F d = pivot + left + up;
+
+  Sprite source = *this;
+  if (MipmapCount() && zoom != 0.f) {
+    const Si32 level = PickMipmapLevel(1.f / fabsf(zoom), MipmapCount());
+    if (level) {
+      source = Mipmap(level);
+    }
   }
+  const Vec2F source_size = Vec2F(source.Size());
+
+  Vec2F ta(0.f, 0.f);
+  Vec2F tb(source_size.x, 0.f);
+  Vec2F tc(source_size.x, source_size.y);
+  Vec2F td(0.f, source_size.y);
+
+  // The shared edge a-c is drawn once, so blended pixels on it do not
+  // get darker.
+  RasterizeTexturedTriangle(a, b, c, ta, tb, tc, source, to_sprite,
+    blending_mode);
+  RasterizeTexturedTriangle(c, d, a, tc, td, ta, source, to_sprite,
+    blending_mode);
 }
 
 void Sprite::Draw(const Si32 to_x, const Si32 to_y,
     const Si32 to_width, const Si32 to_height,
-    DrawBlendingMode blending_mode) {
+    DrawBlendingMode blending_mode, DrawFilterMode filter_mode) {
   Draw(to_x, to_y, to_width, to_height,
-    0, 0, ref_size_.x, ref_size_.y);
+    0, 0, ref_size_.x, ref_size_.y, blending_mode, filter_mode);
 }
 
 void Sprite::Draw(const Si32 to_x, const Si32 to_y,
     const Si32 to_width, const Si32 to_height,
     const Si32 from_x, const Si32 from_y,
     const Si32 from_width, const Si32 from_height,
-    DrawBlendingMode blending_mode) {
+    DrawBlendingMode blending_mode, DrawFilterMode filter_mode) {
   Draw(to_x, to_y, to_width, to_height,
     from_x, from_y, from_width, from_height,
-    GetEngine()->GetBackbuffer());
+    GetEngine()->GetBackbuffer(), blending_mode, filter_mode);
 }
 
 void Sprite::Draw(const Vec2Si32 to_pos, DrawBlendingMode blending_mode) {
-  Draw(to_pos.x, to_pos.y);
+  Draw(to_pos.x, to_pos.y, blending_mode);
 }
 
 void Sprite::Draw(const Vec2Si32 to_pos, const Vec2Si32 to_size,
-    DrawBlendingMode blending_mode) {
+    DrawBlendingMode blending_mode, DrawFilterMode filter_mode) {
   Draw(to_pos.x, to_pos.y, to_size.x, to_size.y,
-    0, 0, ref_size_.x, ref_size_.y);
+    0, 0, ref_size_.x, ref_size_.y, blending_mode, filter_mode);
 }
 
 void Sprite::Draw(const Vec2Si32 to_pos, const Vec2Si32 to_size,
     const Vec2Si32 from_pos, const Vec2Si32 from_size,
-    DrawBlendingMode blending_mode) {
+    DrawBlendingMode blending_mode, DrawFilterMode filter_mode) {
   Draw(to_pos.x, to_pos.y, to_size.x, to_size.y,
-    from_pos.x, from_pos.y, from_size.x, from_size.y);
+    from_pos.x, from_pos.y, from_size.x, from_size.y,
+    blending_mode, filter_mode);
 }
 
 
@@ -628,18 +680,19 @@ void Sprite::Draw(const Si32 to_x_pivot, const Si32 to_y_pivot,
     const Si32 to_width, const Si32 to_height,
     const Si32 from_x, const Si32 from_y,
     const Si32 from_width, const Si32 from_height,
-    Sprite to_sprite, DrawBlendingMode blending_mode) {
+    Sprite to_sprite, DrawBlendingMode blending_mode,
+    DrawFilterMode filter_mode) {
   switch (blending_mode) {
   default:
   case kCopyRgba:
     DrawSprite<kCopyRgba>(to_x_pivot, to_y_pivot, to_width, to_height,
       from_x, from_y, from_width, from_height,
-      to_sprite, *this);
+      to_sprite, *this, filter_mode);
     break;
   case kAlphaBlend:
     DrawSprite<kAlphaBlend>(to_x_pivot, to_y_pivot, to_width, to_height,
       from_x, from_y, from_width, from_height,
-      to_sprite, *this);
+      to_sprite, *this, filter_mode);
     break;
   }
   return;
@@ -684,16 +737,79 @@ Rgba* Sprite::RgbaData() {
 }
 
 const std::vector<SpanSi32> &Sprite::Opaque() const {
+  if (IsRef()) {
+    static const std::vector<SpanSi32> kNoSpans;
+    return ref_opaque_ ? *ref_opaque_ : kNoSpans;
+  }
   return sprite_instance_->Opaque();
 }
 
 void Sprite::UpdateOpaqueSpans() {
-  sprite_instance_->UpdateOpaqueSpans();
+  if (!IsRef()) {
+    sprite_instance_->UpdateOpaqueSpans();
+    return;
+  }
+  // References share the pixels but keep spans of their own, so sprites
+  // packed into an atlas still skip their transparent edges.
+  std::shared_ptr<std::vector<SpanSi32>> spans(
+    new std::vector<SpanSi32>(ref_size_.y));
+  const Rgba *line = RgbaData();
+  for (Si32 y = 0; y < ref_size_.y; ++y) {
+    (*spans)[y] = FindOpaqueSpan(line, ref_size_.x);
+    line += StridePixels();
+  }
+  ref_opaque_ = spans;
 }
 
 void Sprite::ClearOpaqueSpans() {
+  if (IsRef()) {
+    ref_opaque_.reset();
+    return;
+  }
   sprite_instance_->ClearOpaqueSpans();
 }
 
+void Sprite::UpdateMipmaps() {
+  if (sprite_instance_) {
+    sprite_instance_->UpdateMipmaps();
+  }
+}
+
+void Sprite::ClearMipmaps() {
+  if (sprite_instance_) {
+    sprite_instance_->ClearMipmaps();
+  }
+}
+
+Si32 Sprite::MipmapCount() const {
+  if (!sprite_instance_) {
+    return 0;
+  }
+  return static_cast<Si32>(sprite_instance_->Mipmaps().size());
+}
+
+Sprite Sprite::Mipmap(Si32 level) const {
+  if (level <= 0) {
+    return *this;
+  }
+  Check(level <= MipmapCount(),
+    "Error in Sprite::Mipmap, level is out of range.");
+  const std::shared_ptr<SpriteInstance> &instance =
+    sprite_instance_->Mipmaps()[static_cast<size_t>(level - 1)];
+  Sprite result;
+  result.sprite_instance_ = instance;
+  result.ref_pos_ = Vec2Si32(
+    std::min(ref_pos_.x >> level, instance->width() - 1),
+    std::min(ref_pos_.y >> level, instance->height() - 1));
+  const Vec2Si32 end(
+    std::min((ref_pos_.x + ref_size_.x) >> level, instance->width()),
+    std::min((ref_pos_.y + ref_size_.y) >> level, instance->height()));
+  result.ref_size_ = Vec2Si32(
+    std::max(1, end.x - result.ref_pos_.x),
+    std::max(1, end.y - result.ref_pos_.y));
+  result.pivot_ = Vec2Si32(pivot_.x >> level, pivot_.y >> level);
+  return result;
+}
+
 }  // namespace easy
 }  // namespace arctic
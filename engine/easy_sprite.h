@@ -40,17 +40,53 @@ enum DrawBlendingMode {
   kAlphaBlend
 };
 
+// Writes one pixel of a draw.
+template<DrawBlendingMode kBlendingMode>
+inline void DrawPixel(Rgba color, Rgba *to) {
+  if (kBlendingMode == kCopyRgba) {
+    to->rgba = color.rgba;
+  } else if (kBlendingMode == kAlphaBlend) {
+    if (color.a == 255) {
+      to->rgba = color.rgba;
+    } else if (color.a) {
+      Ui32 m = 255 - color.a;
+      Ui32 rb = (to->rgba & 0x00ff00fful) * m;
+      Ui32 g = ((to->rgba & 0x0000ff00ul) >> 8) * m;
+      Ui32 m2 = color.a;
+      Ui32 rb2 = (color.rgba & 0x00ff00fful) * m2;
+      Ui32 g2 = ((color.rgba & 0x0000ff00ul) >> 8) * m2;
+      to->rgba = (((rb + rb2) >> 8) & 0x00ff00fful) |
+        ((g + g2) & 0x0000ff00ul);
+    }
+  } else {  // Unknown blending mode!
+    to->rgba = color.rgba;
+  }
+}
+
+// How the sized draws sample a sprite that is scaled.
+enum DrawFilterMode {
+  kFilterNearest,
+  kFilterBilinear
+};
+
 class Sprite {
  private:
   std::shared_ptr<SpriteInstance> sprite_instance_;
   Vec2Si32 ref_pos_;
   Vec2Si32 ref_size_;
   Vec2Si32 pivot_;
+  // Opaque spans of a reference, relative to its own corner.
+  std::shared_ptr<std::vector<SpanSi32>> ref_opaque_;
 
  public:
   Sprite();
+  // Loads .tga, .png, .qoi and .asprite files. Unlike TGA ones, sprites
+  // loaded from the other formats come with their opaque spans.
   void Load(const char *file_name);
   void Load(const std::string &file_name);
+  // Saves in the native .asprite format, which loads with no decoding.
+  void Save(const char *file_name);
+  void Save(const std::string &file_name);
   void Create(const Si32 width, const Si32 height);
   void Reference(Sprite from, const Si32 from_x, const Si32 from_y,
     const Si32 from_width, const Si32 from_height);
@@ -61,26 +97,33 @@ class Sprite {
   Vec2Si32 Pivot() const;
   void Draw(const Si32 to_x, const Si32 to_y,
     DrawBlendingMode blending_mode = kAlphaBlend);
+  // In the sized draws a negative to_width or to_height mirrors the sprite
+  // around its pivot, with no extra cost.
   void Draw(const Si32 to_x, const Si32 to_y,
     const Si32 to_width, const Si32 to_height,
-    DrawBlendingMode blending_mode = kAlphaBlend);
+    DrawBlendingMode blending_mode = kAlphaBlend,
+    DrawFilterMode filter_mode = kFilterNearest);
   void Draw(const Si32 to_x, const Si32 to_y,
     const Si32 to_width, const Si32 to_height,
     const Si32 from_x, const Si32 from_y,
     const Si32 from_width, const Si32 from_height,
-    DrawBlendingMode blending_mode = kAlphaBlend);
+    DrawBlendingMode blending_mode = kAlphaBlend,
+    DrawFilterMode filter_mode = kFilterNearest);
   void Draw(const Vec2Si32 to_pos,
     DrawBlendingMode blending_mode = kAlphaBlend);
   void Draw(const Vec2Si32 to_pos, const Vec2Si32 to_size,
-    DrawBlendingMode blending_mode = kAlphaBlend);
+    DrawBlendingMode blending_mode = kAlphaBlend,
+    DrawFilterMode filter_mode = kFilterNearest);
   void Draw(const Vec2Si32 to_pos, const Vec2Si32 to_size,
     const Vec2Si32 from_pos, const Vec2Si32 from_size,
-    DrawBlendingMode blending_mode = kAlphaBlend);
+    DrawBlendingMode blending_mode = kAlphaBlend,
+    DrawFilterMode filter_mode = kFilterNearest);
   void Draw(const Si32 to_x, const Si32 to_y,
     const Si32 to_width, const Si32 to_height,
     const Si32 from_x, const Si32 from_y,
     const Si32 from_width, const Si32 from_height,
-    Sprite to_sprite, DrawBlendingMode blending_mode = kAlphaBlend);
+    Sprite to_sprite, DrawBlendingMode blending_mode = kAlphaBlend,
+    DrawFilterMode filter_mode = kFilterNearest);
   void Draw(const Vec2Si32 to, float angle_radians,
     DrawBlendingMode blending_mode = kAlphaBlend);
   void Draw(const Si32 to_x, const Si32 to_y, float angle_radians,
@@ -102,9 +145,20 @@ class Sprite {
   bool IsRef() const;
   Ui8* RawData();
   Rgba* RgbaData();
+  // Draws skip the transparent ends of the lines that have opaque spans.
+  // The spans go stale when the pixels change, update or clear them then.
   const std::vector<SpanSi32> &Opaque() const;
   void UpdateOpaqueSpans();
   void ClearOpaqueSpans();
+  // Builds half size copies of the underlying image. Scaled and rotated
+  // draws that shrink the sprite then sample the closest level instead of
+  // skipping texels. Call again after changing the pixels.
+  void UpdateMipmaps();
+  void ClearMipmaps();
+  // Number of levels below the sprite itself, 0 without mipmaps.
+  Si32 MipmapCount() const;
+  // A reference to this sprite's area in the given level, 0 is the sprite.
+  Sprite Mipmap(Si32 level) const;
 };
 
 }  // namespace easy
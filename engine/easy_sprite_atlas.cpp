@@ -0,0 +1,320 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "engine/easy_sprite_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "engine/arctic_platform.h"
+#include "engine/easy.h"
+
+namespace arctic {
+namespace easy {
+
+static const char kAtlasFileMagic[4] = {'A', 'A', 'T', 'L'};
+static const Ui32 kAtlasFileVersion = 1;
+static const Si32 kAtlasEntryFields = 8;
+
+// The index is little-endian on every platform.
+static void AppendAtlasUi32(std::vector<Ui8> *file, Ui32 value) {
+  for (Si32 shift = 0; shift < 32; shift += 8) {
+    file->push_back(static_cast<Ui8>(value >> shift));
+  }
+}
+
+inline Ui32 ReadAtlasUi32(const Ui8 *p) {
+  return static_cast<Ui32>(p[0]) | (static_cast<Ui32>(p[1]) << 8) |
+    (static_cast<Ui32>(p[2]) << 16) | (static_cast<Ui32>(p[3]) << 24);
+}
+
+SpriteAtlas::SpriteAtlas(Si32 page_width, Si32 page_height, Si32 padding)
+    : page_width_(page_width)
+    , page_height_(page_height)
+    , padding_(padding) {
+  Check(page_width > 0 && page_height > 0 && padding >= 0,
+    "Error in SpriteAtlas, bad page size or padding.");
+}
+
+// Skyline bottom-left: the lowest spot along the top edge of the packed
+// area where the rectangle fits, the leftmost among equals.
+Si32 SpriteAtlas::FindPosition(Si32 page, Si32 width, Si32 height,
+    Si32 *out_x, Si32 *out_y) const {
+  const std::vector<SkylineNode> &skyline = skylines_[page];
+  const Si32 page_width = pages_[page].Width();
+  const Si32 page_height = pages_[page].Height();
+  Si32 best_index = -1;
+  Si32 best_top = std::numeric_limits<Si32>::max();
+  Si32 best_width = std::numeric_limits<Si32>::max();
+  for (Si32 idx = 0; idx < static_cast<Si32>(skyline.size()); ++idx) {
+    const Si32 x = skyline[idx].x;
+    if (x + width > page_width) {
+      break;
+    }
+    Si32 y = 0;
+    Si32 width_left = width;
+    for (Si32 node = idx; width_left > 0; ++node) {
+      y = std::max(y, skyline[node].y);
+      width_left -= skyline[node].width;
+    }
+    const Si32 top = y + height;
+    if (top <= page_height && (top < best_top ||
+        (top == best_top && skyline[idx].width < best_width))) {
+      best_index = idx;
+      best_top = top;
+      best_width = skyline[idx].width;
+      *out_x = x;
+      *out_y = y;
+    }
+  }
+  return best_index;
+}
+
+void SpriteAtlas::Place(std::vector<SkylineNode> *skyline, Si32 index,
+    Si32 x, Si32 y, Si32 width, Si32 height) {
+  SkylineNode node;
+  node.x = x;
+  node.y = y + height;
+  node.width = width;
+  skyline->insert(skyline->begin() + index, node);
+  // Trims or removes the nodes the new one covers.
+  for (size_t idx = index + 1; idx < skyline->size();) {
+    SkylineNode &next = (*skyline)[idx];
+    const Si32 covered = x + width - next.x;
+    if (covered <= 0) {
+      break;
+    }
+    if (covered < next.width) {
+      next.x += covered;
+      next.width -= covered;
+      break;
+    }
+    skyline->erase(skyline->begin() + idx);
+  }
+  for (size_t idx = 0; idx + 1 < skyline->size();) {
+    if ((*skyline)[idx].y == (*skyline)[idx + 1].y) {
+      (*skyline)[idx].width += (*skyline)[idx + 1].width;
+      skyline->erase(skyline->begin() + idx + 1);
+    } else {
+      ++idx;
+    }
+  }
+}
+
+Sprite SpriteAtlas::MakeReference(const Entry &entry) {
+  Sprite sprite;
+  sprite.Reference(pages_[entry.page], entry.pos.x, entry.pos.y,
+    entry.size.x, entry.size.y);
+  sprite.SetPivot(entry.pivot);
+  sprite.UpdateOpaqueSpans();
+  return sprite;
+}
+
+Sprite SpriteAtlas::Add(Sprite sprite, const std::string &name) {
+  const Si32 width = sprite.Width() + padding_ * 2;
+  const Si32 height = sprite.Height() + padding_ * 2;
+  Si32 page = 0;
+  Si32 index = -1;
+  Si32 x = 0;
+  Si32 y = 0;
+  for (; page < static_cast<Si32>(pages_.size()); ++page) {
+    index = FindPosition(page, width, height, &x, &y);
+    if (index >= 0) {
+      break;
+    }
+  }
+  if (index < 0) {
+    // Sprites larger than a page get a page of their own size.
+    Sprite new_page;
+    new_page.Create(std::max(page_width_, width),
+      std::max(page_height_, height));
+    pages_.push_back(new_page);
+    SkylineNode node;
+    node.x = 0;
+    node.y = 0;
+    node.width = new_page.Width();
+    skylines_.push_back(std::vector<SkylineNode>(1, node));
+    page = static_cast<Si32>(pages_.size()) - 1;
+    index = 0;
+    x = 0;
+    y = 0;
+  }
+  Place(&skylines_[page], index, x, y, width, height);
+
+  Entry entry;
+  entry.name = name;
+  entry.page = page;
+  entry.pos = Vec2Si32(x + padding_, y + padding_);
+  entry.size = sprite.Size();
+  entry.pivot = sprite.Pivot();
+  Sprite &to_page = pages_[page];
+  const Si32 stride = to_page.StridePixels();
+  const Si32 w = entry.size.x;
+  const Si32 h = entry.size.y;
+  const Rgba *from = sprite.RgbaData();
+  Rgba *to = to_page.RgbaData() + entry.pos.y * stride + entry.pos.x;
+  if (w > 0 && h > 0) {
+    // The padding repeats the edge pixels, so bilinear draws and mipmaps
+    // that sample past the edge see the sprite and not its neighbours.
+    for (Si32 line = 0; line < h; ++line) {
+      Rgba *to_line = to + line * stride;
+      std::memcpy(static_cast<void*>(to_line), from, w * sizeof(Rgba));
+      std::fill(to_line - padding_, to_line, from[0]);
+      std::fill(to_line + w, to_line + w + padding_, from[w - 1]);
+      from += sprite.StridePixels();
+    }
+    const size_t padded_bytes = (w + padding_ * 2) * sizeof(Rgba);
+    Rgba *bottom = to - padding_;
+    Rgba *top = to - padding_ + (h - 1) * stride;
+    for (Si32 idx = 1; idx <= padding_; ++idx) {
+      std::memcpy(static_cast<void*>(bottom - idx * stride), bottom,
+        padded_bytes);
+      std::memcpy(static_cast<void*>(top + idx * stride), top, padded_bytes);
+    }
+  }
+  if (!name.empty()) {
+    names_[name] = static_cast<Si32>(entries_.size());
+  }
+  entries_.push_back(entry);
+  return MakeReference(entry);
+}
+
+Sprite SpriteAtlas::Add(const char *file_name) {
+  Sprite sprite;
+  sprite.Load(file_name);
+  return Add(sprite, file_name);
+}
+
+void SpriteAtlas::Add(std::vector<Sprite> *sprites) {
+  std::vector<Si32> order(sprites->size());
+  for (size_t idx = 0; idx < order.size(); ++idx) {
+    order[idx] = static_cast<Si32>(idx);
+  }
+  std::stable_sort(order.begin(), order.end(), [sprites](Si32 a, Si32 b) {
+    return (*sprites)[a].Height() > (*sprites)[b].Height();
+  });
+  for (Si32 idx : order) {
+    (*sprites)[idx] = Add((*sprites)[idx]);
+  }
+}
+
+Sprite SpriteAtlas::Find(const std::string &name) {
+  auto it = names_.find(name);
+  Check(it != names_.end(), "Error in SpriteAtlas::Find, no sprite named: ",
+    name.c_str());
+  return MakeReference(entries_[it->second]);
+}
+
+Si32 SpriteAtlas::PageCount() const {
+  return static_cast<Si32>(pages_.size());
+}
+
+Sprite SpriteAtlas::Page(Si32 index) const {
+  return pages_[index];
+}
+
+void SpriteAtlas::Save(const char *file_name) const {
+  std::vector<Ui8> file(kAtlasFileMagic,
+    kAtlasFileMagic + sizeof(kAtlasFileMagic));
+  AppendAtlasUi32(&file, kAtlasFileVersion);
+  AppendAtlasUi32(&file, static_cast<Ui32>(pages_.size()));
+  AppendAtlasUi32(&file, static_cast<Ui32>(entries_.size()));
+  for (const Entry &entry : entries_) {
+    const Si32 fields[kAtlasEntryFields] = {
+      static_cast<Si32>(entry.name.size()), entry.page,
+      entry.pos.x, entry.pos.y, entry.size.x, entry.size.y,
+      entry.pivot.x, entry.pivot.y};
+    for (Si32 field : fields) {
+      AppendAtlasUi32(&file, static_cast<Ui32>(field));
+    }
+    file.insert(file.end(), entry.name.begin(), entry.name.end());
+  }
+  WriteFile(file_name, file.data(), file.size());
+  for (size_t page = 0; page < pages_.size(); ++page) {
+    Sprite sprite = pages_[page];
+    sprite.Save(std::string(file_name) + "." + std::to_string(page) +
+      ".asprite");
+  }
+}
+
+void SpriteAtlas::Load(const char *file_name) {
+  std::vector<Ui8> file = ReadFile(file_name);
+  const size_t header_size = sizeof(kAtlasFileMagic) + sizeof(Ui32) * 3;
+  Check(file.size() >= header_size &&
+    std::memcmp(file.data(), kAtlasFileMagic, 4) == 0,
+    "Error in SpriteAtlas::Load, not an atlas file: ", file_name);
+  Check(ReadAtlasUi32(file.data() + 4) == kAtlasFileVersion,
+    "Error in SpriteAtlas::Load, unsupported version: ", file_name);
+  const Ui32 page_count = ReadAtlasUi32(file.data() + 8);
+  const Ui32 entry_count = ReadAtlasUi32(file.data() + 12);
+  pages_.clear();
+  skylines_.clear();
+  entries_.clear();
+  names_.clear();
+  for (Ui32 page = 0; page < page_count; ++page) {
+    pages_.emplace_back();
+    pages_.back().Load(std::string(file_name) + "." + std::to_string(page) +
+      ".asprite");
+    // Loaded pages are full, new sprites go to new pages.
+    SkylineNode node;
+    node.x = 0;
+    node.y = pages_.back().Height();
+    node.width = pages_.back().Width();
+    skylines_.push_back(std::vector<SkylineNode>(1, node));
+  }
+  size_t pos = header_size;
+  for (Ui32 idx = 0; idx < entry_count; ++idx) {
+    Si32 fields[kAtlasEntryFields];
+    Check(pos + sizeof(fields) <= file.size(),
+      "Error in SpriteAtlas::Load, unexpected end of file: ", file_name);
+    for (Si32 field = 0; field < kAtlasEntryFields; ++field) {
+      fields[field] = static_cast<Si32>(ReadAtlasUi32(file.data() + pos));
+      pos += sizeof(Ui32);
+    }
+    Check(fields[0] >= 0 && pos + fields[0] <= file.size() &&
+      fields[1] >= 0 && fields[1] < static_cast<Si32>(pages_.size()),
+      "Error in SpriteAtlas::Load, bad entry: ", file_name);
+    // The references must stay inside their page.
+    const Sprite &entry_page = pages_[fields[1]];
+    Check(fields[2] >= 0 && fields[3] >= 0 && fields[4] >= 0 &&
+      fields[5] >= 0 && fields[4] <= entry_page.Width() - fields[2] &&
+      fields[5] <= entry_page.Height() - fields[3],
+      "Error in SpriteAtlas::Load, entry is out of its page: ", file_name);
+    Entry entry;
+    entry.name.assign(reinterpret_cast<const char*>(file.data() + pos),
+      fields[0]);
+    pos += fields[0];
+    entry.page = fields[1];
+    entry.pos = Vec2Si32(fields[2], fields[3]);
+    entry.size = Vec2Si32(fields[4], fields[5]);
+    entry.pivot = Vec2Si32(fields[6], fields[7]);
+    if (!entry.name.empty()) {
+      names_[entry.name] = static_cast<Si32>(entries_.size());
+    }
+    entries_.push_back(entry);
+  }
+}
+
+}  // namespace easy
+}  // namespace arctic
@@ -0,0 +1,92 @@
+// The MIT License(MIT)
+//
+// Copyright 2017 Huldra
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and / or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef ENGINE_EASY_SPRITE_ATLAS_H_
+#define ENGINE_EASY_SPRITE_ATLAS_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "engine/arctic_types.h"
+#include "engine/easy_sprite.h"
+
+namespace arctic {
+namespace easy {
+
+// Packs many small sprites into a few large pages, so drawing them touches
+// less memory. The packed sprites are references into the pages and keep
+// their pivots and opaque spans. The padding around each sprite repeats
+// its edge pixels, so filtered draws do not bleed in the neighbours.
+class SpriteAtlas {
+ private:
+  struct SkylineNode {
+    Si32 x;
+    Si32 y;
+    Si32 width;
+  };
+  struct Entry {
+    std::string name;
+    Si32 page;
+    Vec2Si32 pos;
+    Vec2Si32 size;
+    Vec2Si32 pivot;
+  };
+
+  Si32 page_width_;
+  Si32 page_height_;
+  Si32 padding_;
+  std::vector<Sprite> pages_;
+  std::vector<std::vector<SkylineNode>> skylines_;
+  std::vector<Entry> entries_;
+  std::unordered_map<std::string, Si32> names_;
+
+  Si32 FindPosition(Si32 page, Si32 width, Si32 height, Si32 *out_x,
+    Si32 *out_y) const;
+  void Place(std::vector<SkylineNode> *skyline, Si32 index, Si32 x, Si32 y,
+    Si32 width, Si32 height);
+  Sprite MakeReference(const Entry &entry);
+
+ public:
+  explicit SpriteAtlas(Si32 page_width = 2048, Si32 page_height = 2048,
+    Si32 padding = 1);
+  // Copies the sprite into the atlas and returns the reference to use
+  // instead. A nonempty name makes it available to Find after Load.
+  Sprite Add(Sprite sprite, const std::string &name = std::string());
+  // Loads an image file and adds it under its file name.
+  Sprite Add(const char *file_name);
+  // Adds the sprites tallest first, which packs tighter than adding them
+  // one by one, and replaces each with its reference.
+  void Add(std::vector<Sprite> *sprites);
+  Sprite Find(const std::string &name);
+  Si32 PageCount() const;
+  Sprite Page(Si32 index) const;
+  // Saves the pages as file_name.N.asprite next to an index in file_name,
+  // so an offline build step can do the packing.
+  void Save(const char *file_name) const;
+  void Load(const char *file_name);
+};
+
+}  // namespace easy
+}  // namespace arctic
+
+#endif  // ENGINE_EASY_SPRITE_ATLAS_H_
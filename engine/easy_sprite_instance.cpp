@@ -23,9 +23,17 @@
 
 #include "engine/easy_sprite_instance.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <memory>
+#include <utility>
 
+#include "engine/arctic_parallel.h"
+#include "engine/arctic_pixel_convert.h"
 #include "engine/arctic_platform.h"
+#include "engine/arctic_simd.h"
+#include "engine/easy.h"
 #include "engine/rgb.h"
 #include "engine/rgba.h"
 
@@ -38,6 +46,27 @@ SpriteInstance::SpriteInstance(Si32 width, Si32 height)
     , data_(width * height * sizeof(Rgba)) {
     }
 
+SpanSi32 FindOpaqueSpan(const Rgba *line, Si32 width) {
+  SpanSi32 span;
+  span.begin = 0;
+  span.end = 0;
+  Si32 x = 0;
+  for (; x < width; ++x) {
+    if (line[x].a != 0) {
+      span.begin = x;
+      break;
+    }
+  }
+  if (x < width) {
+    Si32 last = width - 1;
+    while (line[last].a == 0) {
+      --last;
+    }
+    span.end = last + 1;
+  }
+  return span;
+}
+
 void SpriteInstance::UpdateOpaqueSpans() {
   if (!height_) {
     opaque_.clear();
@@ -47,29 +76,114 @@ void SpriteInstance::UpdateOpaqueSpans() {
   for (Si32 y = 0; y < height_; ++y) {
     const Rgba *line = reinterpret_cast<Rgba*>(data_.GetVoidData()) +
       width_ * y;
-    SpanSi32 &span = opaque_[y];
-    span.begin = 0;
-    span.end = 0;
-    Si32 x = 0;
-    for (; x < width_; ++x) {
-      if (line[x].a != 0) {
-        span.begin = x;
-        break;
-      }
+    opaque_[y] = FindOpaqueSpan(line, width_);
+  }
+}
+
+void SpriteInstance::SetOpaqueSpans(std::vector<SpanSi32> spans) {
+  opaque_ = std::move(spans);
+}
+
+void SpriteInstance::ClearOpaqueSpans() {
+  opaque_.clear();
+}
+
+static const Si32 kMipmapPixelsPerThreadMin = 32768;
+
+// Averages the cols by rows block of pixels at from. Colors are weighted
+// by alpha, so transparent pixels do not darken the edges of the shrunk
+// image.
+inline Rgba AverageBlock(const Rgba *from, Si32 stride, Si32 cols,
+    Si32 rows) {
+  const Ui32 count = static_cast<Ui32>(cols * rows);
+  Ui32 r = 0;
+  Ui32 g = 0;
+  Ui32 b = 0;
+  Ui32 a = 0;
+  for (Si32 y = 0; y < rows; ++y) {
+    for (Si32 x = 0; x < cols; ++x) {
+      const Rgba p = from[y * stride + x];
+      r += p.r;
+      g += p.g;
+      b += p.b;
+      a += p.a;
+    }
+  }
+  if (a == count * 255) {
+    return Rgba(static_cast<Ui8>((r + count / 2) / count),
+      static_cast<Ui8>((g + count / 2) / count),
+      static_cast<Ui8>((b + count / 2) / count), 255);
+  }
+  if (a == 0) {
+    return Rgba(0, 0, 0, 0);
+  }
+  r = 0;
+  g = 0;
+  b = 0;
+  for (Si32 y = 0; y < rows; ++y) {
+    for (Si32 x = 0; x < cols; ++x) {
+      const Rgba p = from[y * stride + x];
+      r += static_cast<Ui32>(p.r) * p.a;
+      g += static_cast<Ui32>(p.g) * p.a;
+      b += static_cast<Ui32>(p.b) * p.a;
     }
-    if (x < width_) {
-      for (; x < width_; ++x) {
-        if (line[x].a != 0) {
-          span.end = x;
-        }
+  }
+  return Rgba(static_cast<Ui8>((r + a / 2) / a),
+    static_cast<Ui8>((g + a / 2) / a),
+    static_cast<Ui8>((b + a / 2) / a),
+    static_cast<Ui8>((a + count / 2) / count));
+}
+
+// Averages the blocks of rows lines at from into the to_width pixels at to.
+// The last block takes all the columns left, 3 for an odd from_width.
+inline void DownsampleLine(const Rgba *from, Si32 from_width, Si32 rows,
+    Rgba *to, Si32 to_width) {
+  const Si32 last = to_width - 1;
+  for (Si32 x = 0; x < last; ++x) {
+    to[x] = AverageBlock(from + x * 2, from_width, 2, rows);
+  }
+  to[last] = AverageBlock(from + last * 2, from_width,
+    from_width - last * 2, rows);
+}
+
+// Averages 2x2 blocks of from into to, which is half the size rounded down
+// but at least 1. The last column and line of an odd size fold into the
+// blocks next to them, so no pixel is dropped.
+static void DownsampleHalf(const Rgba *from, Si32 from_width,
+    Si32 from_height, Rgba *to, Si32 to_width, Si32 to_height) {
+  const Si32 min_lines = std::max(1,
+    kMipmapPixelsPerThreadMin / std::max(1, to_width));
+  ParallelFor(0, to_height, min_lines, [&](Si32 line_begin, Si32 line_end) {
+    for (Si32 y = line_begin; y < line_end; ++y) {
+      const Rgba *line = from + y * 2 * from_width;
+      Rgba *out = to + y * to_width;
+      // A constant 2 lets the compiler turn the divisions into shifts.
+      if (y + 1 < to_height) {
+        DownsampleLine(line, from_width, 2, out, to_width);
+      } else {
+        DownsampleLine(line, from_width, from_height - y * 2, out, to_width);
       }
-      span.end++;
     }
+  });
+}
+
+void SpriteInstance::UpdateMipmaps() {
+  mipmaps_.clear();
+  SpriteInstance *from = this;
+  while (from->width_ > 1 || from->height_ > 1) {
+    std::shared_ptr<SpriteInstance> level(new SpriteInstance(
+      std::max(1, from->width_ / 2), std::max(1, from->height_ / 2)));
+    DownsampleHalf(reinterpret_cast<const Rgba*>(from->RawData()),
+      from->width_, from->height_,
+      reinterpret_cast<Rgba*>(level->RawData()),
+      level->width_, level->height_);
+    mipmaps_.push_back(level);
+    from = level.get();
   }
 }
 
-void SpriteInstance::ClearOpaqueSpans() {
-  opaque_.clear();
+void SpriteInstance::ClearMipmaps() {
+  mipmaps_.clear();
 }
 
 }  // namespace easy
@@ -91,59 +205,134 @@ typedef struct {
 }TGAHEADER;
 #pragma pack()
 
-/*
-   static int U_Load(piImage *bmp, FILE * fp) {
-   const int bpp = bmp->GetBpp();
-   const int l = bmp->GetXRes()*bmp->GetYRes()*bpp;
-
-   if (!fread(bmp->GetData(), 1, l, fp))
-   return(0);
-
-   return(1);
-   }
-
-   static int C_Load(piImage * bmp, FILE * fp) {
-   unsigned char   aux[4];
-   unsigned char   chunkheader;
-   int             i, counter;
+// Fewer lines are not worth waking the worker threads for.
+static const Si32 kTgaLinesPerThreadMin = 64;
 
-   const int bpp = bmp->GetBpp();
+// How TGA pixels are stored: true color, grey or palette indices.
+enum TgaPixelKind {
+  kTgaPixelTrueColor,
+  kTgaPixelGrey,
+  kTgaPixelIndexed
+};
 
-   int pixelcount = bmp->GetXRes()*bmp->GetYRes();
-   int currentpixel = 0;
-   unsigned char *buffer = (unsigned char*)bmp->GetData();
+struct TgaPixelFormat {
+  TgaPixelKind kind;
+  Si32 bytes;
+  bool has_alpha;
+  const Rgba *palette;
+};
 
+inline Rgba TgaColor16(Ui32 value, bool has_alpha) {
+  // A1R5G5B5, channels are widened by repeating their top bits.
+  Ui32 r = (value >> 10) & 31;
+  Ui32 g = (value >> 5) & 31;
+  Ui32 b = value & 31;
+  return Rgba(static_cast<Ui8>((r << 3) | (r >> 2)),
+    static_cast<Ui8>((g << 3) | (g >> 2)),
+    static_cast<Ui8>((b << 3) | (b >> 2)),
+    static_cast<Ui8>(has_alpha && !(value & 0x8000) ? 0 : 255));
+}
 
-   while (currentpixel<pixelcount) {
-   if (!fread(&chunkheader, 1, 1, fp))
-   return(0);
-
-   counter = 1 + (chunkheader & 0x7F);
-
-   if (chunkheader<128) {
-   for (i = 0; i<counter; i++) {
-   if (!fread(buffer, 1, bpp, fp))
-   return(0);
-   buffer += bpp;
-   }
-   } else {
-   if (!fread(aux, 1, bpp, fp))
-   return(0);
-
-   for (i = 0; i<counter; i++) {
-   buffer[0] = aux[0];
-   if (bpp>1) buffer[1] = aux[1];
-   if (bpp>2) buffer[2] = aux[2];
-   if (bpp>3) buffer[3] = aux[3];
-   buffer += bpp;
-   }
-   }
+inline Rgba ReadTgaPixel(const Ui8 *from, const TgaPixelFormat &format) {
+  switch (format.kind) {
+    case kTgaPixelTrueColor:
+      if (format.bytes == 4) {
+        return Rgba(from[2], from[1], from[0], from[3]);
+      } else if (format.bytes == 3) {
+        return Rgba(from[2], from[1], from[0], 255);
+      }
+      return TgaColor16(from[0] | (from[1] << 8), format.has_alpha);
+    case kTgaPixelGrey:
+      return Rgba(from[0], from[0], from[0],
+        format.bytes == 2 ? from[1] : 255);
+    case kTgaPixelIndexed:
+      return format.palette[from[0]];
+  }
+  return Rgba(0, 0, 0, 0);
+}
 
-   currentpixel += counter;
-   }
+// Converts count pixels, the format switch happens once per span.
+static void ConvertTgaPixels(const Ui8 *from, Si32 count, Rgba *to,
+    const TgaPixelFormat &format) {
+  if (format.kind == kTgaPixelTrueColor && format.bytes == 4) {
+    SwizzleBgraToRgba(from, count, reinterpret_cast<Ui8*>(to));
+  } else if (format.kind == kTgaPixelTrueColor && format.bytes == 3) {
+    SwizzleBgrToRgba(from, count, reinterpret_cast<Ui8*>(to));
+  } else if (format.kind == kTgaPixelIndexed) {
+    for (Si32 x = 0; x < count; ++x) {
+      to[x] = format.palette[from[x]];
+    }
+  } else if (format.kind == kTgaPixelGrey && format.bytes == 1) {
+    for (Si32 x = 0; x < count; ++x) {
+      to[x] = Rgba(from[x], from[x], from[x], 255);
+    }
+  } else {
+    for (Si32 x = 0; x < count; ++x) {
+      to[x] = ReadTgaPixel(from, format);
+      from += format.bytes;
+    }
+  }
+}
 
-   return(1);
-   }*/
+// Decodes the image data of types 1, 2 and 3 or the RLE packets of
+// types 9, 10 and 11. Packets may continue on the next line.
+static void DecodeTgaPixels(const Ui8 *p, const Ui8 *end, bool is_rle,
+    bool is_origin_upper_left, const TgaPixelFormat &format,
+    easy::SpriteInstance *sprite) {
+  const Si32 width = sprite->width();
+  const Si32 height = sprite->height();
+  Rgba *data = reinterpret_cast<Rgba*>(sprite->RawData());
+  // Sprites are stored bottom-up. Row pointers are only formed for the
+  // lines that exist, one past either end would be undefined.
+  const auto row = [&](Si32 line) {
+    return data +
+      static_cast<Si64>(is_origin_upper_left ? height - 1 - line : line) *
+      width;
+  };
+  Si32 line = 0;
+  Si32 x = 0;
+  while (line < height) {
+    if (!is_rle) {
+      Check(p + static_cast<Si64>(width) * format.bytes <= end,
+        "Error in LoadTga, unexpected end of file.");
+      ConvertTgaPixels(p, width, row(line), format);
+      p += static_cast<Si64>(width) * format.bytes;
+      ++line;
+      continue;
+    }
+    Check(p + 1 + format.bytes <= end,
+      "Error in LoadTga, unexpected end of file.");
+    const Ui8 header = *p;
+    ++p;
+    Si32 count = 1 + (header & 0x7f);
+    const bool is_run = (header & 0x80) != 0;
+    Rgba color(0, 0, 0, 0);
+    if (is_run) {
+      color = ReadTgaPixel(p, format);
+      p += format.bytes;
+    } else {
+      Check(p + static_cast<Si64>(count) * format.bytes <= end,
+        "Error in LoadTga, unexpected end of file.");
+    }
+    while (count > 0) {
+      Check(line < height, "Error in LoadTga, RLE packet is out of bounds.");
+      Rgba *to = row(line);
+      const Si32 part = std::min(count, width - x);
+      if (is_run) {
+        FillPixels(&to[x].rgba, part, color.rgba);
+      } else {
+        ConvertTgaPixels(p, part, to + x, format);
+        p += static_cast<Si64>(part) * format.bytes;
+      }
+      count -= part;
+      x += part;
+      if (x == width) {
+        x = 0;
+        ++line;
+      }
+    }
+  }
+}
 
 std::shared_ptr<easy::SpriteInstance> LoadTga(const Ui8 *data,
     const Si64 size) {
@@ -160,106 +349,268 @@ std::shared_ptr<easy::SpriteInstance> LoadTga(const Ui8 *data,
   Check((tga->bpp == 24) || (tga->bpp == 32) || (tga->bpp == 16)
       || (tga->bpp == 8), "Error in LoadTga, unsupported bpp.");
   const Ui8 *p = data + sizeof(TGAHEADER) + tga->IDFieldLength;
+  const Ui8 *end = data + size;
+  const Ui8 *color_map = p;
+  if (tga->ColorMapType == 1) {
+    // 15-bit entries take two bytes as well.
+    p += static_cast<Si64>(tga->ColorMapLength) *
+      ((tga->ColorMapEntrySize + 7) / 8);
+  }
+  Check(p <= end, "Error in LoadTga, unexpected end of file.");
   bool is_origin_upper_left = !!(tga->ImageDescriptor & (1 << 5));
+  const bool has_alpha_bits = (tga->ImageDescriptor & 15) != 0;
   switch (tga->ImageType) {
     case 2:  // uncommpressed rgb
-      if (tga->bpp == 24) {
-        sprite.reset(new easy::SpriteInstance(tga->xres, tga->yres));
-        Si64 l = sprite->width() * sprite->height() * sizeof(Rgb);
-        Check(p + l <= data + size,
-            "Error in LoadTga, unexpected end of file.");
-        Ui8 *to_line = sprite->RawData();
-        Si64 from_line_size = sprite->width() * sizeof(Rgb);
-        const Ui8 *from_line = p +
-          (is_origin_upper_left ? tga->yres - 1 : 0) * from_line_size;
-        const Si64 from_line_step =
-          (is_origin_upper_left ? -from_line_size : from_line_size);
-        for (Si64 y = 0; y < tga->yres; ++y) {
-          const Ui8 *from = from_line + y * from_line_step;
-          for (Si64 x = 0; x < tga->xres; ++x) {
-            *(to_line + 0) = *(from + 2);
-            *(to_line + 1) = *(from + 1);
-            *(to_line + 2) = *(from + 0);
-            *(to_line + 3) = 255;
-            from += sizeof(Rgb);
-            to_line += sizeof(Rgba);
-          }
-        }
-        return sprite;
-      } else if (tga->bpp == 32) {
+      if (tga->bpp == 24 || tga->bpp == 32) {
         sprite.reset(new easy::SpriteInstance(tga->xres, tga->yres));
-        Si64 l = sprite->width() * sprite->height() * sizeof(Rgba);
+        const Si64 bytes_per_pixel = tga->bpp / 8;
+        Si64 l = sprite->width() * sprite->height() * bytes_per_pixel;
         Check(p + l <= data + size,
             "Error in LoadTga, unexpected end of file.");
-        Ui8 *to_line = sprite->RawData();
-        Si64 from_line_size = sprite->width() * sizeof(Rgba);
+        Ui8 *to = sprite->RawData();
+        const Si64 from_line_size = sprite->width() * bytes_per_pixel;
+        const Si64 to_line_size = sprite->width() * sizeof(Rgba);
         const Ui8 *from_line = p +
           (is_origin_upper_left ? tga->yres - 1 : 0) * from_line_size;
         const Si64 from_line_step =
           (is_origin_upper_left ? -from_line_size : from_line_size);
-        for (Si64 y = 0; y < tga->yres; ++y) {
-          const Ui8 *from = from_line + y * from_line_step;
-          for (Si64 x = 0; x < tga->xres; ++x) {
-            *to_line = *from;
-            *(to_line + 0) = *(from + 2);
-            *(to_line + 1) = *(from + 1);
-            *(to_line + 2) = *(from + 0);
-            *(to_line + 3) = *(from + 3);
-            from += sizeof(Rgba);
-            to_line += sizeof(Rgba);
+        const Si32 width = sprite->width();
+        // Large images are split into bands of lines, one per thread.
+        ParallelFor(0, sprite->height(), kTgaLinesPerThreadMin,
+            [&](Si32 begin, Si32 end) {
+          for (Si64 y = begin; y < end; ++y) {
+            if (bytes_per_pixel == 4) {
+              SwizzleBgraToRgba(from_line + y * from_line_step, width,
+                to + y * to_line_size);
+            } else {
+              SwizzleBgrToRgba(from_line + y * from_line_step, width,
+                to + y * to_line_size);
+            }
           }
-        }
+        });
         return sprite;
       }
-      Fatal("Error in LoadTga, unexpected bpp.");
       break;
-
-      /*
-         case 10:  // compressed rgb
-         if (tga.bpp == 24)
-         format = piImage::FORMAT_I_RGB;
-         else if (tga.bpp == 32)
-         format = piImage::FORMAT_I_RGBA;
-         else
-         break;
-
-         if (!bmp->Make(piImage::TYPE_2D, tga.xres, tga.yres, 1, format))
-         break;
-         if (!C_Load(bmp, fp))
-         break;
-         if (!piImage_Flip(bmp))
-         break;
-         res = 1;
-         break;
-
-         case 3:  // uncompressed grey
-         if (!bmp->Make(piImage::TYPE_2D, tga.xres, tga.yres, 1, piImage::FORMAT_I_GREY))
-         break;
-         if (!U_Load(bmp, fp))
-         break;
-         if (!piImage_Flip(bmp))
-         break;
-         res = 1;
-         break;
-
-         case 11:  // compressed grey
-         if (!bmp->Make(piImage::TYPE_2D, tga.xres, tga.yres, 1, piImage::FORMAT_I_GREY))
-         break;
-         if (!C_Load(bmp, fp))
-         break;
-         if (!piImage_Flip(bmp))
-         break;
-         res = 1;
-         break;
-         */
-    case 1:  // uncompressed pallete
+    case 1:  // uncompressed palette
+    case 9:  // compressed palette
+    case 3:  // uncompressed grey
+    case 11:  // compressed grey
+    case 10:  // compressed rgb
       break;
+    default:
+      Fatal("Error in LoadTga, unsupported image type.");
+  }
 
-    case 9:  // compressed pallete
-      break;
+  const Si32 type = tga->ImageType & 7;
+  const bool is_rle = (tga->ImageType & 8) != 0;
+  TgaPixelFormat format;
+  format.bytes = tga->bpp / 8;
+  format.has_alpha = false;
+  format.palette = nullptr;
+  Rgba palette[256];
+  if (type == 1) {
+    Check(tga->bpp == 8, "Error in LoadTga, unsupported palette index size.");
+    Check(tga->ColorMapType == 1, "Error in LoadTga, no palette.");
+    const Si32 entry_bits = tga->ColorMapEntrySize;
+    Check(entry_bits == 15 || entry_bits == 16 || entry_bits == 24 ||
+      entry_bits == 32, "Error in LoadTga, unsupported palette entry size.");
+    TgaPixelFormat entry_format;
+    entry_format.kind = kTgaPixelTrueColor;
+    entry_format.bytes = (entry_bits + 7) / 8;
+    entry_format.has_alpha = false;
+    entry_format.palette = nullptr;
+    for (Si32 idx = 0; idx < 256; ++idx) {
+      palette[idx] = Rgba(0, 0, 0, 255);
+    }
+    for (Si32 idx = 0; idx < tga->ColorMapLength; ++idx) {
+      const Si32 entry = tga->ColorMapOrigin + idx;
+      if (entry < 256) {
+        palette[entry] = ReadTgaPixel(
+          color_map + idx * entry_format.bytes, entry_format);
+      }
+    }
+    format.kind = kTgaPixelIndexed;
+    format.palette = palette;
+  } else if (type == 2) {
+    Check(tga->bpp != 8, "Error in LoadTga, unexpected bpp.");
+    format.kind = kTgaPixelTrueColor;
+    // 16-bit pixels only use the top bit as alpha when the file says so.
+    format.has_alpha = has_alpha_bits;
+  } else {
+    Check(tga->bpp == 8 || tga->bpp == 16,
+      "Error in LoadTga, unexpected bpp.");
+    format.kind = kTgaPixelGrey;
   }
+  sprite.reset(new easy::SpriteInstance(tga->xres, tga->yres));
+  DecodeTgaPixels(p, end, is_rle, is_origin_upper_left, format, sprite.get());
   return sprite;
 }
 
 
+inline Ui32 ReadQoiUi32(const Ui8 *p) {
+  return (static_cast<Ui32>(p[0]) << 24) | (static_cast<Ui32>(p[1]) << 16) |
+    (static_cast<Ui32>(p[2]) << 8) | static_cast<Ui32>(p[3]);
+}
+
+std::shared_ptr<easy::SpriteInstance> LoadQoi(const Ui8 *data,
+    const Si64 size) {
+  const Si64 kHeaderSize = 14;
+  Check(size >= kHeaderSize && std::memcmp(data, "qoif", 4) == 0,
+    "Error in LoadQoi, not a QOI file.");
+  const Ui32 width = ReadQoiUi32(data + 4);
+  const Ui32 height = ReadQoiUi32(data + 8);
+  Check(width > 0 && height > 0 && width < 65536 && height < 65536,
+    "Error in LoadQoi, unsupported image size.");
+  std::shared_ptr<easy::SpriteInstance> sprite(
+    new easy::SpriteInstance(static_cast<Si32>(width),
+      static_cast<Si32>(height)));
+  const Si32 w = sprite->width();
+  const Si32 h = sprite->height();
+  Rgba *pixels = reinterpret_cast<Rgba*>(sprite->RawData());
+  std::vector<easy::SpanSi32> spans(h);
+  Rgba index[64];
+  std::fill(index, index + 64, Rgba(0, 0, 0, 0));
+  Rgba color(0, 0, 0, 255);
+  const Ui8 *p = data + kHeaderSize;
+  const Ui8 *end = data + size;
+  Si32 run = 0;
+  for (Si32 line = 0; line < h; ++line) {
+    // QOI stores the top line first, sprites the bottom one.
+    const Si32 y = h - 1 - line;
+    Rgba *to = pixels + static_cast<Si64>(y) * w;
+    Si32 x = 0;
+    while (x < w) {
+      if (run > 0) {
+        const Si32 part = std::min(run, w - x);
+        FillPixels(&to[x].rgba, part, color.rgba);
+        run -= part;
+        x += part;
+        continue;
+      }
+      Check(p + 5 <= end, "Error in LoadQoi, unexpected end of file.");
+      const Ui8 op = *p;
+      ++p;
+      if (op == 0xfe) {
+        color.r = p[0];
+        color.g = p[1];
+        color.b = p[2];
+        p += 3;
+      } else if (op == 0xff) {
+        color = Rgba(p[0], p[1], p[2], p[3]);
+        p += 4;
+      } else if ((op >> 6) == 0) {
+        color = index[op];
+      } else if ((op >> 6) == 1) {
+        color.r = static_cast<Ui8>(color.r + ((op >> 4) & 3) - 2);
+        color.g = static_cast<Ui8>(color.g + ((op >> 2) & 3) - 2);
+        color.b = static_cast<Ui8>(color.b + (op & 3) - 2);
+      } else if ((op >> 6) == 2) {
+        const Si32 green = (op & 63) - 32;
+        const Ui8 rest = *p;
+        ++p;
+        color.r = static_cast<Ui8>(color.r + green + (rest >> 4) - 8);
+        color.g = static_cast<Ui8>(color.g + green);
+        color.b = static_cast<Ui8>(color.b + green + (rest & 15) - 8);
+      } else {
+        run = (op & 63) + 1;
+        continue;
+      }
+      index[(color.r * 3 + color.g * 5 + color.b * 7 + color.a * 11) & 63] =
+        color;
+      to[x] = color;
+      ++x;
+    }
+    spans[y] = easy::FindOpaqueSpan(to, w);
+  }
+  sprite->SetOpaqueSpans(std::move(spans));
+  return sprite;
+}
+
+#pragma pack(1)
+struct SpriteFileHeader {
+  char magic[4];
+  Ui32 version;
+  Si32 width;
+  Si32 height;
+  Si32 pivot_x;
+  Si32 pivot_y;
+  Ui32 span_count;
+  Ui32 reserved;
+};
+#pragma pack()
+
+static const char kSpriteFileMagic[4] = {'A', 'S', 'P', 'R'};
+static const Ui32 kSpriteFileVersion = 1;
+
+std::shared_ptr<easy::SpriteInstance> LoadSpriteFile(const char *file_name,
+    Vec2Si32 *out_pivot) {
+  std::ifstream in(file_name, std::ios_base::in | std::ios_base::binary);
+  Check(!!in, "Error in LoadSpriteFile, can't open the file, file_name: ",
+    file_name);
+  SpriteFileHeader header;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  Check(!!in && std::memcmp(header.magic, kSpriteFileMagic, 4) == 0,
+    "Error in LoadSpriteFile, not a sprite file, file_name: ", file_name);
+  Check(header.version == kSpriteFileVersion,
+    "Error in LoadSpriteFile, unsupported version, file_name: ", file_name);
+  Check(header.width > 0 && header.height > 0 &&
+    header.width < 65536 && header.height < 65536,
+    "Error in LoadSpriteFile, bad size, file_name: ", file_name);
+  Check(header.span_count == static_cast<Ui32>(header.height),
+    "Error in LoadSpriteFile, bad span count, file_name: ", file_name);
+  // The lines go straight into the sprite memory, nothing is converted.
+  std::shared_ptr<easy::SpriteInstance> sprite(
+    new easy::SpriteInstance(header.width, header.height));
+  in.read(reinterpret_cast<char*>(sprite->RawData()),
+    static_cast<std::streamsize>(header.width) * header.height *
+    sizeof(Rgba));
+  std::vector<easy::SpanSi32> spans(header.span_count);
+  in.read(reinterpret_cast<char*>(spans.data()),
+    static_cast<std::streamsize>(spans.size() * sizeof(easy::SpanSi32)));
+  Check(!!in, "Error in LoadSpriteFile, unexpected end of file, file_name: ",
+    file_name);
+  // Draws index the lines with the spans, so a damaged file must not
+  // bring spans outside of them.
+  bool is_valid = true;
+  for (const easy::SpanSi32 &span : spans) {
+    is_valid = is_valid && span.begin >= 0 && span.begin <= span.end &&
+      span.end <= header.width;
+  }
+  if (is_valid) {
+    sprite->SetOpaqueSpans(std::move(spans));
+  } else {
+    sprite->UpdateOpaqueSpans();
+  }
+  if (out_pivot) {
+    *out_pivot = Vec2Si32(header.pivot_x, header.pivot_y);
+  }
+  return sprite;
+}
+
+void SaveSpriteFile(const char *file_name, const Rgba *data, Si32 width,
+    Si32 height, Si32 stride, Vec2Si32 pivot) {
+  SpriteFileHeader header;
+  std::memcpy(header.magic, kSpriteFileMagic, 4);
+  header.version = kSpriteFileVersion;
+  header.width = width;
+  header.height = height;
+  header.pivot_x = pivot.x;
+  header.pivot_y = pivot.y;
+  header.span_count = static_cast<Ui32>(height);
+  header.reserved = 0;
+  const Si64 line_size = static_cast<Si64>(width) * sizeof(Rgba);
+  std::vector<Ui8> file(sizeof(header) +
+    static_cast<size_t>(line_size * height + height * sizeof(easy::SpanSi32)));
+  std::memcpy(file.data(), &header, sizeof(header));
+  Ui8 *lines = file.data() + sizeof(header);
+  easy::SpanSi32 *spans = reinterpret_cast<easy::SpanSi32*>(
+    lines + line_size * height);
+  for (Si32 y = 0; y < height; ++y) {
+    const Rgba *line = data + static_cast<Si64>(y) * stride;
+    std::memcpy(lines + line_size * y, line, static_cast<size_t>(line_size));
+    spans[y] = easy::FindOpaqueSpan(line, width);
+  }
+  easy::WriteFile(file_name, file.data(), file.size());
+}
+
 }  // namespace arctic
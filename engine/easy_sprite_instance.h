@@ -27,6 +27,8 @@
 #include <vector>
 #include "engine/arctic_types.h"
 #include "engine/byte_array.h"
+#include "engine/rgba.h"
+#include "engine/vec2si32.h"
 
 namespace arctic {
 namespace easy {
@@ -36,12 +38,19 @@ struct SpanSi32 {
   Si32 end;
 };
 
+// Returns the span from the first to the last pixel with nonzero alpha,
+// an empty span at 0 if there are none.
+SpanSi32 FindOpaqueSpan(const Rgba *line, Si32 width);
+
 class SpriteInstance {
  private:
   Si32 width_;
   Si32 height_;
   ByteArray data_;
   std::vector<SpanSi32> opaque_;
+  // Level 1 is half the size of this image, every next level half of the
+  // previous one, down to 1x1. Empty until UpdateMipmaps is called.
+  std::vector<std::shared_ptr<SpriteInstance>> mipmaps_;
 
  public:
   SpriteInstance(Si32 width, Si32 height);
@@ -63,13 +72,32 @@ class SpriteInstance {
   }
 
   void UpdateOpaqueSpans();
+  // For loaders that find the spans while they decode.
+  void SetOpaqueSpans(std::vector<SpanSi32> spans);
   void ClearOpaqueSpans();
+
+  const std::vector<std::shared_ptr<SpriteInstance>> &Mipmaps() {
+    return mipmaps_;
+  }
+
+  // Rebuilds the whole mip chain with an alpha weighted 2x2 box filter.
+  void UpdateMipmaps();
+  void ClearMipmaps();
 };
 
 }  // namespace easy
 
 std::shared_ptr<easy::SpriteInstance> LoadTga(const Ui8 *data,
     const Si64 size);
+std::shared_ptr<easy::SpriteInstance> LoadQoi(const Ui8 *data,
+    const Si64 size);
+
+// Native sprite file: a header, the RGBA lines bottom up and the opaque
+// spans, loaded without any per pixel work.
+std::shared_ptr<easy::SpriteInstance> LoadSpriteFile(const char *file_name,
+    Vec2Si32 *out_pivot);
+void SaveSpriteFile(const char *file_name, const Rgba *data, Si32 width,
+    Si32 height, Si32 stride, Vec2Si32 pivot);
 
 }  // namespace arctic
 
@@ -23,8 +23,8 @@
 #include <cstring>
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <vector>
-#include <list>
 
 #include "engine/font.h"
 #include "engine/arctic_types.h"
@@ -32,6 +32,8 @@
 
 namespace arctic {
 
+static const size_t kTextRunCacheSize = 256;
+
 void BmFontBinHeader::Log() {
   // TODO(Huldra): Use log here
   std::cerr << "header";
@@ -161,9 +163,112 @@ Ui32 Utf32Reader::ReadOne() {
   }
 }
 
-void Font::Load(const char *file_name) {
-  codepoint.clear();
+// FNV-1a hash of a null terminated string.
+static Ui64 HashText(const char *text) {
+  Ui64 hash = 14695981039346656037ull;
+  for (const char *p = text; *p; ++p) {
+    hash = (hash ^ static_cast<Ui8>(*p)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static Ui32 HashPair(Ui32 first, Ui32 second) {
+  const Ui64 key = (static_cast<Ui64>(first) << 32) | second;
+  return static_cast<Ui32>((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+void KerningTable::Reset(Si32 pair_count) {
+  slots_.clear();
+  mask_ = 0;
+  if (pair_count <= 0) {
+    return;
+  }
+  // Keep the load factor under one half so probe chains stay short.
+  size_t size = 4;
+  while (size < static_cast<size_t>(pair_count) * 2) {
+    size *= 2;
+  }
+  slots_.resize(size, Slot{0, 0, 0});
+  mask_ = static_cast<Ui32>(size - 1);
+}
+
+void KerningTable::Add(Ui32 first, Ui32 second, Si32 amount) {
+  if (amount == 0) {
+    return;
+  }
+  Check(!slots_.empty(), "Error in KerningTable::Add, the table is not Reset");
+  Ui32 idx = HashPair(first, second) & mask_;
+  while (slots_[idx].amount != 0 &&
+      (slots_[idx].first != first || slots_[idx].second != second)) {
+    idx = (idx + 1) & mask_;
+  }
+  slots_[idx] = Slot{first, second, amount};
+}
+
+Si32 KerningTable::Get(Ui32 first, Ui32 second) const {
+  if (slots_.empty()) {
+    return 0;
+  }
+  Ui32 idx = HashPair(first, second) & mask_;
+  while (slots_[idx].amount != 0) {
+    if (slots_[idx].first == first && slots_[idx].second == second) {
+      return slots_[idx].amount;
+    }
+    idx = (idx + 1) & mask_;
+  }
+  return 0;
+}
+
+TextRunCache &TextRunCache::operator=(const TextRunCache &) {
+  Clear();
+  return *this;
+}
+
+TextRun *TextRunCache::Find(const char *text) {
+  auto it = index_.find(HashText(text));
+  if (it == index_.end() || it->second->text != text) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return &it->second->run;
+}
+
+TextRun *TextRunCache::Add(const char *text) {
+  const Ui64 hash = HashText(text);
+  auto it = index_.find(hash);
+  if (it != index_.end()) {
+    // A different text with the same hash.
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  if (entries_.size() >= kTextRunCacheSize) {
+    // Reuse the least recently used entry along with its memory.
+    index_.erase(entries_.back().hash);
+    entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+  } else {
+    entries_.emplace_front();
+  }
+  Entry &entry = entries_.front();
+  entry.text = text;
+  entry.hash = hash;
+  entry.run.glyphs.clear();
+  index_[hash] = entries_.begin();
+  return &entry.run;
+}
+
+void TextRunCache::Clear() {
+  entries_.clear();
+  index_.clear();
+}
+
+void Font::Load(const char *file_name, FontStorage in_storage) {
+  storage = in_storage;
   glyph.clear();
+  codepoint_page.clear();
+  codepoint_glyph.clear();
+  coverage.clear();
+  kerning.Reset(0);
+  text_runs.Clear();
 
 
   std::vector<Ui8> file = easy::ReadFile(file_name);
@@ -248,21 +353,32 @@ void Font::Load(const char *file_name) {
   Check(block_type == kBlockChars, "Unexpected block type 4");
   Check(block_size >= sizeof(BmFontBinChars), "Pages block is too small");
   inner_pos = pos;
+  glyph.reserve(block_size / 20);
   for (Si32 id = 0; id < block_size / 20; ++id) {
     BmFontBinChars *chars = reinterpret_cast<BmFontBinChars*>(
       &file[inner_pos]);
     chars->Log();
 
-    easy::Sprite sprite0;
-    sprite0.Reference(page_images[chars->page],
+    easy::Sprite sprite;
+    sprite.Reference(page_images[chars->page],
       chars->x, page_images[chars->page].Height() - chars->y - chars->height,
       chars->width, chars->height);
-    easy::Sprite sprite;
-    sprite.Clone(sprite0);
-    sprite.UpdateOpaqueSpans();
     sprite.SetPivot(arctic::Vec2Si32(
       chars->xoffset, chars->height + chars->yoffset - common->base));
-    glyph.emplace_back(chars->id, chars->xadvance, sprite);
+    if (storage == kFontStorageCoverage) {
+      glyph.emplace_back(chars->id, chars->xadvance, sprite);
+      glyph.back().sprite = easy::Sprite();
+      glyph.back().coverage = static_cast<Si32>(coverage.size());
+      for (Si32 y = 0; y < sprite.Height(); ++y) {
+        const Rgba *line = sprite.RgbaData() + y * sprite.StridePixels();
+        for (Si32 x = 0; x < sprite.Width(); ++x) {
+          coverage.push_back(line[x].a);
+        }
+      }
+    } else {
+      sprite.UpdateOpaqueSpans();
+      glyph.emplace_back(chars->id, chars->xadvance, sprite);
+    }
 
     inner_pos += 20;
   }
@@ -277,70 +393,75 @@ void Font::Load(const char *file_name) {
     Check(block_size >= sizeof(BmFontBinKerningPair),
       "KerningPair block is too small");
     inner_pos = pos;
+    kerning.Reset(block_size / 10);
     for (Si32 id = 0; id < block_size / 10; ++id) {
       BmFontBinKerningPair *kerning_pair =
         reinterpret_cast<BmFontBinKerningPair*>(&file[inner_pos]);
       kerning_pair->Log();
+      kerning.Add(kerning_pair->first, kerning_pair->second,
+        kerning_pair->amount);
       inner_pos += 10;
     }
     pos += block_size;
   }
 
   Ui32 end_codepoint = 0;
-  for (auto it = glyph.begin(); it != glyph.end(); ++it) {
-    if (it->codepoint >= end_codepoint) {
-      end_codepoint = it->codepoint + 1;
+  for (const Glyph &item : glyph) {
+    end_codepoint = std::max(end_codepoint, item.codepoint + 1);
+  }
+  codepoint_page.resize((end_codepoint + 255) >> 8, 0);
+  codepoint_glyph.resize(256, -1);
+  for (size_t idx = 0; idx < glyph.size(); ++idx) {
+    Ui32 &page = codepoint_page[glyph[idx].codepoint >> 8];
+    if (page == 0) {
+      page = static_cast<Ui32>(codepoint_glyph.size());
+      codepoint_glyph.resize(codepoint_glyph.size() + 256, -1);
     }
+    codepoint_glyph[page + (glyph[idx].codepoint & 255)] =
+      static_cast<Si32>(idx);
   }
-  codepoint.resize(end_codepoint, nullptr);
-  for (auto it = glyph.begin(); it != glyph.end(); ++it) {
-    codepoint[it->codepoint] = &(*it);
+}
+
+Glyph *Font::FindGlyph(Ui32 code) {
+  if ((code >> 8) >= codepoint_page.size()) {
+    return nullptr;
   }
+  const Si32 idx = codepoint_glyph[codepoint_page[code >> 8] + (code & 255)];
+  return idx < 0 ? nullptr : &glyph[idx];
 }
 
 void Font::DrawEvaluateSizeImpl(const char *text, bool do_keep_xadvance,
   Si32 x, Si32 y, TextOrigin origin, bool do_draw,
   Vec2Si32 *out_size) {
-  Si32 next_x = x;
-  Si32 next_y = y;
+  const TextRun &run = GetTextRun(text);
   if (do_draw) {
-    if (origin == kTextOriginTop) {
-      next_y = y - base_to_top + line_height;
-    } else if (origin == kTextOriginFirstBase) {
-      next_y = y + line_height;
-    } else {
-      Vec2Si32 size;
-      DrawEvaluateSizeImpl(text, do_keep_xadvance,
-        x, y, origin, false,
-        &size);
-      if (origin == kTextOriginBottom) {
-        next_y = y + size.y - base_to_top + line_height;
-      } else if (origin == kTextOriginLastBase) {
-        next_y = y + size.y;
-      }
-    }
+    Draw(run, x, y, origin);
   }
+  if (out_size) {
+    *out_size = do_keep_xadvance ? run.size_keep_xadvance : run.size;
+  }
+}
 
+void Font::Layout(const char *text, TextRun *out_run) {
+  out_run->glyphs.clear();
+  Si32 next_x = 0;
+  Si32 next_y = line_height;
+  // Line widths with the last glyph ending at its xadvance and at its
+  // right side.
   Si32 width = 0;
   Si32 max_width = 0;
+  Si32 max_width_keep_xadvance = 0;
   Si32 lines = 0;
   Ui32 prev_code = 0;
   bool is_newline = false;
   Si32 newline_count = 1;
   Utf32Reader reader;
   reader.Reset(reinterpret_cast<const Ui8*>(text));
-  Glyph *glyph = nullptr;
+  const Glyph *last_glyph = nullptr;
   while (true) {
     Ui32 code = reader.ReadOne();
     if (!code) {
-      if (glyph && !do_keep_xadvance) {
-        width += glyph->sprite.Width() - glyph->xadvance;
-      }
-      max_width = std::max(max_width, width);
-      if (out_size) {
-        *out_size = Vec2Si32(max_width, lines * line_height);
-      }
-      return;
+      break;
     }
     if (code == '\r' || code == '\n') {
       if (is_newline) {
@@ -356,30 +477,131 @@ void Font::DrawEvaluateSizeImpl(const char *text, bool do_keep_xadvance,
       }
     } else {
       is_newline = false;
-      if (code < codepoint.size() && codepoint[code]) {
+      Glyph *glyph = FindGlyph(code);
+      if (glyph) {
         if (newline_count) {
-          if (glyph && !do_keep_xadvance) {
-            width += glyph->sprite.Width() - glyph->xadvance;
+          if (last_glyph) {
+            max_width_keep_xadvance = std::max(max_width_keep_xadvance,
+              width);
+            max_width = std::max(max_width,
+              width + last_glyph->width - last_glyph->xadvance);
           }
-          max_width = std::max(max_width, width);
           width = 0;
-          next_x = x;
+          next_x = 0;
           lines += newline_count;
           next_y -= newline_count * line_height;
           newline_count = 0;
+        } else if (!kerning.IsEmpty()) {
+          const Si32 amount = kerning.Get(last_glyph->codepoint, code);
+          width += amount;
+          next_x += amount;
         }
-
-        glyph = codepoint[code];
+        out_run->glyphs.push_back(TextRunGlyph{glyph,
+          Vec2Si32(next_x, next_y)});
         width += glyph->xadvance;
-        if (do_draw) {
-          glyph->sprite.Draw(next_x, next_y);
-          next_x += glyph->xadvance;
-        }
+        next_x += glyph->xadvance;
+        last_glyph = glyph;
+      }
+    }
+  }
+  max_width_keep_xadvance = std::max(max_width_keep_xadvance, width);
+  if (last_glyph) {
+    width += last_glyph->width - last_glyph->xadvance;
+  }
+  max_width = std::max(max_width, width);
+  out_run->size = Vec2Si32(max_width, lines * line_height);
+  out_run->size_keep_xadvance = Vec2Si32(max_width_keep_xadvance,
+    lines * line_height);
+}
+
+const TextRun &Font::GetTextRun(const char *text) {
+  TextRun *run = text_runs.Find(text);
+  if (!run) {
+    run = text_runs.Add(text);
+    Layout(text, run);
+  }
+  return *run;
+}
+
+// Returns the first baseline of the run drawn at y, the run knows its
+// size so this takes no pass over the text.
+static Si32 FirstBaseline(const Font &font, const TextRun &run, Si32 y,
+    TextOrigin origin) {
+  if (origin == kTextOriginTop) {
+    return y - font.base_to_top;
+  } else if (origin == kTextOriginBottom) {
+    return y + run.size.y - font.base_to_top;
+  } else if (origin == kTextOriginLastBase) {
+    return y + run.size.y - font.line_height;
+  }
+  return y;
+}
+
+// Blends the color over the target with the glyph alpha scaled by the
+// color alpha. The alpha values are kStep bytes apart, 1 in the coverage
+// of a font and 4 to read the alpha channel of an rgba sprite.
+template<Si32 kStep>
+static void DrawCoverage(const Ui8 *from, Si32 from_stride_bytes,
+    Si32 width, Si32 height, Si32 to_x, Si32 to_y, Rgba color,
+    easy::Sprite to_sprite) {
+  const Si32 x_begin = std::max(0, -to_x);
+  const Si32 x_end = std::min(width, to_sprite.Width() - to_x);
+  const Si32 y_begin = std::max(0, -to_y);
+  const Si32 y_end = std::min(height, to_sprite.Height() - to_y);
+  if (x_end <= x_begin || y_end <= y_begin) {
+    return;
+  }
+  const Si32 to_stride = to_sprite.StridePixels();
+  const Ui32 alpha_scale = static_cast<Ui32>(color.a) + 1;
+  const Ui32 rgb = color.rgba & 0x00fffffful;
+  for (Si32 y = y_begin; y < y_end; ++y) {
+    const Ui8 *from_line = from + y * from_stride_bytes;
+    Rgba *to_line = to_sprite.RgbaData() + (to_y + y) * to_stride + to_x;
+    for (Si32 x = x_begin; x < x_end; ++x) {
+      const Ui32 alpha = (from_line[x * kStep] * alpha_scale) >> 8;
+      if (alpha) {
+        easy::DrawPixel<easy::kAlphaBlend>(Rgba(rgb | (alpha << 24)),
+          to_line + x);
       }
     }
   }
 }
 
+void Font::Draw(const TextRun &run, const Si32 x, const Si32 y,
+    TextOrigin origin) {
+  if (storage == kFontStorageCoverage) {
+    Draw(run, x, y, origin, Rgba(255, 255, 255, 255));
+    return;
+  }
+  const Si32 base_y = FirstBaseline(*this, run, y, origin);
+  for (const TextRunGlyph &item : run.glyphs) {
+    item.glyph->sprite.Draw(x + item.pos.x, base_y + item.pos.y);
+  }
+}
+
+void Font::Draw(const TextRun &run, const Si32 x, const Si32 y,
+    TextOrigin origin, Rgba color) {
+  if (color.a == 0) {
+    return;
+  }
+  easy::Sprite to_sprite = easy::GetEngine()->GetBackbuffer();
+  const Si32 base_y = FirstBaseline(*this, run, y, origin);
+  for (const TextRunGlyph &item : run.glyphs) {
+    Glyph &g = *item.glyph;
+    const Si32 to_x = x + item.pos.x - g.pivot.x;
+    const Si32 to_y = base_y + item.pos.y - g.pivot.y;
+    if (g.coverage >= 0) {
+      DrawCoverage<1>(coverage.data() + g.coverage, g.width,
+        g.width, g.height, to_x, to_y, color, to_sprite);
+    } else if (g.width > 0 && g.height > 0) {
+      DrawCoverage<4>(
+        reinterpret_cast<const Ui8*>(g.sprite.RgbaData()) + 3,
+        g.sprite.StrideBytes(), g.width, g.height, to_x, to_y, color,
+        to_sprite);
+    }
+  }
+}
+
 Vec2Si32 Font::EvaluateSize(const char *text, bool do_keep_xadvance) {
   Vec2Si32 size;
   DrawEvaluateSizeImpl(text, do_keep_xadvance,
@@ -398,4 +620,9 @@ void Font::Draw(const char *text, const Si32 x, const Si32 y,
   DrawEvaluateSizeImpl(text, false, x, y, origin, true, nullptr);
 }
 
+void Font::Draw(const char *text, const Si32 x, const Si32 y,
+  TextOrigin origin, Rgba color) {
+  Draw(GetTextRun(text), x, y, origin, color);
+}
+
 }  // namespace arctic
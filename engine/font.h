@@ -23,8 +23,10 @@
 #ifndef ENGINE_FONT_H_
 #define ENGINE_FONT_H_
 
-#include <vector>
 #include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "engine/arctic_types.h"
 #include "engine/easy_sprite.h"
@@ -150,12 +152,55 @@ struct Utf32Reader {
 struct Glyph {
   Ui32 codepoint;
   Si32 xadvance;
+  // Empty for fonts loaded with kFontStorageCoverage.
   easy::Sprite sprite;
+  Si32 width;
+  Si32 height;
+  Vec2Si32 pivot;
+  // Offset of the width by height glyph alpha in Font::coverage, rows go
+  // bottom up. -1 for fonts loaded with kFontStorageRgba.
+  Si32 coverage = -1;
 
   Glyph(Ui32 in_codepoint, Si32 in_xadvance, easy::Sprite in_sprite)
     : codepoint(in_codepoint)
     , xadvance(in_xadvance)
-    , sprite(in_sprite) {
+    , sprite(in_sprite)
+    , width(in_sprite.Width())
+    , height(in_sprite.Height())
+    , pivot(in_sprite.Pivot()) {
+  }
+};
+
+// How Font::Load keeps the glyph images.
+enum FontStorage {
+  // Rgba glyph sprites, drawn as they are in the font image.
+  kFontStorageRgba = 0,
+  // Only the glyph alpha, a quarter of the memory. Such glyphs have no
+  // color of their own and are drawn in the text color, white by default.
+  kFontStorageCoverage = 1
+};
+
+// Kerning amounts of the glyph pairs in an open addressing hash table.
+// Pairs with zero amount are not stored, so zero marks a free slot.
+class KerningTable {
+ private:
+  struct Slot {
+    Ui32 first;
+    Ui32 second;
+    Si32 amount;
+  };
+
+  std::vector<Slot> slots_;
+  Ui32 mask_ = 0;
+
+ public:
+  // Makes the table empty with room for pair_count pairs.
+  void Reset(Si32 pair_count);
+  void Add(Ui32 first, Ui32 second, Si32 amount);
+  // Returns the x offset of the second glyph drawn after the first one.
+  Si32 Get(Ui32 first, Ui32 second) const;
+  bool IsEmpty() const {
+    return slots_.empty();
   }
 };
 
@@ -166,14 +211,68 @@ enum TextOrigin {
   kTextOriginTop = 3
 };
 
+// A glyph of a laid out text and its pen position relative to the start
+// of the first baseline.
+struct TextRunGlyph {
+  Glyph *glyph;
+  Vec2Si32 pos;
+};
+
+// Text decoded and laid out once, so drawing it takes only the blits.
+struct TextRun {
+  std::vector<TextRunGlyph> glyphs;
+  // The sizes EvaluateSize returns with do_keep_xadvance false and true.
+  Vec2Si32 size;
+  Vec2Si32 size_keep_xadvance;
+};
+
+// The runs of the recently used texts, the least recently used ones are
+// dropped first. The runs point at the glyphs of their font, so copies of
+// the cache start empty.
+class TextRunCache {
+ private:
+  struct Entry {
+    std::string text;
+    Ui64 hash;
+    TextRun run;
+  };
+
+  // The most recently used entry goes first.
+  std::list<Entry> entries_;
+  std::unordered_map<Ui64, std::list<Entry>::iterator> index_;
+
+ public:
+  TextRunCache() {}
+  TextRunCache(const TextRunCache &) {}
+  TextRunCache &operator=(const TextRunCache &);
+  // Returns the run of the text or nullptr when it is not cached.
+  TextRun *Find(const char *text);
+  // Returns an empty run to lay the text out into.
+  TextRun *Add(const char *text);
+  void Clear();
+};
+
 struct Font {
-  std::vector<Glyph*> codepoint;
-  std::list<Glyph> glyph;
+  FontStorage storage = kFontStorageRgba;
+  // Glyph sprites are references into the page images of the font.
+  std::vector<Glyph> glyph;
+  // Two level codepoint lookup. codepoint_page[code >> 8] is the start of
+  // the 256 glyph indices of the page in codepoint_glyph, -1 marks a
+  // missing glyph. Pages with no glyphs share the first page.
+  std::vector<Ui32> codepoint_page;
+  std::vector<Si32> codepoint_glyph;
+  // Glyph alpha of kFontStorageCoverage fonts.
+  std::vector<Ui8> coverage;
   Si32 base_to_top = 0;
   Si32 base_to_bottom = 0;
   Si32 line_height = 0;
+  KerningTable kerning;
+  TextRunCache text_runs;
 
-  void Load(const char *file_name);
+  void Load(const char *file_name,
+    FontStorage in_storage = kFontStorageRgba);
+  // Returns the glyph of the codepoint or nullptr when the font lacks it.
+  Glyph *FindGlyph(Ui32 code);
   void DrawEvaluateSizeImpl(const char *text, bool do_keep_xadvance,
     Si32 x, Si32 y, TextOrigin origin, bool do_draw,
     Vec2Si32 *out_size);
@@ -181,6 +280,18 @@ struct Font {
   void Draw(const char *text, const Si32 x, const Si32 y);
   void Draw(const char *text, const Si32 x, const Si32 y,
     TextOrigin origin);
+  // Draws the text in the color, using the glyph alpha as coverage.
+  void Draw(const char *text, const Si32 x, const Si32 y,
+    TextOrigin origin, Rgba color);
+  // Decodes and lays the text out.
+  void Layout(const char *text, TextRun *out_run);
+  // Returns the cached run of the text, laying it out on a miss. The run
+  // stays valid until the next call.
+  const TextRun &GetTextRun(const char *text);
+  void Draw(const TextRun &run, const Si32 x, const Si32 y,
+    TextOrigin origin);
+  void Draw(const TextRun &run, const Si32 x, const Si32 y,
+    TextOrigin origin, Rgba color);
 };
 
 }  // namespace arctic